@@ -6,6 +6,8 @@
 #include <iostream>
 
 #include <liquidpp.hpp>
+#include <liquidpp/Scanner.hpp>
+#include <liquidpp/Serialization.hpp>
 
 auto renderNoCaching = [](){
     liquidpp::Context c;
@@ -65,6 +67,250 @@ NONIUS_BENCHMARK("Hello {{name}}! (cached context and template)", [](nonius::chr
     meter.measure([&](){ return template_(c); });
 })
 
+liquidpp::Context& productsContext() {
+   using Product = std::map<std::string, std::string>;
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized) {
+      std::vector<Product> products;
+      for (int i = 0; i < 100; i++)
+         products.push_back({{"title", "Product " + std::to_string(i)}, {"type", i % 3 ? "shirt" : "hat"}});
+      c.set("products", products);
+      initialized = true;
+   }
+   return c;
+}
+
+constexpr auto productsTemplate = R"(<ul>
+{%- for product in products -%}
+   <li class="{% if forloop.first %}first{% elsif forloop.last %}last{% else %}item{% endif %}">
+      {{- product.title | upcase -}}
+      {%- if product.type == 'hat' %} (hat){% endif -%}
+   </li>
+{%- endfor -%}
+</ul>)";
+
+NONIUS_BENCHMARK("Products loop (tree renderer)", [](nonius::chronometer meter) {
+   auto& c = productsContext();
+   auto template_ = liquidpp::parse(productsTemplate);
+   meter.measure([&](){ return template_(c); });
+})
+
+NONIUS_BENCHMARK("Products loop (bytecode program)", [](nonius::chronometer meter) {
+   auto& c = productsContext();
+   auto template_ = liquidpp::parse(productsTemplate);
+   template_.compile();
+   meter.measure([&](){ return template_(c); });
+})
+
+// Finds the first hat after the first product, 'break' ends every rendering
+constexpr auto firstMatchTemplate =
+   "{% for product in products %}{% if forloop.index > 1 and product.type == 'hat' %}"
+   "{{ product.title }}{% break %}{% endif %}{% endfor %}";
+
+// Renders the template 200 times on each of 16 threads
+void renderOn16Threads(const liquidpp::Template& template_, const liquidpp::Context& c)
+{
+   std::vector<std::thread> threads(16);
+   for (auto&& t : threads)
+      t = std::thread([&] {
+         for (int i = 0; i < 200; i++)
+            if (template_(c).empty())
+               throw std::runtime_error("invalid state!");
+      });
+
+   for (auto&& t : threads)
+      t.join();
+}
+
+NONIUS_BENCHMARK("Loop with early break, 16 threads (tree renderer)", [](nonius::chronometer meter) {
+   auto& c = productsContext();
+   auto template_ = liquidpp::parse(firstMatchTemplate);
+   meter.measure([&](){ renderOn16Threads(template_, c); });
+})
+
+NONIUS_BENCHMARK("Loop with early break, 16 threads (bytecode program)", [](nonius::chronometer meter) {
+   auto& c = productsContext();
+   auto template_ = liquidpp::parse(firstMatchTemplate);
+   template_.compile();
+   meter.measure([&](){ renderOn16Threads(template_, c); });
+})
+
+liquidpp::Context& collectionContext() {
+   using Product = std::map<std::string, std::vector<std::string>>;
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized) {
+      std::vector<std::string> filterTags;
+      for (int i = 0; i < 50; i++)
+         filterTags.push_back("tag" + std::to_string(i));
+
+      std::vector<Product> products;
+      for (int i = 0; i < 100; i++) {
+         Product product{{"tags", {}}, {"type", {"type" + std::to_string(i % 60)}}};
+         for (int k = 0; k < 12; k++)
+            product["tags"].push_back("tag" + std::to_string((i + k * 7) % 60));
+         products.push_back(std::move(product));
+      }
+
+      c.set("current_tags", filterTags);
+      c.set("products", products);
+      initialized = true;
+   }
+   return c;
+}
+
+// Collection page filtered by tags: the same tag lists are checked for many needles
+constexpr auto collectionTemplate = R"(
+{%- for product in products -%}
+   {%- if current_tags contains product.type.first %}T{% endif -%}
+   {%- if product.tags contains 'tag3' or product.tags contains 'tag17' %}S{% endif -%}
+   {%- if product.tags contains 'tag42' and product.tags contains 'tag9' %}N{% endif -%}
+   {%- for tag in product.tags -%}
+      {%- if current_tags contains tag %}+{% endif -%}
+   {%- endfor -%}
+{%- endfor -%})";
+
+NONIUS_BENCHMARK("Collection page with tag filters (tree renderer)", [](nonius::chronometer meter) {
+   auto& c = collectionContext();
+   auto template_ = liquidpp::parse(collectionTemplate);
+   meter.measure([&](){ return template_(c); });
+})
+
+NONIUS_BENCHMARK("Collection page with tag filters (bytecode program)", [](nonius::chronometer meter) {
+   auto& c = collectionContext();
+   auto template_ = liquidpp::parse(collectionTemplate);
+   template_.compile();
+   meter.measure([&](){ return template_(c); });
+})
+
+NONIUS_BENCHMARK("Hello {{name}}! (cached context and compiled template)", [](nonius::chronometer meter) {
+    liquidpp::Context c;
+    c.set("name", "Donald Drumpf");
+    auto template_ = liquidpp::parse("Hello {{name}}!");
+    template_.compile();
+    meter.measure([&](){ return template_(c); });
+})
+
+NONIUS_BENCHMARK("Hello {{name}}! (cached context and TemplateCache)", [](nonius::chronometer meter) {
+    liquidpp::Context c;
+    c.set("name", "Donald Drumpf");
+    liquidpp::TemplateCache cache;
+    meter.measure([&](){ return liquidpp::render(cache, "Hello {{name}}!", c); });
+})
+
+std::string manyWhensTemplate() {
+   std::string res = "{% case value %}";
+   for (int i = 0; i < 64; i++)
+      res += "{% when 'value" + std::to_string(i) + "' %}Branch " + std::to_string(i);
+   res += "{% else %}No branch{% endcase %}";
+   return res;
+}
+
+NONIUS_BENCHMARK("case with 64 when branches", [](nonius::chronometer meter) {
+   auto content = manyWhensTemplate();
+   auto template_ = liquidpp::parse(content);
+   liquidpp::Context c;
+   c.set("value", "value57");
+   meter.measure([&](){ return template_(c); });
+})
+
+std::string themeTemplate() {
+   std::string res;
+   for (int i = 0; i < 50; i++)
+      res += productsTemplate;
+   return res + manyWhensTemplate();
+}
+
+NONIUS_BENCHMARK("Startup: parse theme template", [](nonius::chronometer meter) {
+   auto content = themeTemplate();
+   meter.measure([&](){ return liquidpp::parse(content).root.nodeList.size(); });
+})
+
+// Exactly 1 MiB of theme templates, padded with literal text: the mean time
+// in seconds is the inverse of the throughput in MiB/s
+std::string themeCorpus() {
+   const size_t size = 1 << 20;
+   std::string res;
+   const auto theme = themeTemplate();
+   while (res.size() + theme.size() <= size)
+      res += theme;
+   res.resize(size, ' ');
+   return res;
+}
+
+void parseThroughput(nonius::chronometer meter, liquidpp::scanner::Isa isa) {
+   auto content = themeCorpus();
+   auto previous = liquidpp::scanner::activeIsa();
+   if (!liquidpp::scanner::setIsa(isa))
+      throw std::runtime_error("Instruction set is not supported by this CPU!");
+   meter.measure([&](){ return liquidpp::parse(content).root.nodeList.size(); });
+   liquidpp::scanner::setIsa(previous);
+}
+
+NONIUS_BENCHMARK("Parse throughput (MiB/s = 1 / mean): 1 MiB theme corpus, scalar", [](nonius::chronometer meter) {
+   parseThroughput(meter, liquidpp::scanner::Isa::Scalar);
+})
+
+NONIUS_BENCHMARK("Parse throughput (MiB/s = 1 / mean): 1 MiB theme corpus, SSE2", [](nonius::chronometer meter) {
+   parseThroughput(meter, liquidpp::scanner::Isa::SSE2);
+})
+
+NONIUS_BENCHMARK("Parse throughput (MiB/s = 1 / mean): 1 MiB theme corpus, AVX2", [](nonius::chronometer meter) {
+   parseThroughput(meter, liquidpp::scanner::Isa::AVX2);
+})
+
+NONIUS_BENCHMARK("Startup: load binary theme template", [](nonius::chronometer meter) {
+   auto data = liquidpp::LiteralPool::copy(liquidpp::serialize(liquidpp::parse(themeTemplate())));
+   meter.measure([&](){ return liquidpp::deserialize(data).root.nodeList.size(); });
+})
+
+liquidpp::Context& globalsContext() {
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized) {
+      for (int i = 0; i < 80; i++)
+         c.set("global" + std::to_string(i), "value " + std::to_string(i));
+      initialized = true;
+   }
+   return c;
+}
+
+constexpr auto globalsTemplate = "{{ global3 }} {{ global17 }} {{ global42 }} {{ global79 }} {{ cart }}";
+
+NONIUS_BENCHMARK("80 globals: per request context", [](nonius::chronometer meter) {
+   auto template_ = liquidpp::parse(globalsTemplate);
+   meter.measure([&](){
+      liquidpp::Context request;
+      for (int i = 0; i < 80; i++)
+         request.set("global" + std::to_string(i), "value " + std::to_string(i));
+      request.set("cart", 3);
+      return template_(request);
+   });
+})
+
+NONIUS_BENCHMARK("80 globals: request layered over frozen globals", [](nonius::chronometer meter) {
+   auto globals = globalsContext().freeze();
+   auto template_ = liquidpp::parse(globalsTemplate);
+   meter.measure([&](){
+      liquidpp::Context request{globals};
+      request.set("cart", 3);
+      return template_(request);
+   });
+})
+
+NONIUS_BENCHMARK("80 globals: lookups in the map", [](nonius::chronometer meter) {
+   auto& c = globalsContext();
+   auto template_ = liquidpp::parse(globalsTemplate);
+   meter.measure([&](){ return template_(c); });
+})
+
+NONIUS_BENCHMARK("80 globals: lookups in the frozen table", [](nonius::chronometer meter) {
+   liquidpp::Context c{globalsContext().freeze()};
+   auto template_ = liquidpp::parse(globalsTemplate);
+   meter.measure([&](){ return template_(c); });
+})
+
 NONIUS_BENCHMARK("Render date now", []() {
    liquidpp::Context c;
    auto template_ = liquidpp::parse("{{ 'now' | date: '%Y-%m-%d %H:%M:%s' }}!");
@@ -86,6 +332,7 @@ int main()
    std::cerr << "Size of liquidpp::filters::Filter:         " << sizeof(liquidpp::filters::Filter) << '\n';
    std::cerr << "Size of liquidpp::RangeDefinition:         " << sizeof(liquidpp::RangeDefinition) << '\n';
    std::cerr << "Size of liquidpp::Value:                   " << sizeof(liquidpp::Value) << '\n';
+   std::cerr << "Size of liquidpp::Key:                     " << sizeof(liquidpp::Key) << '\n';
    std::cerr << "Size of liquidpp::Path:                    " << sizeof(liquidpp::Path) << '\n';
    std::cerr << "Size of liquidpp::PathRef:                 " << sizeof(liquidpp::PathRef) << '\n';
    std::cerr << "Size of liquidpp::Expression::Token:       " << sizeof(liquidpp::Expression::Token) << '\n';
@@ -0,0 +1,40 @@
+include(CMakeParseArguments)
+
+# liquidpp_compile_templates(<sources var> <headers var> [NAMESPACE <namespace>] <template files>...)
+#
+# Translates the templates to C++ with liquidpp-compile (see
+# liquidpp::CodeGenerator). The template <name>.liquid is rendered by
+#    std::string <namespace>::<name>(const liquidpp::Context& context);
+# declared in <name>.liquid.hpp of the current binary directory. The
+# generated sources and headers are returned in the variables (like
+# PROTOBUF_GENERATE_CPP()).
+function(liquidpp_compile_templates SRCS HDRS)
+   cmake_parse_arguments(LIQUIDPP "" "NAMESPACE" "" ${ARGN})
+
+   set(${SRCS})
+   set(${HDRS})
+   foreach(TEMPLATE ${LIQUIDPP_UNPARSED_ARGUMENTS})
+      get_filename_component(ABS_TEMPLATE ${TEMPLATE} ABSOLUTE)
+      get_filename_component(NAME ${TEMPLATE} NAME_WE)
+      string(MAKE_C_IDENTIFIER ${NAME} FUNCTION)
+      if (LIQUIDPP_NAMESPACE)
+         set(FUNCTION "${LIQUIDPP_NAMESPACE}::${FUNCTION}")
+      endif (LIQUIDPP_NAMESPACE)
+
+      set(HDR "${CMAKE_CURRENT_BINARY_DIR}/${NAME}.liquid.hpp")
+      set(SRC "${CMAKE_CURRENT_BINARY_DIR}/${NAME}.liquid.cpp")
+      add_custom_command(
+         OUTPUT ${HDR} ${SRC}
+         COMMAND liquidpp-compile ${ABS_TEMPLATE} ${FUNCTION} ${HDR} ${SRC}
+         DEPENDS ${ABS_TEMPLATE} liquidpp-compile
+         COMMENT "Compiling liquid template ${TEMPLATE}"
+         VERBATIM)
+
+      list(APPEND ${SRCS} ${SRC})
+      list(APPEND ${HDRS} ${HDR})
+   endforeach()
+
+   set_source_files_properties(${${SRCS}} ${${HDRS}} PROPERTIES GENERATED TRUE)
+   set(${SRCS} ${${SRCS}} PARENT_SCOPE)
+   set(${HDRS} ${${HDRS}} PARENT_SCOPE)
+endfunction()
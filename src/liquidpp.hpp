@@ -2,6 +2,7 @@
 
 #include <liquidpp/Context.hpp>
 #include <liquidpp/parser.hpp>
+#include <liquidpp/TemplateCache.hpp>
 
 namespace liquidpp
 {
@@ -10,4 +11,9 @@ std::string render(string_view content, const Context& context)
 {
    return parse<TagFactoryT>(content)(context);
 }
+
+inline std::string render(TemplateCache& cache, string_view content, const Context& context)
+{
+   return (*cache.get(content))(context);
+}
 }
@@ -4,7 +4,7 @@
 
 namespace liquidpp
 {
-void renderNode(Context& context, const Node& node, std::string& res)
+RenderStatus renderNode(Context& context, const Node& node, std::string& res)
 {
    // TODO: use static visitor
    switch(type(node))
@@ -23,12 +23,25 @@ void renderNode(Context& context, const Node& node, std::string& res)
       case NodeType::Tag:
       {
          auto& renderable = *boost::get<std::unique_ptr<const IRenderable>>(node);
-         renderable.render(context, res);
-         break;
+         return renderable.renderWithStatus(context, res);
       }
       case NodeType::UnevaluatedTag:
          break;
    }
+
+   return RenderStatus::Normal;
+}
+
+RenderStatus renderNodes(Context& context, const BlockBody& body, NodeRange range, std::string& res)
+{
+   for (auto i = range.begin; i < range.end; i++)
+   {
+      auto status = renderNode(context, body.nodeList[i], res);
+      if (status != RenderStatus::Normal)
+         return status;
+   }
+
+   return RenderStatus::Normal;
 }
 
 }
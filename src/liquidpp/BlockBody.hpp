@@ -15,7 +15,8 @@ enum class NodeType {
    Tag = 3
 };
 
-void renderNode(Context& context, const Node& node, std::string& res);
+// Returns 'Break' or 'Continue' if the node is or contains such a tag
+RenderStatus renderNode(Context& context, const Node& node, std::string& res);
 
 inline NodeType type(const Node& n) {
    return static_cast<NodeType>(n.which());
@@ -44,4 +45,17 @@ struct BlockBody {
    string_view templateRange;
 };
 
+// Index range [begin, end) of nodes in a BlockBody
+struct NodeRange {
+   size_t begin{0};
+   size_t end{0};
+
+   bool empty() const {
+      return begin == end;
+   }
+};
+
+// Stops at the first node returning 'Break' or 'Continue'
+RenderStatus renderNodes(Context& context, const BlockBody& body, NodeRange range, std::string& res);
+
 }
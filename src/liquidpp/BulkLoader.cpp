@@ -0,0 +1,211 @@
+#include "BulkLoader.hpp"
+
+#include "Misc.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace liquidpp
+{
+
+namespace
+{
+constexpr char BundleMagic[4] = {'L', 'Q', 'P', 'K'};
+constexpr std::uint32_t BundleVersion = 1;
+
+bool endsWith(const std::string& str, const std::string& suffix)
+{
+   return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Files of directory (name relative to the directory) and of its subdirectories
+void listFiles(const std::string& directory, const std::string& prefix, std::vector<std::string>& res)
+{
+#if defined(_WIN32)
+   WIN32_FIND_DATAA entry;
+   auto handle = ::FindFirstFileA((directory + "\\*").c_str(), &entry);
+   enforce(handle != INVALID_HANDLE_VALUE, "Could not open template directory '" + directory + "'!");
+
+   do
+   {
+      std::string name = entry.cFileName;
+      if (name == "." || name == "..")
+         continue;
+
+      if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+         listFiles(directory + "\\" + name, prefix + name + "/", res);
+      else
+         res.push_back(prefix + name);
+   } while (::FindNextFileA(handle, &entry));
+
+   ::FindClose(handle);
+#else
+   auto dir = ::opendir(directory.c_str());
+   enforce(dir != nullptr, "Could not open template directory '" + directory + "'!");
+
+   while (auto entry = ::readdir(dir))
+   {
+      std::string name = entry->d_name;
+      if (name == "." || name == "..")
+         continue;
+
+      auto path = directory + "/" + name;
+      struct stat info;
+      if (::stat(path.c_str(), &info) != 0)
+         continue;
+
+      if (S_ISDIR(info.st_mode))
+         listFiles(path, prefix + name + "/", res);
+      else if (S_ISREG(info.st_mode))
+         res.push_back(prefix + name);
+   }
+
+   ::closedir(dir);
+#endif
+}
+
+template<typename T>
+void append(std::string& out, const T& val)
+{
+   out.append(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+template<typename T>
+T read(string_view data, size_t& pos)
+{
+   enforce(pos + sizeof(T) <= data.size(), "Template bundle is truncated!");
+
+   T res;
+   std::memcpy(&res, data.data() + pos, sizeof(T));
+   pos += sizeof(T);
+   return res;
+}
+}
+
+namespace impl
+{
+
+std::vector<BulkSource> listDirectory(const std::string& directory, const std::string& extension)
+{
+   std::vector<std::string> files;
+   listFiles(directory, std::string{}, files);
+   std::sort(files.begin(), files.end());
+
+   std::vector<BulkSource> res;
+   for (auto&& file : files)
+   {
+      if (!endsWith(file, extension))
+         continue;
+
+      BulkSource source;
+      source.name = file.substr(0, file.size() - extension.size());
+      source.path = directory + "/" + file;
+      res.push_back(std::move(source));
+   }
+
+   return res;
+}
+
+std::vector<BulkSource> readBundleIndex(std::shared_ptr<const LiteralPool> bundle)
+{
+   auto data = bundle->data();
+   size_t pos = 0;
+
+   enforce(data.size() >= sizeof(BundleMagic) && std::memcmp(data.data(), BundleMagic, sizeof(BundleMagic)) == 0,
+           "File is no template bundle!");
+   pos += sizeof(BundleMagic);
+   enforce(read<std::uint32_t>(data, pos) == BundleVersion, "Unsupported version of template bundle!");
+
+   auto cnt = read<std::uint32_t>(data, pos);
+   std::vector<BulkSource> res;
+   res.reserve(cnt);
+   for (size_t i = 0; i < cnt; i++)
+   {
+      size_t nameSize = read<std::uint32_t>(data, pos);
+      enforce(nameSize <= data.size() - pos, "Template bundle is truncated!");
+
+      BulkSource source;
+      source.name = to_string(data.substr(pos, nameSize));
+      pos += nameSize;
+
+      auto offset = read<std::uint64_t>(data, pos);
+      auto size = read<std::uint64_t>(data, pos);
+      enforce(offset <= data.size() && size <= data.size() - offset, "Template exceeds the bundle!");
+
+      auto content = data.substr(static_cast<size_t>(offset), static_cast<size_t>(size));
+      source.content = LiteralPool::slice(bundle, content, {{0, 0, content.size(), {1, 1}}});
+      res.push_back(std::move(source));
+   }
+
+   return res;
+}
+
+void runParallel(size_t count, size_t threads, const std::function<void(size_t)>& task)
+{
+   if (threads == 0)
+      threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+   threads = std::min(threads, count);
+
+   std::atomic<size_t> next{0};
+   auto worker = [&] {
+      for (size_t i = next++; i < count; i = next++)
+         task(i);
+   };
+
+   std::vector<std::thread> pool;
+   for (size_t i = 1; i < threads; i++)
+      pool.emplace_back(worker);
+
+   // the calling thread works, too
+   worker();
+
+   for (auto&& thread : pool)
+      thread.join();
+}
+
+}
+
+void writeBundle(const std::string& path, const std::map<std::string, std::string>& templates)
+{
+   enforce(templates.size() <= std::numeric_limits<std::uint32_t>::max(), "Too many templates for a bundle!");
+
+   size_t indexSize = sizeof(BundleMagic) + 2 * sizeof(std::uint32_t);
+   for (auto&& templ : templates)
+      indexSize += sizeof(std::uint32_t) + templ.first.size() + 2 * sizeof(std::uint64_t);
+
+   std::string index;
+   index.reserve(indexSize);
+   index.append(BundleMagic, sizeof(BundleMagic));
+   append(index, BundleVersion);
+   append(index, static_cast<std::uint32_t>(templates.size()));
+
+   std::uint64_t offset = indexSize;
+   for (auto&& templ : templates)
+   {
+      append(index, static_cast<std::uint32_t>(templ.first.size()));
+      index += templ.first;
+      append(index, offset);
+      append(index, static_cast<std::uint64_t>(templ.second.size()));
+      offset += templ.second.size();
+   }
+   assert(index.size() == indexSize);
+
+   std::ofstream file(path, std::ios::binary | std::ios::trunc);
+   enforce(file.good(), "Could not open file '" + path + "' for writing!");
+   file.write(index.data(), index.size());
+   for (auto&& templ : templates)
+      file.write(templ.second.data(), templ.second.size());
+   enforce(file.good(), "Could not write template bundle to '" + path + "'!");
+}
+
+}
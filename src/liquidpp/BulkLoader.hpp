@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "parser.hpp"
+
+// Loading of whole template sets (e.g. the layouts, sections and snippets of
+// a theme) from a directory or from a bundle file.
+//
+// The inputs are mapped into memory and parsed in parallel. Templates are
+// named by their path relative to the directory without the file extension
+// ("sections/header" for "<dir>/sections/header.liquid").
+//
+// A bundle packs a template set into one file:
+//   header  magic, version, number of templates
+//   index   per template: name size, name, content offset, content size
+//   content the template sources
+namespace liquidpp
+{
+
+struct BulkLoadOptions
+{
+   size_t threads{0}; // 0: one worker per hardware thread
+   std::string extension{".liquid"}; // of the files loaded from a directory
+   SourceStorage storage{SourceStorage::Reference};
+   bool compile{false};
+};
+
+struct BulkLoadError
+{
+   std::string name;
+   std::string message;
+   Exception::Position position;
+};
+
+struct BulkLoadResult
+{
+   std::map<std::string, Template> templates;
+   std::vector<BulkLoadError> errors; // sorted by template name
+};
+
+namespace impl
+{
+struct BulkSource
+{
+   std::string name;
+   std::string path; // only set for files not mapped yet
+   std::shared_ptr<const LiteralPool> content;
+};
+
+std::vector<BulkSource> listDirectory(const std::string& directory, const std::string& extension);
+std::vector<BulkSource> readBundleIndex(std::shared_ptr<const LiteralPool> bundle);
+
+// Calls task(i) for all i in [0, count) on the given number of worker threads
+void runParallel(size_t count, size_t threads, const std::function<void(size_t)>& task);
+
+template<typename TagFactoryT, typename FilterFactoryT>
+BulkLoadResult parseAll(std::vector<BulkSource> sources, const BulkLoadOptions& options)
+{
+   std::vector<boost::optional<Template>> templates(sources.size());
+   std::vector<BulkLoadError> errors;
+   std::mutex errorMutex;
+
+   runParallel(sources.size(), options.threads, [&](size_t i) {
+      auto& source = sources[i];
+      try {
+         if (!source.content)
+            source.content = LiteralPool::mapFile(source.path);
+
+         auto templ = parse<TagFactoryT, FilterFactoryT>(source.content, options.storage);
+         if (options.compile)
+            templ.compile();
+         templates[i] = std::move(templ);
+      } catch (Exception& e) {
+         std::lock_guard<std::mutex> lock(errorMutex);
+         errors.push_back({source.name, e.what(), e.position()});
+      } catch (std::exception& e) {
+         std::lock_guard<std::mutex> lock(errorMutex);
+         errors.push_back({source.name, e.what(), Exception::Position{}});
+      }
+   });
+
+   BulkLoadResult res;
+   for (size_t i = 0; i < sources.size(); i++)
+   {
+      if (templates[i])
+         res.templates.emplace(std::move(sources[i].name), std::move(*templates[i]));
+   }
+
+   std::sort(errors.begin(), errors.end(), [](auto& left, auto& right) { return left.name < right.name; });
+   res.errors = std::move(errors);
+   return res;
+}
+}
+
+// Loads all files with the configured extension in directory and its subdirectories
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+BulkLoadResult loadDirectory(const std::string& directory, const BulkLoadOptions& options = BulkLoadOptions{})
+{
+   return impl::parseAll<TagFactoryT, FilterFactoryT>(impl::listDirectory(directory, options.extension), options);
+}
+
+// Loads all templates of a bundle (the templates reference the mapped bundle)
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+BulkLoadResult loadBundle(const std::string& path, const BulkLoadOptions& options = BulkLoadOptions{})
+{
+   return impl::parseAll<TagFactoryT, FilterFactoryT>(impl::readBundleIndex(LiteralPool::mapFile(path)), options);
+}
+
+// Packs the given templates (name -> source) into a bundle file
+void writeBundle(const std::string& path, const std::map<std::string, std::string>& templates);
+
+}
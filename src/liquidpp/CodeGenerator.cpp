@@ -0,0 +1,614 @@
+#include "CodeGenerator.hpp"
+
+#include "Template.hpp"
+#include "Variable.hpp"
+#include "tags/Assign.hpp"
+#include "tags/Block.hpp"
+#include "tags/Capture.hpp"
+#include "tags/Case.hpp"
+#include "tags/Comment.hpp"
+#include "tags/Conditional.hpp"
+#include "tags/Cycle.hpp"
+#include "tags/For.hpp"
+#include "tags/Increment.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <limits>
+#include <locale>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <boost/variant/get.hpp>
+
+namespace liquidpp
+{
+
+namespace
+{
+// Target of 'break' and 'continue' in the generated code
+enum class Flow
+{
+   Document, // no enclosing loop (throwing like Template::operator())
+   Loop,     // the enclosing 'for' statement
+   Function  // a lambda returning the RenderStatus (body of 'capture')
+};
+
+const char* operatorName(Expression::Operator operator_)
+{
+   switch (operator_)
+   {
+   case Expression::Operator::Equal:
+      return "Equal";
+   case Expression::Operator::NotEqual:
+      return "NotEqual";
+   case Expression::Operator::Less:
+      return "Less";
+   case Expression::Operator::LessEqual:
+      return "LessEqual";
+   case Expression::Operator::Greater:
+      return "Greater";
+   case Expression::Operator::GreaterEqual:
+      return "GreaterEqual";
+   case Expression::Operator::Contains:
+      return "Contains";
+   case Expression::Operator::And:
+      return "And";
+   case Expression::Operator::Or:
+      return "Or";
+   }
+   return "Equal";
+}
+
+bool containsControlFlow(const BlockBody& body)
+{
+   for (auto&& node : body.nodeList)
+   {
+      if (type(node) != NodeType::Tag)
+         continue;
+
+      auto tag = boost::get<std::unique_ptr<const IRenderable>>(node).get();
+      if (dynamic_cast<const Break*>(tag) || dynamic_cast<const Continue*>(tag))
+         return true;
+      if (dynamic_cast<const Comment*>(tag))
+         continue;
+      if (auto block = dynamic_cast<const Block*>(tag))
+      {
+         if (containsControlFlow(block->body))
+            return true;
+      }
+   }
+
+   return false;
+}
+
+std::vector<std::string> splitQualifiedName(const std::string& name)
+{
+   std::vector<std::string> res;
+   size_t begin = 0;
+   for (auto idx = name.find("::"); idx != std::string::npos; idx = name.find("::", begin))
+   {
+      res.push_back(name.substr(begin, idx - begin));
+      begin = idx + 2;
+   }
+   res.push_back(name.substr(begin));
+   return res;
+}
+}
+
+struct CodeGenerator::Writer
+{
+   std::string body;
+   std::string constants;
+   size_t depth{1};
+
+   // members of the constants by type and initializer
+   std::map<std::string, std::string> constantNames;
+
+   void line(const std::string& code)
+   {
+      body.append(depth * 3, ' ');
+      body += code;
+      body += '\n';
+   }
+
+   void open()
+   {
+      line("{");
+      depth++;
+   }
+
+   void close()
+   {
+      depth--;
+      line("}");
+   }
+
+   // C++ string literal, split after line breaks
+   std::string quote(string_view str) const
+   {
+      std::string res{"\""};
+      const size_t cnt = str.size();
+      for (size_t i = 0; i < cnt; i++)
+      {
+         auto c = str[i];
+         switch (c)
+         {
+         case '"':
+            res += "\\\"";
+            break;
+         case '\\':
+            res += "\\\\";
+            break;
+         case '?': // no trigraphs
+            res += "\\?";
+            break;
+         case '\t':
+            res += "\\t";
+            break;
+         case '\r':
+            res += "\\r";
+            break;
+         case '\n':
+            res += "\\n";
+            if (i + 1 < cnt)
+               res += "\"\n" + std::string((depth + 1) * 3, ' ') + "\"";
+            break;
+         default:
+            if (c >= 0x20 && c < 0x7f)
+               res += c;
+            else
+            {
+               char escaped[5];
+               std::snprintf(escaped, sizeof(escaped), "\\%03o", static_cast<unsigned char>(c));
+               res += escaped;
+            }
+         }
+      }
+      res += '"';
+      return res;
+   }
+
+   std::string view(string_view str) const
+   {
+      return "liquidpp::string_view{" + quote(str) + ", " + std::to_string(str.size()) + "}";
+   }
+
+   // Name of the member of the constants built by init
+   std::string constant(const std::string& type, char prefix, const std::string& init, bool braced = false)
+   {
+      auto& name = constantNames[type + ' ' + init];
+      if (name.empty())
+      {
+         name = prefix + std::to_string(constantNames.size() - 1);
+         constants += "   const " + type + " " + name + (braced ? "{" + init + "};\n" : " = " + init + ";\n");
+      }
+      return name;
+   }
+
+   std::string keyInit(const Key& key) const
+   {
+      if (key.isIndex())
+         return "liquidpp::Key{std::size_t{" + std::to_string(key.index()) + "}}";
+      if (key.isIndexVariable())
+         return "liquidpp::Key{" + pathInit(key.indexVariable()) + "}";
+      return "liquidpp::Key{" + quote(key.name()) + "}";
+   }
+
+   std::string pathInit(PathRef path) const
+   {
+      std::string res{"liquidpp::compiled::path({"};
+      const auto cnt = path.size();
+      for (decltype(path.size()) i = 0; i < cnt; i++)
+      {
+         if (i != 0)
+            res += ", ";
+         res += keyInit(path[i]);
+      }
+      return res + "})";
+   }
+
+   std::string valueInit(const Value& val, string_view errorPart) const
+   {
+      if (val.isBool())
+         return val.isTrue() ? "liquidpp::Value{true}" : "liquidpp::Value{false}";
+      if (val.isIntegral())
+      {
+         auto i = val.integralValue();
+         if (i == std::numeric_limits<std::intmax_t>::min())
+            return "liquidpp::Value{std::numeric_limits<std::intmax_t>::min()}";
+         return "liquidpp::Value{std::intmax_t{" + std::to_string(i) + "}}";
+      }
+      if (val.isFloatingPoint() && std::isfinite(val.floatingPointValue()))
+      {
+         std::ostringstream oss;
+         oss.imbue(std::locale::classic());
+         oss << std::setprecision(std::numeric_limits<double>::max_digits10) << val.floatingPointValue();
+         auto res = oss.str();
+         if (res.find_first_of(".e") == std::string::npos)
+            res += ".0";
+         return "liquidpp::Value{" + res + "}";
+      }
+      if (val.isStringType())
+         return "liquidpp::Value::reference(" + view(*val) + ")";
+
+      throw Exception("Literal can't be compiled to C++!", errorPart);
+   }
+
+   std::string tokenInit(const Expression::Token& token, string_view errorPart) const
+   {
+      switch (token.which())
+      {
+      case 0:
+         return std::string{"liquidpp::Expression::Operator::"} + operatorName(boost::get<Expression::Operator>(token));
+      case 1:
+         return valueInit(boost::get<Value>(token), errorPart);
+      default:
+         return pathInit(boost::get<Path>(token));
+      }
+   }
+
+   std::string tokensInit(const std::vector<Expression::Token>& tokens, string_view errorPart) const
+   {
+      std::string res{"{"};
+      for (auto&& token : tokens)
+      {
+         if (res.size() != 1)
+            res += ", ";
+         res += tokenInit(token, errorPart);
+      }
+      return res + "}";
+   }
+
+   std::string key(string_view name)
+   {
+      return "k." + constant("liquidpp::Key", 'n', quote(name), true);
+   }
+
+   std::string path(PathRef path)
+   {
+      return "k." + constant("liquidpp::Path", 'p', pathInit(path));
+   }
+
+   std::string token(const Expression::Token& token, string_view errorPart)
+   {
+      // paths and values are shared with the other constants
+      std::string init;
+      if (token.which() == 2)
+         init = path(boost::get<Path>(token)).substr(2);
+      else if (token.which() == 1)
+         init = constant("liquidpp::Value", 'v', valueInit(boost::get<Value>(token), errorPart));
+      else
+         init = tokenInit(token, errorPart);
+      return "k." + constant("liquidpp::Expression::Token", 't', init);
+   }
+
+   std::string filter(const Expression::FilterData& filter, string_view errorPart)
+   {
+      std::string init{"liquidpp::compiled::filter(" + quote(filter.name)};
+      if (!filter.args.empty())
+         init += ", " + tokensInit({filter.args.begin(), filter.args.end()}, errorPart);
+      return "k." + constant("liquidpp::Expression::FilterData", 'f', init + ")");
+   }
+
+   std::string expression(const Expression& expr, string_view errorPart)
+   {
+      return "k." + constant("liquidpp::Expression", 'e',
+                             "liquidpp::compiled::expression(" + tokensInit(expr.tokens, errorPart) + ")");
+   }
+
+   // Tag constructed from its source and rendered as is
+   std::string tag(const char* type, const Tag& tag)
+   {
+      return "k." + constant(type, 'g', "liquidpp::UnevaluatedTag{" + view(tag.name) + ", " + view(tag.value) + "}",
+                             true);
+   }
+
+   // Code reading the value of the token
+   std::string valueOf(const Expression::Token& t, string_view errorPart)
+   {
+      if (t.which() == 2)
+         return "c.get(" + path(boost::get<Path>(t)) + ")";
+      if (t.which() == 1)
+         return "k." + constant("liquidpp::Value", 'v', valueInit(boost::get<Value>(t), errorPart));
+      return "liquidpp::Expression::value(c, " + token(t, errorPart) + ")";
+   }
+
+   // Declares the value 'v' of the token after applying the filters
+   void filteredValue(const Expression::Token& t, const Expression::FilterChain& filterChain, string_view errorPart)
+   {
+      line("liquidpp::Value v = " + valueOf(t, errorPart) + ";");
+      const auto filterPath = t.which() == 2 ? path(boost::get<Path>(t)) : std::string{"liquidpp::PathRef{}"};
+      for (auto&& f : filterChain)
+         line("liquidpp::Expression::applyFilter(c, v, " + filterPath + ", " + filter(f, errorPart) + ");");
+   }
+
+   void control(RenderStatus status, Flow flow)
+   {
+      const bool isBreak = status == RenderStatus::Break;
+      switch (flow)
+      {
+      case Flow::Document:
+         line(isBreak ? "throw liquidpp::DoBreak{};" : "throw liquidpp::DoContinue{};");
+         break;
+      case Flow::Loop:
+         line(isBreak ? "break;" : "continue;");
+         break;
+      case Flow::Function:
+         line(isBreak ? "return liquidpp::RenderStatus::Break;" : "return liquidpp::RenderStatus::Continue;");
+         break;
+      }
+   }
+
+   void nodes(const BlockBody& body, NodeRange range, Flow flow)
+   {
+      for (auto i = range.begin; i < range.end; i++)
+         node(body.nodeList[i], flow);
+   }
+
+   void node(const Node& node, Flow flow)
+   {
+      switch (type(node))
+      {
+      case NodeType::String:
+      {
+         auto str = boost::get<string_view>(node);
+         if (!str.empty())
+            line("out.append(" + quote(str) + ", " + std::to_string(str.size()) + ");");
+         break;
+      }
+      case NodeType::Variable:
+         variable(boost::get<Variable>(node));
+         break;
+      case NodeType::UnevaluatedTag:
+         break; // renders nothing
+      case NodeType::Tag:
+         tag(*boost::get<std::unique_ptr<const IRenderable>>(node), flow);
+         break;
+      }
+   }
+
+   void variable(const Variable& var)
+   {
+      if (!var.filterChain || var.filterChain->empty())
+      {
+         line("liquidpp::Variable::append(out, " + valueOf(var.variable, {}) + ");");
+         return;
+      }
+
+      open();
+      filteredValue(var.variable, *var.filterChain, {});
+      line("liquidpp::Variable::append(out, v);");
+      close();
+   }
+
+   void tag(const IRenderable& renderable, Flow flow)
+   {
+      if (auto ifTag = dynamic_cast<const If*>(&renderable))
+         conditional(*ifTag, flow);
+      else if (auto unlessTag = dynamic_cast<const Unless*>(&renderable))
+         conditional(*unlessTag, flow);
+      else if (auto forTag = dynamic_cast<const For*>(&renderable))
+         loop(*forTag, flow);
+      else if (auto caseTag = dynamic_cast<const Case*>(&renderable))
+         branches(*caseTag, flow);
+      else if (auto captureTag = dynamic_cast<const Capture*>(&renderable))
+         capture(*captureTag, flow);
+      else if (auto assignTag = dynamic_cast<const Assign*>(&renderable))
+         assign(*assignTag);
+      else if (dynamic_cast<const Comment*>(&renderable))
+         return;
+      else if (dynamic_cast<const Break*>(&renderable))
+         control(RenderStatus::Break, flow);
+      else if (dynamic_cast<const Continue*>(&renderable))
+         control(RenderStatus::Continue, flow);
+      else if (auto incrementTag = dynamic_cast<const Increment*>(&renderable))
+         line(tag("liquidpp::Increment", *incrementTag) + ".render(c, out);");
+      else if (auto decrementTag = dynamic_cast<const Decrement*>(&renderable))
+         line(tag("liquidpp::Decrement", *decrementTag) + ".render(c, out);");
+      else if (auto cycleTag = dynamic_cast<const Cycle*>(&renderable))
+         line(tag("liquidpp::Cycle", *cycleTag) + ".render(c, out);");
+      else
+      {
+         auto unknown = dynamic_cast<const Tag*>(&renderable);
+         throw Exception("Tag can't be compiled to C++!", unknown ? unknown->name : string_view{});
+      }
+   }
+
+   template<bool Inverted>
+   void conditional(const Conditional<Inverted>& tag, Flow flow)
+   {
+      const size_t cnt = tag.branches.size();
+      for (size_t i = 0; i < cnt; i++)
+      {
+         auto& branch = tag.branches[i];
+         if (i == 0)
+            line(std::string{"if ("} + (Inverted ? "!" : "") + "static_cast<bool>(" + expression(tag.expression, tag.value)
+                 + "(c)))");
+         else if (branch.condition)
+            line("else if (static_cast<bool>(" + expression(*branch.condition, tag.value) + "(c)))");
+         else
+            line("else");
+
+         open();
+         nodes(tag.body, branch.nodes, flow);
+         close();
+
+         // branches behind 'else' are never rendered
+         if (i != 0 && !branch.condition)
+            break;
+      }
+   }
+
+   void loop(const For& forTag, Flow flow)
+   {
+      auto header = tag("liquidpp::For", forTag);
+
+      open();
+      line("const auto loop = " + header + ".evaluate(c);");
+      if (!forTag.elseBody.empty())
+      {
+         line("if (loop.limit == 0)");
+         open();
+         nodes(forTag.body, forTag.elseBody, flow);
+         close();
+         line("else");
+      }
+      else
+         line("if (loop.limit != 0)");
+
+      open();
+      line("liquidpp::For::Watchdog watchdog{c, out, " + header + ".name};");
+      line("liquidpp::For::Scope scope{" + header + ", c, loop};");
+      line("for (std::size_t i = 0; i < loop.limit; watchdog.check(i++))");
+      open();
+      line("if (!scope.bind(i))");
+      line("   break;");
+      line("auto& c = scope.context();");
+      nodes(forTag.body, forTag.loopBody, Flow::Loop);
+      close();
+      close();
+      close();
+   }
+
+   // Renders from the first matching 'when' (or 'else') up to the next one not
+   // matching (like Case::renderWithStatus())
+   void branches(const Case& caseTag, Flow flow)
+   {
+      if (caseTag.branches.empty())
+         return;
+
+      open();
+      line("const liquidpp::Value value = " + valueOf(caseTag.valueToken, caseTag.value) + ";");
+      line("bool active = false;");
+      line("bool done = false;");
+      for (auto&& branch : caseTag.branches)
+      {
+         line("if (!done)");
+         open();
+         if (branch.isElse())
+            line("if (!active)");
+         else
+         {
+            std::string matches;
+            for (auto&& t : branch.values)
+            {
+               if (!matches.empty())
+                  matches += " || ";
+               matches += "value == " + valueOf(t, caseTag.value);
+            }
+            line("if (" + matches + ")");
+         }
+         open();
+         line("active = true;");
+         nodes(caseTag.body, branch.nodes, flow);
+         close();
+         line("else if (active)");
+         line("   done = true;");
+         close();
+      }
+      close();
+   }
+
+   // 'break' and 'continue' stop capturing, the captured output is assigned
+   void capture(const Capture& captureTag, Flow flow)
+   {
+      const bool controlFlow = containsControlFlow(captureTag.body);
+
+      open();
+      line("std::string captured;");
+      line(controlFlow ? "auto status = [&](std::string& out) -> liquidpp::RenderStatus" : "[&](std::string& out)");
+      open();
+      nodes(captureTag.body, NodeRange{0, captureTag.body.nodeList.size()}, Flow::Function);
+      if (controlFlow)
+         line("return liquidpp::RenderStatus::Normal;");
+      depth--;
+      line("}(captured);");
+      line("c.documentScopeContext().set(" + key(captureTag.variableName) + ", std::move(captured));");
+
+      if (controlFlow)
+      {
+         if (flow == Flow::Document)
+            line("liquidpp::enforceNormal(status);");
+         else
+         {
+            line("if (status == liquidpp::RenderStatus::Break)");
+            depth++;
+            control(RenderStatus::Break, flow);
+            depth--;
+            line("if (status == liquidpp::RenderStatus::Continue)");
+            depth++;
+            control(RenderStatus::Continue, flow);
+            depth--;
+         }
+      }
+      close();
+   }
+
+   void assign(const Assign& assignTag)
+   {
+      open();
+      filteredValue(assignTag.assignment, assignTag.filterChain, assignTag.value);
+      line("liquidpp::Assign::store(c, " + key(assignTag.variableName) + ", v, " + token(assignTag.assignment, assignTag.value)
+           + ");");
+      close();
+   }
+};
+
+CodeGenerator::CodeGenerator(const Template& templ, std::string name)
+   : mName(std::move(name))
+{
+   enforce(!mName.empty(), "Missing name of the render function!");
+
+   Writer writer;
+   writer.nodes(templ.root, NodeRange{0, templ.root.nodeList.size()}, Flow::Document);
+   mBody = std::move(writer.body);
+   mConstants = std::move(writer.constants);
+}
+
+std::string CodeGenerator::header() const
+{
+   auto names = splitQualifiedName(mName);
+
+   std::string res{"// Generated by liquidpp-compile, do not edit\n"
+                   "#pragma once\n\n"
+                   "#include <string>\n\n"
+                   "namespace liquidpp\n{\nclass Context;\n}\n\n"};
+   for (size_t i = 0; i + 1 < names.size(); i++)
+      res += "namespace " + names[i] + "\n{\n";
+   res += "std::string " + names.back() + "(const liquidpp::Context& context);\n";
+   for (size_t i = 0; i + 1 < names.size(); i++)
+      res += "}\n";
+   return res;
+}
+
+std::string CodeGenerator::source(const std::string& headerName) const
+{
+   auto names = splitQualifiedName(mName);
+
+   std::string res{"// Generated by liquidpp-compile, do not edit\n"
+                   "#include \"" + headerName + "\"\n\n"
+                   "#include <liquidpp/Compiled.hpp>\n\n"};
+   if (!mConstants.empty())
+   {
+      res += "namespace\n{\nstruct Constants\n{\n" + mConstants + "};\n\n"
+             "const Constants& constants()\n{\n   static const Constants k;\n   return k;\n}\n}\n\n";
+   }
+
+   for (size_t i = 0; i + 1 < names.size(); i++)
+      res += "namespace " + names[i] + "\n{\n";
+   res += "std::string " + names.back() + "(const liquidpp::Context& context)\n{\n";
+   if (!mConstants.empty())
+      res += "   auto& k = constants();\n";
+   res += "   std::string out;\n"
+          "   liquidpp::Context c{&context};\n"
+          + mBody
+          + "   return out;\n}\n";
+   for (size_t i = 0; i + 1 < names.size(); i++)
+      res += "}\n";
+   return res;
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+
+#include "config.h"
+
+namespace liquidpp
+{
+
+struct Template;
+
+// Translates a parsed template to a C++ render function (see the
+// liquidpp-compile tool and liquidpp_compile_templates() of the CMake build)
+//
+//    std::string <name>(const liquidpp::Context& context);
+//
+// rendering like Template::operator(). Literals are inlined, paths are split
+// and filters are resolved once (see compiled::filter()), loops are native
+// 'for' statements binding the elements with For::Scope. The variables are
+// looked up by name (like templates without bound slots), errors of the
+// rendering have no positions. Tags without translation (e.g. custom tags)
+// throw an Exception.
+class CodeGenerator
+{
+public:
+   // name may be qualified by namespaces (e.g. "emails::welcome")
+   CodeGenerator(const Template& templ, std::string name);
+
+   // Declaration of the render function
+   std::string header() const;
+
+   // Definition of the render function, including the header of the given name
+   std::string source(const std::string& headerName) const;
+
+private:
+   struct Writer;
+
+   std::string mName;
+   std::string mBody;
+   std::string mConstants;
+};
+
+}
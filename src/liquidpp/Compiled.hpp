@@ -0,0 +1,52 @@
+#pragma once
+
+#include <initializer_list>
+#include <string>
+
+#include "config.h"
+#include "Context.hpp"
+#include "Expression.hpp"
+#include "FilterFactory.hpp"
+#include "Variable.hpp"
+#include "tags/Assign.hpp"
+#include "tags/Cycle.hpp"
+#include "tags/For.hpp"
+#include "tags/Increment.hpp"
+
+namespace liquidpp
+{
+
+// Support of the render functions generated by CodeGenerator, their constants
+// are built once with these functions
+namespace compiled
+{
+
+inline Path path(std::initializer_list<Key> keys)
+{
+   Path res;
+   res.assign(keys.begin(), keys.end());
+   bindBuiltinProperties(res);
+   return res;
+}
+
+inline Expression expression(std::initializer_list<Expression::Token> tokens)
+{
+   Expression res;
+   res.tokens.assign(tokens.begin(), tokens.end());
+   res.compile();
+   return res;
+}
+
+// Resolves the filter once, the generated code applies it directly
+inline Expression::FilterData filter(string_view name, std::initializer_list<Expression::Token> args = {})
+{
+   Expression::FilterData res;
+   res.name = name;
+   res.function = FilterFactory{}(name);
+   enforce(static_cast<bool>(res), "Unknown filter!");
+   res.args.assign(args.begin(), args.end());
+   return res;
+}
+
+}
+}
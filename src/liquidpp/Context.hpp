@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <deque>
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -15,12 +19,44 @@
 
 #include "Accessor.hpp"
 #include "Key.hpp"
+#include "Misc.hpp"
+#include "RangeIndex.hpp"
 
 #include "accessors/Accessors.hpp"
 
 #include "external/short_alloc.h"
 
 namespace liquidpp {
+
+// Counters of one rendering of a loop, 'forloop' paths resolved at parse time
+// read them directly (see Context::setLoopCounters())
+struct LoopCounters {
+  size_t idx{0};
+  size_t size{0};
+
+  Value get(LoopProperty property) const {
+    switch (property) {
+    case LoopProperty::First:
+      return toValue(idx == 0);
+    case LoopProperty::Index:
+      return toValue(idx + 1);
+    case LoopProperty::Index0:
+      return toValue(idx);
+    case LoopProperty::Last:
+      return toValue(idx + 1 == size);
+    case LoopProperty::Length:
+      return toValue(size);
+    case LoopProperty::Rindex:
+      return toValue(size - idx);
+    case LoopProperty::Rindex0:
+      return toValue(size - idx - 1);
+    case LoopProperty::None:
+      break;
+    }
+    return ValueTag::Null;
+  }
+};
+
 class Context {
 private:
   const Context *mParent{nullptr};
@@ -45,11 +81,100 @@ private:
 #else
   StorageT mValues{ StorageAllocator(mArena) };
 #endif
+
+public:
+  // Immutable table of the values of a context (see freeze()): open addressing
+  // over an array of (hash, index) buckets, the names are only compared on
+  // equal hashes
+  class Frozen {
+  public:
+    size_t size() const { return mEntries.size(); }
+
+    const MapValue *find(string_view name) const {
+      return find(name, hashName(name));
+    }
+
+    // Uses the hash precomputed by the key
+    const MapValue *find(const Key &key) const {
+      return find(key.name(), key.hash());
+    }
+
+  private:
+    friend class Context;
+
+    const MapValue *find(string_view name, std::uint64_t h) const {
+      for (size_t i = h & mMask;; i = (i + 1) & mMask) {
+        auto &bucket = mBuckets[i];
+        if (bucket.index == 0)
+          return nullptr;
+
+        if (bucket.hash == static_cast<std::uint32_t>(h)) {
+          auto &entry = mEntries[bucket.index - 1];
+          if (string_view{entry.first} == name)
+            return &entry.second;
+        }
+      }
+    }
+
+    struct Bucket {
+      std::uint32_t hash{0};
+      std::uint32_t index{0}; // index in mEntries + 1 (0 for empty buckets)
+    };
+
+    void build() {
+      size_t cnt = 2;
+      while (cnt < mEntries.size() * 2)
+        cnt *= 2;
+      mBuckets.assign(cnt, Bucket{});
+      mMask = cnt - 1;
+
+      for (size_t idx = 0; idx < mEntries.size(); idx++) {
+        const auto h = hashName(mEntries[idx].first);
+        size_t i = h & mMask;
+        while (mBuckets[i].index != 0)
+          i = (i + 1) & mMask;
+        mBuckets[i] = Bucket{static_cast<std::uint32_t>(h),
+                             static_cast<std::uint32_t>(idx + 1)};
+      }
+    }
+
+    std::vector<std::pair<std::string, MapValue>> mEntries;
+    std::vector<Bucket> mBuckets;
+    size_t mMask{0};
+
+    std::locale mLocale;
+    size_t mMaxOutputSize{0};
+    size_t mMinOutputPer1024Loops{0};
+    size_t mMinParallelLoopSize{0};
+  };
+
+private:
+  std::shared_ptr<const Frozen> mFrozen;
   ValueGetter mAnonymous;
   boost::optional<std::locale> mLocale{std::locale()};
 
+  // Template local variables of the document scope indexed by the slots bound
+  // at parse time (see SlotBinder), unset slots are looked up by name
+  std::vector<boost::optional<MapValue>> mSlots;
+
+  // Counters of the loops whose 'forloop' is stored in the slot
+  std::vector<const LoopCounters *> mLoopCounters;
+
+  // Links of the document scope that are referenced by loop elements (see
+  // pinLink())
+  std::deque<ValueGetter> mPinnedLinks;
+
+  // Ranges checked by 'contains' in this rendering (see rangeIndex())
+  struct RangeIndexEntry {
+    const void *root;
+    Path path;
+    std::unique_ptr<RangeIndex> index;
+  };
+  std::vector<RangeIndexEntry> mRangeIndices;
+
   size_t mMaxOutputSize{8 * 1024 * 1024};
   size_t mMinOutputPer1024Loops{mMaxOutputSize / 4};
+  size_t mMinParallelLoopSize{0};
   size_t mRecursiveDepth{0};
 
 public:
@@ -58,7 +183,8 @@ public:
   explicit Context(const Context *parent)
       : mParent(parent), mDocumentScopeContext(this), mLocale(boost::none),
         mMaxOutputSize(parent->mMaxOutputSize),
-        mMinOutputPer1024Loops{parent->mMinOutputPer1024Loops} {
+        mMinOutputPer1024Loops{parent->mMinOutputPer1024Loops},
+        mMinParallelLoopSize{parent->mMinParallelLoopSize} {
     assert(mParent->mDocumentScopeContext == nullptr);
   }
 
@@ -66,10 +192,30 @@ public:
       : mParent(parent), mDocumentScopeContext(mParent->mDocumentScopeContext),
         mLocale(boost::none), mMaxOutputSize(parent->mMaxOutputSize),
         mMinOutputPer1024Loops{parent->mMinOutputPer1024Loops},
+        mMinParallelLoopSize{parent->mMinParallelLoopSize},
         mRecursiveDepth{parent->mRecursiveDepth} {
     assert(mDocumentScopeContext != nullptr);
   }
 
+  // Document scope for rendering a part of a template on another thread (see
+  // For::renderParallel()): reads fall back to parent, which must not be
+  // changed while the scope exists, template local variables are stored in
+  // own slots. Loops are not parallelized again.
+  struct Detached {};
+  Context(const Context &parent, Detached)
+      : mParent(&parent), mDocumentScopeContext(this), mLocale(boost::none),
+        mMaxOutputSize(parent.mMaxOutputSize),
+        mMinOutputPer1024Loops{parent.mMinOutputPer1024Loops},
+        mRecursiveDepth{parent.mRecursiveDepth} {}
+
+  // Root context layering over frozen values (see freeze()), the values set
+  // on the context shadow them
+  explicit Context(std::shared_ptr<const Frozen> frozen)
+      : mFrozen(std::move(frozen)), mLocale(mFrozen->mLocale),
+        mMaxOutputSize(mFrozen->mMaxOutputSize),
+        mMinOutputPer1024Loops{mFrozen->mMinOutputPer1024Loops},
+        mMinParallelLoopSize{mFrozen->mMinParallelLoopSize} {}
+
   Context(std::initializer_list<StorageT::value_type> entries)
       : 
 #ifdef _MSC_VER
@@ -100,8 +246,58 @@ public:
 
   void setMinOutputPer1024Loops(size_t val) { mMinOutputPer1024Loops = val; }
 
+  // Loops without side effects and with at least this number of iterations
+  // are rendered on the worker pool (0: all loops are rendered serially). The
+  // values of the context are read concurrently then.
+  size_t minParallelLoopSize() const { return mMinParallelLoopSize; }
+
+  void setMinParallelLoopSize(size_t val) { mMinParallelLoopSize = val; }
+
   size_t &recursiveDepth() { return mRecursiveDepth; }
 
+  void setSlotCount(size_t cnt) {
+    mSlots.resize(cnt);
+    mLoopCounters.resize(cnt);
+  }
+
+  // Sets the counters read by the resolved 'forloop' paths of a loop, returns
+  // the previous ones
+  const LoopCounters *setLoopCounters(SlotIndex forloopSlot,
+                                      const LoopCounters *counters) {
+    auto &loopCounters = documentScopeContext().mLoopCounters;
+    if (forloopSlot >= loopCounters.size())
+      loopCounters.resize(forloopSlot + 1);
+    std::swap(loopCounters[forloopSlot], counters);
+    return counters;
+  }
+
+  // Copies the values set on this root context (including the frozen values
+  // it layers over) and its settings to an immutable table. The table can be
+  // shared by any number of contexts and threads, e.g. for globals that are
+  // the same for all requests.
+  std::shared_ptr<const Frozen> freeze() const {
+    assert(mParent == nullptr);
+
+    auto res = std::make_shared<Frozen>();
+    for (auto &&entry : mValues)
+      res->mEntries.emplace_back(entry.first, entry.second);
+    if (mFrozen) {
+      for (auto &&entry : mFrozen->mEntries) {
+        if (mValues.find(entry.first) == mValues.end())
+          res->mEntries.push_back(entry);
+      }
+    }
+    enforce(res->mEntries.size() < std::numeric_limits<std::uint32_t>::max(),
+            "Too many values to freeze!");
+
+    res->build();
+    res->mLocale = locale();
+    res->mMaxOutputSize = mMaxOutputSize;
+    res->mMinOutputPer1024Loops = mMinOutputPer1024Loops;
+    res->mMinParallelLoopSize = mMinParallelLoopSize;
+    return res;
+  }
+
   Value get(string_view pathStr) const {
     auto p = toPath(pathStr);
     return get(p);
@@ -112,37 +308,20 @@ private:
     if (ptr == MapValuePtr{})
        return Value{};
      
-    if (ptr.which() == 1) {
-      auto &valueGetter = *boost::get<const ValueGetter*>(ptr);
-      auto res = valueGetter(path);
-      if (res == ValueTag::SubValue) {
-        auto lastKey = popLastKey(path);
-
-        if (lastKey == "size") {
-          Value parent = valueGetter(path);
-          return toValue(parent.size());
-        }
+    auto property = path.empty() ? BuiltinProperty::None
+                                 : path[path.size() - 1].builtinProperty();
 
-        if (lastKey == "first" || lastKey == "last") {
-          Value parent = valueGetter(path);
-          if (parent.isRange()) {
-            auto &range = parent.range();
-            auto size = range.size();
-            if (size == 0)
-              return ValueTag::Null;
-
-            auto idx = range.index(lastKey == "last" ? size - 1 : 0);
-            auto elementPath = path + Key{idx};
-            return valueGetter(elementPath);
-          }
-        }
-      }
-      return res;
-    }
+    if (ptr.which() == 1)
+      return getFromGetter(*boost::get<const ValueGetter*>(ptr), path, 0);
 
     auto& val = *boost::get<const Value*>(ptr);
     if (!path.empty()) {
-      if (path.size() == 1 && path[0] == "size")
+      if (path.size() == 1 && val.isRange() &&
+          property != BuiltinProperty::None)
+        return builtinProperty(nullptr, path.subspan(0, 0), val.range(),
+                               property);
+
+      if (path.size() == 1 && property == BuiltinProperty::Size)
         return toValue(val.toString().size());
 
       return ValueTag::SubValue;
@@ -150,12 +329,91 @@ private:
 
     return val.asReference();
   }
+
+  // Resolves the built-in properties from the key 'from' on: ranges are asked
+  // once, other values may have keys with the same names
+  static Value getFromGetter(const ValueGetter &valueGetter, PathRef path,
+                             size_t from) {
+    const size_t cnt = path.size();
+    for (auto k = from; k < cnt; k++) {
+      auto property = path[k].builtinProperty();
+      if (property == BuiltinProperty::None)
+        continue;
+
+      auto parentPath = path.subspan(0, k);
+      Value parent = valueGetter(parentPath);
+      if (parent.isRange()) {
+        auto &range = parent.range();
+        if (k + 1 == cnt)
+          return builtinProperty(&valueGetter, parentPath, range, property);
+
+        if (range.size() == 0)
+          return ValueTag::Null;
+        if (range.usesInlineValues())
+          return ValueTag::SubValue;
+
+        auto i = property == BuiltinProperty::Last ? range.size() - 1 : 0;
+        auto elementPath = parentPath + Key{range.index(i)};
+        elementPath.insert(elementPath.end(), path.begin() + k + 1,
+                           path.end());
+        return getFromGetter(valueGetter, elementPath, k + 1);
+      }
+
+      if (k + 1 == cnt) {
+        auto res = valueGetter(path);
+        if (res == ValueTag::SubValue && property == BuiltinProperty::Size)
+          return toValue(parent.size());
+        return res;
+      }
+    }
+
+    return valueGetter(path);
+  }
+
+  // Size, first or last element of a range, elements of ranges without
+  // inline values are read by valueGetter
+  static Value builtinProperty(const ValueGetter *valueGetter,
+                               PathRef rangePath, const RangeDefinition &range,
+                               BuiltinProperty property) {
+    auto size = range.size();
+    if (property == BuiltinProperty::Size)
+      return toValue(size);
+    if (size == 0)
+      return ValueTag::Null;
+
+    auto i = property == BuiltinProperty::Last ? size - 1 : 0;
+    if (range.usesInlineValues())
+      return Value{range.inlineValue(i)};
+    if (valueGetter == nullptr)
+      return ValueTag::SubValue;
+
+    auto elementPath = rangePath + Key{range.index(i)};
+    return (*valueGetter)(elementPath);
+  }
   
+  static MapValuePtr toPtr(const MapValue& value)
+  {
+    if (value.which() == 0)
+      return &boost::get<Value>(value);
+    return &boost::get<ValueGetter>(value);
+  }
+
   inline MapValuePtr getPtr(PathRef& path) const
   {
     if (path.empty())
       throw std::runtime_error("Can't handle empty path!");
 
+    auto slot = path[0].slot();
+    if (slot != NoSlot && mDocumentScopeContext != nullptr)
+    {
+      auto& slots = mDocumentScopeContext->mSlots;
+      if (slot < slots.size() && slots[slot])
+      {
+        popKey(path);
+        return toPtr(*slots[slot]);
+      }
+    }
+
     auto itr = mValues.find(path[0].name());
     if (itr != mValues.end())
     {
@@ -172,6 +430,13 @@ private:
        }
     }
 
+    if (mFrozen) {
+      if (auto value = mFrozen->find(path[0])) {
+        popKey(path);
+        return toPtr(*value);
+      }
+    }
+
     if (mAnonymous) {
       auto res = mAnonymous(path);
       if (res != ValueTag::Null)
@@ -202,8 +467,22 @@ private:
     return getFromValues(ptr, path);
   }
 
+  const LoopCounters *loopCounters(SlotIndex forloopSlot) const {
+    if (mDocumentScopeContext == nullptr)
+      return nullptr;
+    auto &loopCounters = mDocumentScopeContext->mLoopCounters;
+    return forloopSlot < loopCounters.size() ? loopCounters[forloopSlot]
+                                             : nullptr;
+  }
+
 public:
   Value get(PathRef path) const {
+     if (path.size() == 2 && path[1].loopProperty() != LoopProperty::None)
+     {
+        if (auto counters = loopCounters(path[0].slot()))
+           return counters->get(path[1].loopProperty());
+     }
+
      if (hasIndexVariables(path))
      {
         Path pathCopy(path.begin(), path.end());
@@ -221,7 +500,49 @@ public:
      return getImpl(path);
   }
 
+  // Index for 'contains' checks of range, the value at path (see
+  // Expression::matches()). The index is built when the range is checked the
+  // second time (nullptr before) and kept by the document scope until a
+  // variable with the name path starts with is set.
+  const RangeIndex *rangeIndex(PathRef path, const RangeDefinition &range) {
+    if (mDocumentScopeContext == nullptr || path.empty() ||
+        hasIndexVariables(path))
+      return nullptr;
+
+    PathRef subPath = path;
+    auto ptr = getPtr(subPath);
+    if (ptr == MapValuePtr{})
+      return nullptr;
+    const void *root =
+        ptr.which() == 0
+            ? static_cast<const void *>(boost::get<const Value *>(ptr))
+            : boost::get<const ValueGetter *>(ptr);
+
+    auto &entries = mDocumentScopeContext->mRangeIndices;
+    auto itr = std::find_if(entries.begin(), entries.end(), [&](auto &entry) {
+      return entry.root == root &&
+             std::equal(path.begin(), path.end(), entry.path.begin(),
+                        entry.path.end());
+    });
+    if (itr == entries.end()) {
+      entries.push_back(
+          RangeIndexEntry{root, Path(path.begin(), path.end()), nullptr});
+      return nullptr;
+    }
+
+    auto &index = itr->index;
+    if (!index || index->rangeSize() != range.size()) {
+      index = std::make_unique<RangeIndex>(range);
+      if (!range.usesInlineValues()) {
+        for (size_t i = 0; i < range.size(); i++)
+          index->insert(get(path + Key{range.index(i)}));
+      }
+    }
+    return index.get();
+  }
+
   void setLiquidValue(std::string name, Value value) {
+    forgetRangeIndices(name);
     mValues[std::move(name)] = std::move(value);
   }
 
@@ -231,6 +552,64 @@ public:
     setLiquidValue(std::move(name), toValue(value));
   }
 
+  // Setters of template local variables: the slot of the key (in the document
+  // scope) if it is bound, the name in this context otherwise
+  void setLiquidValue(const Key &local, Value value) {
+    entry(local) = std::move(value);
+  }
+
+  template <typename T>
+  void set(const Key &local, const T &value,
+           std::enable_if_t<!hasAccessor<T>, void **> = 0) {
+    setLiquidValue(local, toValue(value));
+  }
+
+  // Sets a copy of value, reusing the memory of the previous copy
+  void setCopy(const Key &local, string_view value) {
+    auto &target = entry(local);
+    if (auto current = boost::get<Value>(&target))
+      current->assign(value);
+    else
+      target = Value{to_string(value)};
+  }
+
+private:
+  // Drops the indices of the ranges below name (see rangeIndex())
+  void forgetRangeIndices(string_view name) {
+    if (mDocumentScopeContext == nullptr)
+      return;
+
+    auto &entries = mDocumentScopeContext->mRangeIndices;
+    if (entries.empty())
+      return;
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](auto &entry) {
+                                   return entry.path[0] == name;
+                                 }),
+                  entries.end());
+  }
+
+  MapValue &entry(const Key &local) {
+    forgetRangeIndices(local.name());
+
+    auto slot = local.slot();
+    if (slot == NoSlot) {
+      auto itr = mValues.find(local.name());
+      if (itr != mValues.end())
+        return itr->second;
+      return mValues[to_string(local.name())];
+    }
+
+    auto &slots = documentScopeContext().mSlots;
+    if (slot >= slots.size())
+      slots.resize(slot + 1);
+    if (!slots[slot])
+      slots[slot] = MapValue{};
+    return *slots[slot];
+  }
+
+public:
+
 private:
   template <typename T> 
   static inline auto buildAccessorFunction(T &&value) {
@@ -243,15 +622,53 @@ public:
   template <typename T>
   void set(std::string name, T &&value,
            std::enable_if_t<hasAccessor<std::decay_t<T>>, void **> = 0) {
+    forgetRangeIndices(name);
     mValues[std::move(name)] = buildAccessorFunction(std::forward<T>(value));
   }
 
+  template <typename T>
+  void set(const Key &local, T &&value,
+           std::enable_if_t<hasAccessor<std::decay_t<T>>, void **> = 0) {
+    entry(local) = buildAccessorFunction(std::forward<T>(value));
+  }
+
   void setLink(std::string name, string_view referencedPath) {
     auto p = toPath(referencedPath);
     setLink(std::move(name), p);
   }
 
   void setLink(std::string name, PathRef referencedPath) {
+    forgetRangeIndices(name);
+    mValues[std::move(name)] = link(referencedPath);
+  }
+
+  void setLink(const Key &local, PathRef referencedPath) {
+    auto value = link(referencedPath);
+    entry(local) = std::move(value);
+  }
+
+  // Link to referencedPath owned by the document scope, it stays valid until
+  // the end of the rendering (see setElementLink())
+  const ValueGetter &pinLink(PathRef referencedPath) {
+    auto &pinned = documentScopeContext().mPinnedLinks;
+    auto target = link(referencedPath);
+    if (target.which() == 0)
+      pinned.emplace_back([](PathRef) { return Value{}; });
+    else
+      pinned.push_back(std::move(boost::get<ValueGetter>(target)));
+    return pinned.back();
+  }
+
+  // Links local to the element at index of a pinned range. The getter only
+  // holds the range pointer and the index and is stored without allocation.
+  void setElementLink(const Key &local, const ValueGetter &range, size_t index) {
+    entry(local) = ValueGetter{[range = &range, index](PathRef subPath) {
+      return (*range)(Key{index} + subPath);
+    }};
+  }
+
+private:
+  MapValue link(PathRef referencedPath) const {
     if (referencedPath.empty())
       throw std::runtime_error("Can't handle empty path on set of link!");
 
@@ -263,19 +680,15 @@ public:
        {
           auto& valPtr = boost::get<const Value*>(basePtr);
           if (valPtr == nullptr)
-             mValues[std::move(name)] = Value{};
-          else
-             mValues[std::move(name)] =
-               [this, val = *valPtr, basePath](PathRef subPath) {
+             return Value{};
+          return [this, val = *valPtr, basePath](PathRef subPath) {
                   auto p = basePath + subPath;
                   return getFromValues(&val, p);
                };
-          break;
        }
-       case 1:
+       default:
        {
-         mValues[std::move(name)] =
-            [this, valGetter = *boost::get<const ValueGetter*>(basePtr), basePath](PathRef subPath) {
+         return [this, valGetter = *boost::get<const ValueGetter*>(basePtr), basePath](PathRef subPath) {
                auto p = basePath + subPath;
                return getFromValues(&valGetter, p);
             };
@@ -283,6 +696,7 @@ public:
     }
   }
 
+public:
   template <typename T> void setAnonymous(T &&value) {
     mAnonymous = buildAccessorFunction(std::forward<T>(value));
   }
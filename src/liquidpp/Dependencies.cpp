@@ -0,0 +1,313 @@
+#include "Dependencies.hpp"
+
+#include "Variable.hpp"
+#include "tags/Assign.hpp"
+#include "tags/Capture.hpp"
+#include "tags/Case.hpp"
+#include "tags/Comment.hpp"
+#include "tags/Conditional.hpp"
+#include "tags/Cycle.hpp"
+#include "tags/For.hpp"
+
+#include <boost/variant/get.hpp>
+
+namespace liquidpp
+{
+
+namespace
+{
+// Increments the depth of conditional code for the lifetime of the guard
+struct ConditionalScope
+{
+   explicit ConditionalScope(size_t& depth)
+      : mDepth(depth)
+   {
+      mDepth++;
+   }
+
+   ~ConditionalScope()
+   {
+      mDepth--;
+   }
+
+   size_t& mDepth;
+};
+}
+
+void DependencyCollector::run(const BlockBody& root)
+{
+   walk(root);
+}
+
+std::vector<std::string> DependencyCollector::result() const
+{
+   auto hasParent = [this](const std::string& path) {
+      for (size_t i = path.find_first_of(".[", 1); i != std::string::npos; i = path.find_first_of(".[", i + 1))
+      {
+         if (mPaths.count(path.substr(0, i)))
+            return true;
+      }
+      return false;
+   };
+
+   std::vector<std::string> res;
+   for (auto&& path : mPaths)
+   {
+      if (!hasParent(path))
+         res.push_back(path);
+   }
+
+   return res;
+}
+
+void DependencyCollector::walk(const BlockBody& body, NodeRange range)
+{
+   for (auto i = range.begin; i < range.end; i++)
+      node(body.nodeList[i]);
+}
+
+void DependencyCollector::walk(const BlockBody& body)
+{
+   walk(body, NodeRange{0, body.nodeList.size()});
+}
+
+void DependencyCollector::node(const Node& node)
+{
+   switch (type(node))
+   {
+      case NodeType::String:
+      case NodeType::UnevaluatedTag:
+         // 'else', 'elsif' and 'when' are part of their block
+         break;
+      case NodeType::Variable:
+      {
+         auto& variable = boost::get<Variable>(node);
+         read(variable.variable, variable.filterChain ? variable.filterChain.get_ptr() : nullptr);
+         break;
+      }
+      case NodeType::Tag:
+         tag(*boost::get<std::unique_ptr<const IRenderable>>(node));
+         break;
+   }
+}
+
+void DependencyCollector::tag(const IRenderable& tag)
+{
+   if (dynamic_cast<const Comment*>(&tag))
+      return;
+
+   if (auto ifTag = dynamic_cast<const If*>(&tag))
+   {
+      tokens(ifTag->expression);
+      for (auto&& branch : ifTag->branches)
+      {
+         if (branch.condition)
+            tokens(*branch.condition);
+      }
+      conditional(*ifTag);
+   }
+   else if (auto unlessTag = dynamic_cast<const Unless*>(&tag))
+   {
+      tokens(unlessTag->expression);
+      for (auto&& branch : unlessTag->branches)
+      {
+         if (branch.condition)
+            tokens(*branch.condition);
+      }
+      conditional(*unlessTag);
+   }
+   else if (auto caseTag = dynamic_cast<const Case*>(&tag))
+   {
+      token(caseTag->valueToken);
+      for (auto&& branch : caseTag->branches)
+      {
+         for (auto&& value : branch.values)
+            token(value);
+      }
+      conditional(*caseTag);
+   }
+   else if (auto forTag = dynamic_cast<const For*>(&tag))
+   {
+      if (forTag->limitToken)
+         token(*forTag->limitToken);
+      if (forTag->offsetToken)
+         token(*forTag->offsetToken);
+
+      std::vector<std::string> elements;
+      if (forTag->rangeExpression)
+      {
+         token(forTag->rangeExpression->startIdxToken);
+         token(forTag->rangeExpression->endIdxToken);
+      }
+      else
+      {
+         for (auto&& path : resolve(forTag->rangePath))
+            elements.push_back(path + "[*]");
+      }
+
+      ConditionalScope scope{mConditionalDepth};
+      const auto loopVariable = to_string(forTag->loopVariable);
+      auto shadowedLoop = mAliases.find("forloop");
+      boost::optional<Alias> previousLoop;
+      if (shadowedLoop != mAliases.end())
+         previousLoop = shadowedLoop->second;
+      auto shadowed = mAliases.find(loopVariable);
+      boost::optional<Alias> previous;
+      if (shadowed != mAliases.end())
+         previous = shadowed->second;
+
+      mAliases["forloop"] = Alias{};
+      mAliases[loopVariable] = Alias{elements};
+      walk(forTag->body, forTag->loopBody);
+
+      // the size of the range is needed even if no element is read
+      if (!mAliases[loopVariable].used)
+         mPaths.insert(elements.begin(), elements.end());
+
+      if (previous)
+         mAliases[loopVariable] = *previous;
+      else
+         mAliases.erase(loopVariable);
+      if (previousLoop)
+         mAliases["forloop"] = *previousLoop;
+      else
+         mAliases.erase("forloop");
+
+      walk(forTag->body, forTag->elseBody);
+   }
+   else if (auto assign = dynamic_cast<const Assign*>(&tag))
+   {
+      filterArgs(assign->filterChain);
+      if (assign->assignment.which() == 2 && assign->filterChain.empty())
+         bind(assign->variableName, resolve(boost::get<Path>(assign->assignment)));
+      else
+      {
+         read(assign->assignment, &assign->filterChain);
+         bind(assign->variableName, {});
+      }
+   }
+   else if (auto capture = dynamic_cast<const Capture*>(&tag))
+   {
+      walk(capture->body);
+      bind(capture->variableName, {});
+   }
+   else if (auto cycle = dynamic_cast<const Cycle*>(&tag))
+   {
+      for (auto&& value : cycle->values)
+         token(value);
+   }
+   else if (auto block = dynamic_cast<const Block*>(&tag))
+      conditional(*block);
+}
+
+void DependencyCollector::conditional(const Block& block)
+{
+   ConditionalScope scope{mConditionalDepth};
+   walk(block.body);
+}
+
+void DependencyCollector::token(const Expression::Token& token)
+{
+   read(token, nullptr);
+}
+
+void DependencyCollector::tokens(const Expression& expression)
+{
+   for (auto&& token : expression.tokens)
+      this->token(token);
+}
+
+void DependencyCollector::filterArgs(const Expression::FilterChain& filterChain)
+{
+   for (auto&& filter : filterChain)
+   {
+      for (auto&& arg : filter.args)
+         token(arg);
+   }
+}
+
+void DependencyCollector::read(const Expression::Token& token, const Expression::FilterChain* filterChain)
+{
+   if (filterChain)
+      filterArgs(*filterChain);
+
+   if (token.which() != 2)
+      return;
+
+   auto paths = resolve(boost::get<Path>(token));
+
+   // 'map' reads one member per element only
+   if (filterChain && !filterChain->empty())
+   {
+      auto& filter = filterChain->front();
+      if (filter.name == "map" && filter.args.size() == 1 && filter.args[0].which() == 1)
+      {
+         auto member = boost::get<Value>(filter.args[0]).toString();
+         for (auto&& path : paths)
+            path += "[*]." + member;
+      }
+   }
+
+   mPaths.insert(paths.begin(), paths.end());
+}
+
+std::vector<std::string> DependencyCollector::resolve(PathRef path)
+{
+   if (path.empty() || !path[0].isName())
+      return {};
+
+   auto res = candidates(path[0].name());
+   if (res.empty())
+      return res;
+
+   std::string tail;
+   const size_t cnt = path.size();
+   for (size_t i = 1; i < cnt; i++)
+   {
+      auto& key = path[i];
+      if (key.isIndex())
+         tail += "[" + std::to_string(key.index()) + "]";
+      else if (key.isIndexVariable())
+      {
+         tail += "[*]";
+         auto indexPaths = resolve(key.indexVariable());
+         mPaths.insert(indexPaths.begin(), indexPaths.end());
+      }
+      else if (i + 1 == cnt && key == "size")
+         ; // the size of the parent
+      else if (key == "first")
+         tail += "[0]";
+      else if (key == "last")
+         tail += "[*]";
+      else
+         tail += "." + to_string(key.name());
+   }
+
+   for (auto&& prefix : res)
+      prefix += tail;
+   return res;
+}
+
+std::vector<std::string> DependencyCollector::candidates(string_view name)
+{
+   auto itr = mAliases.find(to_string(name));
+   if (itr == mAliases.end())
+      return {to_string(name)};
+
+   itr->second.used = true;
+   return itr->second.sources;
+}
+
+void DependencyCollector::bind(string_view name, std::vector<std::string> sources)
+{
+   // the value from the context is read if the tag is not rendered
+   if (mConditionalDepth > 0)
+   {
+      auto previous = candidates(name);
+      sources.insert(sources.end(), previous.begin(), previous.end());
+   }
+
+   mAliases[to_string(name)] = Alias{std::move(sources)};
+}
+
+}
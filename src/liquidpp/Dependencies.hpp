@@ -0,0 +1,61 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+#include "BlockBody.hpp"
+
+namespace liquidpp
+{
+
+struct Block;
+
+// Static analysis of the data paths a template may read (see
+// Template::dependencies()).
+//
+// Paths are written in liquid syntax ("products[*].variants[0].title"), '[*]'
+// stands for indices not known before rendering. The value at a path may be
+// read including all of its children. Loop variables and assigned aliases are
+// resolved to the paths they refer to, the values of 'capture', 'increment' and
+// filtered 'assign' tags are local to the template. Custom blocks are treated
+// as conditional, the arguments of custom tags are not known.
+class DependencyCollector
+{
+public:
+   void run(const BlockBody& root);
+
+   // Sorted paths, paths below other paths are omitted
+   std::vector<std::string> result() const;
+
+private:
+   // Source paths of a name bound by the template (empty for local values)
+   struct Alias
+   {
+      std::vector<std::string> sources;
+      bool used{false};
+   };
+
+   void walk(const BlockBody& body, NodeRange range);
+   void walk(const BlockBody& body);
+   void node(const Node& node);
+   void tag(const IRenderable& tag);
+   void conditional(const Block& block);
+
+   void token(const Expression::Token& token);
+   void tokens(const Expression& expression);
+   void filterArgs(const Expression::FilterChain& filterChain);
+   void read(const Expression::Token& token, const Expression::FilterChain* filterChain);
+
+   std::vector<std::string> resolve(PathRef path);
+   std::vector<std::string> candidates(string_view name);
+   void bind(string_view name, std::vector<std::string> sources);
+
+   std::unordered_map<std::string, Alias> mAliases;
+   std::set<std::string> mPaths;
+   size_t mConditionalDepth{0};
+};
+
+}
@@ -2,9 +2,12 @@
 
 #include "Context.hpp"
 #include "Exception.hpp"
+#include "Scanner.hpp"
 
 #include "filters/Filter.hpp"
 
+#include <functional>
+
 namespace liquidpp {
 
 boost::optional<Expression::Operator>
@@ -32,34 +35,12 @@ Expression::toOperator(string_view operator_) {
 }
 
 bool Expression::isWhitespace(char c) {
-  if (c == ' ')
-    return true;
-  if (c == '\t')
-    return true;
-  if (c == '\r')
-    return true;
-  if (c == '\n')
-    return true;
-  return false;
+  return (scanner::charClass(c) & scanner::Whitespace) != 0;
 }
 
 namespace {
 inline bool isOperatorChar(char c) {
-  if (c == '=')
-    return true;
-  if (c == '!')
-    return true;
-  if (c == '<')
-    return true;
-  if (c == '>')
-    return true;
-  if (c == '|') // start filter
-    return true;
-  if (c == ':') // in filters
-    return true;
-  if (c == ',') // in filters
-    return true;
-  return false;
+  return (scanner::charClass(c) & scanner::OperatorChar) != 0;
 }
 
 #if 0
@@ -126,8 +107,8 @@ bool Expression::isFloat(string_view sv) {
   return true;
 }
 
-Expression::RawTokens Expression::splitTokens(string_view sequence) {
-  RawTokens res;
+Expression::Lexemes Expression::lex(string_view sequence) {
+  Lexemes res;
   const size_t len = sequence.size();
   if (len == 0)
     return res;
@@ -141,15 +122,14 @@ Expression::RawTokens Expression::splitTokens(string_view sequence) {
   };
 
   auto stateFromChar = [](char c) {
-    if (isWhitespace(c))
+    const auto cls = scanner::charClass(c);
+    if (cls == 0)
+      return State::Variable;
+    if (cls & scanner::Whitespace)
       return State::Whitespace;
-    if (isOperatorChar(c))
+    if (cls & scanner::OperatorChar)
       return State::Operator;
-    if (c == '\'')
-      return State::SingleQuoteString;
-    if (c == '"')
-      return State::DoubleQuoteString;
-    return State::Variable;
+    return c == '"' ? State::DoubleQuoteString : State::SingleQuoteString;
   };
 
   auto validateVariableName = [](string_view varName) {
@@ -166,9 +146,31 @@ Expression::RawTokens Expression::splitTokens(string_view sequence) {
   auto start = &sequence[0];
   State state = stateFromChar(*start);
   auto finalizeToken = [&](const char *end) {
-    res.emplace_back(start, end - start);
-    if (state == State::Variable)
-      validateVariableName(res.back());
+    Lexeme lexeme{string_view(start, end - start), Lexeme::Kind::Word, Operator::Equal};
+    switch (state) {
+    case State::Variable: {
+      validateVariableName(lexeme.text);
+      auto c = lexeme.text[0];
+      if (c == 'a' || c == 'c' || c == 'o') {
+        if (auto opr = toOperator(lexeme.text)) {
+          lexeme.kind = Lexeme::Kind::Operator;
+          lexeme.operator_ = *opr;
+        }
+      }
+      break;
+    }
+    case State::Operator:
+      if (auto opr = toOperator(lexeme.text)) {
+        lexeme.kind = Lexeme::Kind::Operator;
+        lexeme.operator_ = *opr;
+      } else
+        lexeme.kind = Lexeme::Kind::Punctuation;
+      break;
+    default:
+      lexeme.kind = Lexeme::Kind::String;
+      break;
+    }
+    res.push_back(lexeme);
     start = end;
   };
 
@@ -185,11 +187,15 @@ Expression::RawTokens Expression::splitTokens(string_view sequence) {
       break;
     }
     case State::Variable: {
-      if (isWhitespace(c) || isOperatorChar(c)) {
+      const auto cls = scanner::charClass(c);
+      if (cls == 0)
+        break;
+
+      if (cls & (scanner::Whitespace | scanner::OperatorChar)) {
         finalizeToken(&c);
         state = stateFromChar(c);
       }
-      if (c == '"' || c == '\'') {
+      if (cls & scanner::Quote) {
         auto pos = sequence.find(c, i + 1);
         if (pos == std::string::npos)
           throw Exception("Unterminated quoted string in variable definition!",
@@ -232,6 +238,28 @@ Expression::RawTokens Expression::splitTokens(string_view sequence) {
   return res;
 }
 
+Expression::RawTokens Expression::splitTokens(string_view sequence) {
+  RawTokens res;
+  for (auto &&lexeme : lex(sequence))
+    res.push_back(lexeme.text);
+  return res;
+}
+
+Expression::Token Expression::toToken(const Lexeme &lexeme) {
+  switch (lexeme.kind) {
+  case Lexeme::Kind::Operator:
+    return lexeme.operator_;
+  case Lexeme::Kind::String: {
+    auto str = lexeme.text;
+    str.remove_prefix(1);
+    str.remove_suffix(1);
+    return Value::reference(str);
+  }
+  default:
+    return toToken(lexeme.text);
+  }
+}
+
 Expression::Token Expression::toToken(string_view tokenStr) {
   switch (tokenStr[0]) {
   case '\0':
@@ -295,13 +323,18 @@ Expression::Token Expression::toToken(string_view tokenStr) {
 }
 
 Expression Expression::fromSequence(string_view sequence) {
+  return fromLexemes(lex(sequence), sequence);
+}
+
+Expression Expression::fromLexemes(const Lexemes &lexemes,
+                                   string_view sequence) {
   Expression res;
-  auto splitted = splitTokens(sequence);
-  res.tokens.reserve(splitted.size());
+  res.tokens.reserve(lexemes.size());
 
   bool first = true;
-  for (auto &&token : splitted) {
-    res.tokens.push_back(toToken(token));
+  for (auto &&lexeme : lexemes) {
+    auto token = lexeme.text;
+    res.tokens.push_back(toToken(lexeme));
 
     if (first)
       first = false;
@@ -323,9 +356,121 @@ Expression Expression::fromSequence(string_view sequence) {
   if (isOperator(res.tokens.back()))
     throw Exception("Expression ends with operator!", sequence);
 
+  res.compile();
   return res;
 }
 
+namespace {
+template <template <typename> class C>
+bool compareAny(const Value &left, const Value &right) {
+  return left.compareWith<C>(right);
+}
+
+template <template <typename> class C>
+bool compareToString(const Value &left, const Value &right) {
+  if (!left.isStringType())
+    return false;
+  return C<string_view>{}(*left, *right);
+}
+
+template <template <typename> class C>
+bool compareToInteger(const Value &left, const Value &right) {
+  if (left.isIntegral())
+    return C<std::intmax_t>{}(left.integralValue(), right.integralValue());
+  return left.compareWith<C>(right);
+}
+
+template <template <typename> class C>
+Expression::Comparator comparator(const Value &literal) {
+  if (literal.isStringType())
+    return &compareToString<C>;
+  if (literal.isIntegral())
+    return &compareToInteger<C>;
+  return &compareAny<C>;
+}
+
+Expression::Comparator comparator(Expression::Operator operator_,
+                                  const Value &literal) {
+  using Operator = Expression::Operator;
+  switch (operator_) {
+  case Operator::Equal:
+    return comparator<std::equal_to>(literal);
+  case Operator::NotEqual:
+    return comparator<std::not_equal_to>(literal);
+  case Operator::Less:
+    return comparator<std::less>(literal);
+  case Operator::LessEqual:
+    return comparator<std::less_equal>(literal);
+  case Operator::Greater:
+    return comparator<std::greater>(literal);
+  case Operator::GreaterEqual:
+    return comparator<std::greater_equal>(literal);
+  default:
+    return nullptr;
+  }
+}
+
+// Operator with swapped operands ('contains' has none)
+boost::optional<Expression::Operator> mirrored(Expression::Operator operator_) {
+  using Operator = Expression::Operator;
+  switch (operator_) {
+  case Operator::Equal:
+  case Operator::NotEqual:
+    return operator_;
+  case Operator::Less:
+    return Operator::Greater;
+  case Operator::LessEqual:
+    return Operator::GreaterEqual;
+  case Operator::Greater:
+    return Operator::Less;
+  case Operator::GreaterEqual:
+    return Operator::LessEqual;
+  default:
+    return boost::none;
+  }
+}
+
+bool isLiteral(const Expression::Token &token) { return token.which() == 1; }
+}
+
+void Expression::compile() {
+  terms.clear();
+
+  Operator connective = Operator::Or;
+  const size_t cnt = tokens.size();
+  for (size_t i = 0; i < cnt; i++) {
+    if (isOperator(tokens[i])) {
+      connective = boost::get<Operator>(tokens[i]);
+      continue;
+    }
+
+    Term term;
+    term.connective = connective;
+    term.left = static_cast<std::uint32_t>(i);
+
+    if (i + 2 < cnt) {
+      auto operator_ = boost::get<Operator>(tokens[i + 1]);
+      if (operator_ != Operator::And && operator_ != Operator::Or) {
+        term.operator_ = operator_;
+        term.right = static_cast<std::uint32_t>(i + 2);
+
+        auto swapped = mirrored(operator_);
+        if (isLiteral(tokens[i]) && !isLiteral(tokens[i + 2]) && swapped) {
+          std::swap(term.left, term.right);
+          term.operator_ = *swapped;
+        }
+        if (isLiteral(tokens[term.right]))
+          term.compare =
+              comparator(term.operator_, boost::get<Value>(tokens[term.right]));
+
+        i += 2;
+      }
+    }
+
+    terms.push_back(term);
+  }
+}
+
 void Expression::assureIsSingleKeyPath(string_view rawToken)
 {
   auto loopVarToken = Expression::toToken(rawToken);
@@ -389,22 +534,26 @@ Value Expression::value(Context &c, const Token &t,
   }
 
   if (filterChain) {
-    for (auto &&filter : *filterChain) {
-      if (res.isRange())
-        inlineRangeValues(c, res.range(), path);
-
-      filters::FilterArgs args;
-      args.reserve(filter.args.size());
-      for (auto&& arg : filter.args)
-         args.push_back(value(c, arg));
-      
-      res = filter.function(c, std::move(res), std::move(args));
-    }
+    for (auto &&filter : *filterChain)
+      applyFilter(c, res, path, filter);
   }
 
   return res;
 }
 
+void Expression::applyFilter(Context &c, Value &val, PathRef path,
+                             const FilterData &filter) {
+  if (val.isRange())
+    inlineRangeValues(c, val.range(), path);
+
+  filters::FilterArgs args;
+  args.reserve(filter.args.size());
+  for (auto &&arg : filter.args)
+    args.push_back(value(c, arg));
+
+  val = filter.function(c, std::move(val), std::move(args));
+}
+
 bool Expression::matches(Context &c, const Value &left, Operator operator_,
                          const Value &right, const Token &leftToken) {
   switch (operator_) {
@@ -423,6 +572,13 @@ bool Expression::matches(Context &c, const Value &left, Operator operator_,
   case Operator::Contains:
     if (left.isRange()) {
       auto &&range = left.range();
+      if (leftToken.which() == 2) {
+        if (auto index = c.rangeIndex(boost::get<Path>(leftToken), range)) {
+          if (auto res = index->contains(right))
+            return *res;
+        }
+      }
+
       if (!range.usesInlineValues()) {
         auto cnt = range.size();
         auto &basePath = boost::get<Path>(leftToken);
@@ -444,42 +600,31 @@ bool Expression::matches(Context &c, const Value &left, Operator operator_,
   throw std::runtime_error("Invalid operator for matching check!");
 }
 
-Value Expression::operator()(Context &c) const {
-  Value res;
-  Operator lastOperator = Operator::Or;
-  auto putToRes = [&](bool v) {
-    if (lastOperator == Operator::Or)
-      res |= Value{v};
-    else
-      res &= Value{v};
-  };
+bool Expression::evaluate(Context &c, const Term &term) const {
+  auto &leftToken = tokens[term.left];
+  if (term.right == NoToken)
+    return static_cast<bool>(value(c, leftToken));
 
-  const size_t cnt = tokens.size();
-  const size_t last = cnt - 1;
+  auto &rightToken = tokens[term.right];
+  if (term.compare)
+    return term.compare(value(c, leftToken), boost::get<Value>(rightToken));
 
-  for (size_t i = 0; i < cnt; i++) {
-    auto &token = tokens[i];
+  return matches(c, value(c, leftToken), term.operator_, value(c, rightToken),
+                 leftToken);
+}
+
+Value Expression::operator()(Context &c) const {
+  if (terms.empty())
+    return Value{};
 
-    if (token.which() == 0) {
-      lastOperator = boost::get<Operator>(token);
+  bool res = false;
+  for (auto &&term : terms) {
+    if (term.connective == Operator::Or ? res : !res)
       continue;
-    }
 
-    if (i == last || (boost::get<Operator>(tokens[i + 1]) == Operator::And ||
-                      boost::get<Operator>(tokens[i + 1]) == Operator::Or)) {
-      if (value(c, token))
-        putToRes(true);
-      else
-        putToRes(false);
-    } else {
-      bool b =
-          matches(c, value(c, tokens[i]), boost::get<Operator>(tokens[i + 1]),
-                  value(c, tokens[i + 2]), tokens[i]);
-      putToRes(b);
-      i += 2;
-    }
+    res = evaluate(c, term);
   }
 
-  return res;
+  return Value{res};
 }
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
+
 #include "config.h"
 #include "Exception.hpp"
 #include "Value.hpp"
@@ -26,9 +29,37 @@ struct Expression {
 
    using RawTokens = SmallVector<string_view, 4>;
    using Token = boost::variant<Operator, Value, Path>;
+
+   // Token of a sequence classified by the lexer (see lex())
+   struct Lexeme
+   {
+      enum class Kind : std::uint8_t
+      {
+         Word,       // path, keyword or literal (e.g. 'true' or a number)
+         String,     // quoted string
+         Operator,   // comparison or logical operator (see operator_)
+         Punctuation // other runs of operator characters (e.g. '|', ':' or '=')
+      };
+
+      string_view text;
+      Kind kind;
+      Operator operator_;
+
+      bool operator==(string_view str) const
+      {
+         return text == str;
+      }
+
+      bool operator!=(string_view str) const
+      {
+         return text != str;
+      }
+   };
+   using Lexemes = SmallVector<Lexeme, 8>;
    
    struct FilterData
    {
+      string_view name; // as passed to the filter factory
       filters::Filter function{};
       SmallVector<Token, 1> args;
       
@@ -40,12 +71,16 @@ struct Expression {
    using FilterChain = SmallVector<FilterData, 1>;
 
    static bool matches(Context& c, const Value& left, Operator operator_, const Value& right, const Token& leftToken);
+   static Lexemes lex(string_view sequence);
    static RawTokens splitTokens(string_view sequence);
    static Token toToken(string_view tokenStr);
+   static Token toToken(const Lexeme& lexeme);
    static Expression fromSequence(string_view sequence);
+   static Expression fromLexemes(const Lexemes& lexemes, string_view sequence);
    static void assureIsSingleKeyPath(string_view rawToken);
 
    static Value value(Context& c, const Token& t, boost::optional<const FilterChain&> filterChain = boost::none);
+   static void applyFilter(Context& c, Value& val, PathRef path, const FilterData& filter);
    static std::tuple<Value, Path> value(Context& c, const RangeDefinition& range, size_t i, PathRef basePath);
 
    static bool isInteger(string_view sv);
@@ -62,10 +97,32 @@ struct Expression {
    
    static bool isDigit(char c);
 
+   // Evaluates the terms from left to right, a term is skipped if it can not
+   // change the result ('or' after true, 'and' after false)
    Value operator()(Context& c) const;
 
+   // Comparison of a value with a literal of a known type
+   using Comparator = bool (*)(const Value& left, const Value& right);
+
+   static constexpr std::uint32_t NoToken = std::numeric_limits<std::uint32_t>::max();
+
+   // Operand or comparison of a condition, combined with the result of the
+   // terms before by 'connective'
+   struct Term
+   {
+      Operator connective{Operator::Or};
+      Operator operator_{Operator::Equal};
+      std::uint32_t left{0};       // index of the left token
+      std::uint32_t right{NoToken}; // index of the right token (NoToken: truth of left)
+      Comparator compare{nullptr}; // set if right is a literal, matches() otherwise
+   };
+
+   // Builds the terms from the tokens (done by fromLexemes()), literals are
+   // moved to the right side of comparisons
+   void compile();
+
    template<typename FilterFactoryT>
-   static FilterChain toFilterChain(const FilterFactoryT& filterFac, const RawTokens& tokens, size_t offset)
+   static FilterChain toFilterChain(const FilterFactoryT& filterFac, const Lexemes& tokens, size_t offset)
    {
       FilterChain filterChain;
 
@@ -75,7 +132,8 @@ struct Expression {
       size_t attribIdx = 0;
       for (size_t i=offset; i < tokenCount; i++)
       {
-         auto&& token = tokens[i];
+         auto&& lexeme = tokens[i];
+         auto token = lexeme.text;
          if (token == "|")
          {
             if (newFilter)
@@ -89,6 +147,7 @@ struct Expression {
          }
          else if (newFilter)
          {
+            currentFilter.name = token;
             currentFilter.function = filterFac(token);
             attribIdx = 0;
             if (!currentFilter)
@@ -100,7 +159,7 @@ struct Expression {
             if (currentFilter)
             {
                if (attribIdx++ % 2)
-                  currentFilter.args.push_back(toToken(token));
+                  currentFilter.args.push_back(toToken(lexeme));
                else
                {
                   if (attribIdx == 1) {
@@ -125,6 +184,10 @@ struct Expression {
    }
 
    std::vector<Token> tokens;
+   SmallVector<Term, 2> terms;
+
+private:
+   bool evaluate(Context& c, const Term& term) const;
 };
 }
 
@@ -35,7 +35,9 @@
 namespace liquidpp
 {
 
-filters::Filter FilterFactory::operator()(string_view name) const
+namespace
+{
+filters::Filter createFilter(string_view name)
 {
    using namespace filters;
 
@@ -127,4 +129,24 @@ filters::Filter FilterFactory::operator()(string_view name) const
    return filters::Filter{};
 }
 
+filters::Filter::Purity purity(string_view name)
+{
+   using Purity = filters::Filter::Purity;
+
+   // 'now' and 'today' are resolved at render time, map reads the context
+   if (name == "date" || name == "date_old_impl" || name == "map")
+      return Purity::Impure;
+   if (name == "capitalize" || name == "downcase" || name == "upcase")
+      return Purity::PureForLocale;
+   return Purity::Pure;
+}
+}
+
+filters::Filter FilterFactory::operator()(string_view name) const
+{
+   auto res = createFilter(name);
+   res.purity = purity(name);
+   return res;
+}
+
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -9,11 +10,47 @@ namespace liquidpp
 {
    class Context;
 
+   // Control flow after rendering a node, 'break' and 'continue' are passed
+   // up to the enclosing loop
+   enum class RenderStatus
+   {
+      Normal,
+      Break,
+      Continue
+   };
+
+   struct DoBreak : public std::logic_error
+   {
+      DoBreak() : std::logic_error("'break' tag outside of for-loop!") {}
+   };
+
+   struct DoContinue : public std::logic_error
+   {
+      DoContinue() : std::logic_error("'continue' tag outside of for-loop!") {}
+   };
+
+   // Throws if 'break' or 'continue' reached a place without enclosing loop
+   inline void enforceNormal(RenderStatus status)
+   {
+      if (status == RenderStatus::Break)
+         throw DoBreak{};
+      if (status == RenderStatus::Continue)
+         throw DoContinue{};
+   }
+
    struct IRenderable
    {
       virtual ~IRenderable()
       {}
-       
+
       virtual void render(Context& context, std::string& out) const = 0;
+
+      // Rendering as part of a loop body, tags containing or being 'break'
+      // or 'continue' override it to pass them to the loop
+      virtual RenderStatus renderWithStatus(Context& context, std::string& out) const
+      {
+         render(context, out);
+         return RenderStatus::Normal;
+      }
    };
 }
@@ -3,55 +3,217 @@
 #include "Exception.hpp"
 #include "config.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <limits>
+#include <vector>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/optional.hpp>
 #include <boost/variant.hpp>
 
+#include "Misc.hpp"
+
 namespace liquidpp {
 
 using OptIndex = boost::optional<size_t>;
 using KeyHolder = SmallVector<char, 64>;
 
+// Index of a template local variable in the document scope (see SlotBinder)
+using SlotIndex = std::uint32_t;
+constexpr SlotIndex NoSlot = std::numeric_limits<SlotIndex>::max();
+
+// Property of 'forloop' named by a key, resolved at parse time (see
+// SlotBinder)
+enum class LoopProperty : std::uint8_t {
+  None,
+  First,
+  Index,
+  Index0,
+  Last,
+  Length,
+  Rindex,
+  Rindex0
+};
+
+inline LoopProperty toLoopProperty(string_view name) {
+  if (name == "first")
+    return LoopProperty::First;
+  if (name == "index")
+    return LoopProperty::Index;
+  if (name == "index0")
+    return LoopProperty::Index0;
+  if (name == "last")
+    return LoopProperty::Last;
+  if (name == "length")
+    return LoopProperty::Length;
+  if (name == "rindex")
+    return LoopProperty::Rindex;
+  if (name == "rindex0")
+    return LoopProperty::Rindex0;
+  return LoopProperty::None;
+}
+
+// Pseudo property of the value named by the keys before, resolved at parse
+// time (see toPath())
+enum class BuiltinProperty : std::uint8_t { None, Size, First, Last };
+
+inline BuiltinProperty toBuiltinProperty(string_view name) {
+  if (name == "size")
+    return BuiltinProperty::Size;
+  if (name == "first")
+    return BuiltinProperty::First;
+  if (name == "last")
+    return BuiltinProperty::Last;
+  return BuiltinProperty::None;
+}
+
+// FNV-1a hash of a name, keys store its lower 32 bits
+inline std::uint64_t hashName(string_view name) {
+  std::uint64_t res = 14695981039346656037ull;
+  for (auto c : name) {
+    res ^= static_cast<unsigned char>(c);
+    res *= 1099511628211ull;
+  }
+  return res;
+}
+
+// Key of a path: a name (viewing the template source, with its precomputed
+// hash), an index or a path whose value is the index (index variable). Keys
+// are copied on every step of a lookup, so they are kept at 24 bytes; the
+// keys of index variables are shared by reference counting and copied on
+// write.
 struct Key {
 private:
-  boost::variant<string_view, size_t, std::vector<Key>> mData;
+  struct IndexVariable;
+
+  enum class Kind : std::uint8_t { Name, Index, IndexVariable };
+
+  union {
+    const char *mName;
+    size_t mIndex;
+    IndexVariable *mIndexVariable;
+  };
+  std::uint32_t mSize{0}; // length of the name
+  std::uint32_t mHash{0}; // of the name (see hashName())
+  SlotIndex mSlot{NoSlot};
+  Kind mKind{Kind::Name};
+  LoopProperty mLoopProperty{LoopProperty::None};
+  BuiltinProperty mBuiltinProperty{BuiltinProperty::None};
+
+  void setName(string_view str) {
+    enforce(str.size() < std::numeric_limits<std::uint32_t>::max(),
+            "Key is too long!");
+    mName = str.data();
+    mSize = static_cast<std::uint32_t>(str.size());
+    mHash = static_cast<std::uint32_t>(hashName(str));
+  }
+
+  inline void acquire() const;
+  inline void release();
 
 public:
-  explicit Key() {}
+  explicit Key() : mName(nullptr) {
+    mHash = static_cast<std::uint32_t>(hashName({}));
+  }
 
-  explicit Key(string_view str) : mData(str) {}
+  explicit Key(string_view str) { setName(str); }
 
-  explicit Key(size_t idx) : mData(idx) {}
+  Key(string_view str, SlotIndex slot) : mSlot(slot) { setName(str); }
 
-  explicit Key(gsl::span<const Key> idxVar) : mData(std::vector<Key>(idxVar.begin(), idxVar.end())) {}
+  explicit Key(size_t idx) : mIndex(idx), mKind(Kind::Index) {}
+
+  inline explicit Key(gsl::span<const Key> idxVar);
+
+  Key(const Key &other)
+      : mName(other.mName), mSize(other.mSize), mHash(other.mHash),
+        mSlot(other.mSlot), mKind(other.mKind),
+        mLoopProperty(other.mLoopProperty),
+        mBuiltinProperty(other.mBuiltinProperty) {
+    if (mKind == Kind::IndexVariable)
+      acquire();
+  }
+
+  Key &operator=(const Key &other) {
+    if (other.mKind == Kind::IndexVariable)
+      other.acquire();
+    release();
+
+    mName = other.mName;
+    mSize = other.mSize;
+    mHash = other.mHash;
+    mSlot = other.mSlot;
+    mKind = other.mKind;
+    mLoopProperty = other.mLoopProperty;
+    mBuiltinProperty = other.mBuiltinProperty;
+    return *this;
+  }
+
+  ~Key() { release(); }
 
   explicit operator bool() const {
-    if (mData.which() == 0)
-      return !boost::get<string_view>(mData).empty();
+    if (mKind == Kind::Name)
+      return mSize != 0;
     return true;
   }
 
-  bool operator==(const Key &other) const { return mData == other.mData; }
+  inline bool operator==(const Key &other) const;
 
   bool operator==(string_view keyName) const {
-    if (isName())
-      return name() == keyName;
-    return false;
+    return mKind == Kind::Name && mSize == keyName.size() &&
+           std::equal(keyName.begin(), keyName.end(), mName);
   }
 
-  bool isName() const { return mData.which() == 0; }
+  bool isName() const { return mKind == Kind::Name; }
 
-  string_view name() const { return boost::get<string_view>(mData); }
+  // Empty for other keys
+  string_view name() const {
+    return isName() ? string_view{mName, mSize} : string_view{};
+  }
+
+  // Points the key to another copy of its name, keeping its bindings (see
+  // ViewRelocator)
+  void relocateName(string_view name) {
+    assert(isName());
+    setName(name);
+  }
+
+  // Lower 32 bits of hashName(name())
+  std::uint32_t hash() const { return mHash; }
+
+  bool isIndex() const { return mKind == Kind::Index; }
+
+  size_t index() const {
+    assert(isIndex());
+    return mIndex;
+  }
 
-  bool isIndex() const { return mData.which() == 1; }
+  bool isIndexVariable() const { return mKind == Kind::IndexVariable; }
 
-  size_t index() const { return boost::get<size_t>(mData); }
+  inline gsl::span<const Key> indexVariable() const;
 
-  bool isIndexVariable() const { return mData.which() == 2; }
+  // Unshares the keys of the index variable
+  inline std::vector<Key> &mutableIndexVariable();
 
-  gsl::span<const Key> indexVariable() const { return boost::get<std::vector<Key>>(mData); }
+  // Slot of the template local variable named by the key (NoSlot if it is
+  // looked up by name)
+  SlotIndex slot() const { return mSlot; }
+
+  void bindSlot(SlotIndex slot) { mSlot = slot; }
+
+  // Set on the second key of 'forloop.<property>' paths bound to a loop
+  LoopProperty loopProperty() const { return mLoopProperty; }
+
+  void bindLoopProperty(LoopProperty property) { mLoopProperty = property; }
+
+  // Set on 'size', 'first' and 'last' keys (see bindBuiltinProperties())
+  BuiltinProperty builtinProperty() const { return mBuiltinProperty; }
+
+  void bindBuiltinProperty(BuiltinProperty property) {
+    mBuiltinProperty = property;
+  }
 
 #if 0
       KeyHolder qualifiedPath(string_view subPath) const
@@ -81,6 +243,58 @@ public:
 #endif
 };
 
+struct Key::IndexVariable {
+  std::atomic<std::uint32_t> references{1};
+  std::vector<Key> keys;
+};
+
+inline Key::Key(gsl::span<const Key> idxVar)
+    : mIndexVariable(new IndexVariable), mKind(Kind::IndexVariable) {
+  mIndexVariable->keys.assign(idxVar.begin(), idxVar.end());
+}
+
+inline void Key::acquire() const {
+  mIndexVariable->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void Key::release() {
+  if (mKind == Kind::IndexVariable &&
+      mIndexVariable->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    delete mIndexVariable;
+}
+
+inline bool Key::operator==(const Key &other) const {
+  if (mKind != other.mKind)
+    return false;
+
+  switch (mKind) {
+  case Kind::Name:
+    return mSize == other.mSize && mHash == other.mHash &&
+           std::equal(mName, mName + mSize, other.mName);
+  case Kind::Index:
+    return mIndex == other.mIndex;
+  case Kind::IndexVariable:
+    return mIndexVariable->keys == other.mIndexVariable->keys;
+  }
+  return false;
+}
+
+inline gsl::span<const Key> Key::indexVariable() const {
+  assert(isIndexVariable());
+  return mIndexVariable->keys;
+}
+
+inline std::vector<Key> &Key::mutableIndexVariable() {
+  assert(isIndexVariable());
+  if (mIndexVariable->references.load(std::memory_order_acquire) != 1) {
+    auto copy = new IndexVariable;
+    copy->keys = mIndexVariable->keys;
+    release();
+    mIndexVariable = copy;
+  }
+  return mIndexVariable->keys;
+}
+
 using Path = SmallVector<Key, 4>;
 using PathRef = gsl::span<const Key>;
 
@@ -133,6 +347,23 @@ inline Key popLastKey(PathRef &path) {
   return res;
 }
 
+// Marks 'first' and 'last' and a trailing 'size' after the first key as
+// built-in properties, values that are ranges are asked once for their size
+// or element then
+inline void bindBuiltinProperties(gsl::span<Key> path) {
+  const auto cnt = path.size();
+  for (decltype(path.size()) i = 1; i < cnt; i++) {
+    auto &key = path[i];
+    if (!key.isName())
+      continue;
+
+    auto property = toBuiltinProperty(key.name());
+    if (property == BuiltinProperty::Size && i + 1 != cnt)
+      property = BuiltinProperty::None;
+    key.bindBuiltinProperty(property);
+  }
+}
+
 inline Path toPath(string_view path) {
   Path res;
 
@@ -140,6 +371,7 @@ inline Path toPath(string_view path) {
     res.push_back(key);
   }
 
+  bindBuiltinProperties(res);
   return res;
 }
 }
@@ -0,0 +1,247 @@
+#include "LiteralPool.hpp"
+
+#include "Template.hpp"
+#include "ViewRelocator.hpp"
+#include "Misc.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace liquidpp
+{
+
+namespace
+{
+void advance(Exception::Position& pos, const char* begin, const char* end)
+{
+   for (auto itr = begin; itr != end; ++itr)
+   {
+      if (*itr == '\n')
+      {
+         pos.line++;
+         pos.column = 1;
+      }
+      else
+         pos.column++;
+   }
+}
+}
+
+std::shared_ptr<const LiteralPool> LiteralPool::compact(Template& templ)
+{
+   const auto source = templ.root.templateRange;
+   if (source.data() == nullptr && !templ.root.nodeList.empty())
+      return nullptr; // no contiguous source (e.g. a streamed template)
+
+   auto inSource = [&](string_view sv) {
+      return sv.data() >= source.data() && sv.data() + sv.size() <= source.data() + source.size();
+   };
+
+   // [begin, end) offsets of all views into the source
+   std::vector<std::pair<size_t, size_t>> ranges;
+   ViewRelocator collector{[&](string_view& sv) {
+      if (!inSource(sv))
+         return;
+
+      // empty views get one byte to keep their position unambiguous
+      size_t begin = sv.data() - source.data();
+      ranges.emplace_back(begin, std::min(begin + std::max<size_t>(sv.size(), 1), source.size()));
+   }};
+
+   if (!collector(templ.root))
+      return nullptr;
+
+   std::sort(ranges.begin(), ranges.end());
+
+   // gaps smaller than a segment are cheaper to keep
+   constexpr size_t MaxGap = sizeof(Segment);
+
+   std::shared_ptr<LiteralPool> res{new LiteralPool};
+   auto& segments = res->mSegments;
+   Exception::Position pos{1, 1};
+   size_t scanned = 0;
+   for (auto&& range : ranges)
+   {
+      if (!segments.empty())
+      {
+         auto& last = segments.back();
+         auto lastEnd = last.sourceOffset + last.size;
+         if (range.first <= lastEnd + MaxGap)
+         {
+            last.size = std::max(lastEnd, range.second) - last.sourceOffset;
+            continue;
+         }
+      }
+
+      advance(pos, source.data() + scanned, source.data() + range.first);
+      scanned = range.first;
+      segments.push_back({0, range.first, range.second - range.first, pos});
+   }
+
+   size_t poolSize = 0;
+   for (auto&& segment : segments)
+      poolSize += segment.size;
+
+   auto& storage = res->mStorage;
+   storage.reserve(poolSize);
+   for (auto&& segment : segments)
+   {
+      segment.poolOffset = storage.size();
+      storage.append(source.data() + segment.sourceOffset, segment.size);
+   }
+   res->mData = storage.data();
+   res->mSize = storage.size();
+
+   ViewRelocator rebaser{[&](string_view& sv) {
+      if (!inSource(sv))
+         return;
+
+      size_t offset = sv.data() - source.data();
+      auto segment = std::upper_bound(segments.begin(), segments.end(), offset,
+                                      [](size_t offset, const Segment& s) { return offset < s.sourceOffset; });
+      assert(segment != segments.begin());
+      --segment;
+      sv = string_view{res->mData + segment->poolOffset + (offset - segment->sourceOffset), sv.size()};
+   }};
+
+   rebaser(templ.root);
+   templ.root.templateRange = string_view{};
+   templ.rootOffsets.clear();
+
+   return res;
+}
+
+std::shared_ptr<const LiteralPool> LiteralPool::copy(string_view content)
+{
+   return adopt(to_string(content));
+}
+
+std::shared_ptr<const LiteralPool> LiteralPool::adopt(std::string content, std::shared_ptr<const LiteralPool> owner)
+{
+   std::shared_ptr<LiteralPool> res{new LiteralPool};
+   res->mStorage = std::move(content);
+   res->mOwner = std::move(owner);
+   res->mData = res->mStorage.data();
+   res->mSize = res->mStorage.size();
+   res->mSegments.push_back({0, 0, res->mSize, {1, 1}});
+   return res;
+}
+
+std::shared_ptr<const LiteralPool> LiteralPool::piece(std::string content, size_t sourceOffset,
+                                                     Exception::Position position)
+{
+   std::shared_ptr<LiteralPool> res{new LiteralPool};
+   res->mStorage = std::move(content);
+   res->mData = res->mStorage.data();
+   res->mSize = res->mStorage.size();
+   res->mSegments.push_back({0, sourceOffset, res->mSize, position});
+   return res;
+}
+
+std::shared_ptr<const LiteralPool> LiteralPool::join(std::vector<std::shared_ptr<const LiteralPool>> parts)
+{
+   std::shared_ptr<LiteralPool> res{new LiteralPool};
+   for (auto&& part : parts)
+      res->mPartsSize += part->size();
+   res->mParts = std::move(parts);
+   return res;
+}
+
+std::shared_ptr<const LiteralPool> LiteralPool::mapFile(const std::string& path)
+{
+#if defined(_WIN32)
+   std::ifstream file(path, std::ios::binary);
+   enforce(file.good(), "Could not open template file '" + path + "'!");
+
+   std::string content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+   std::shared_ptr<LiteralPool> res{new LiteralPool};
+   res->mStorage = std::move(content);
+   res->mData = res->mStorage.data();
+   res->mSize = res->mStorage.size();
+#else
+   int fd = ::open(path.c_str(), O_RDONLY);
+   enforce(fd >= 0, "Could not open template file '" + path + "'!");
+
+   struct stat info;
+   if (::fstat(fd, &info) != 0)
+   {
+      ::close(fd);
+      throw std::runtime_error("Could not get size of template file '" + path + "'!");
+   }
+
+   std::shared_ptr<LiteralPool> res{new LiteralPool};
+   res->mSize = static_cast<size_t>(info.st_size);
+   if (res->mSize)
+   {
+      auto addr = ::mmap(nullptr, res->mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      enforce(addr != MAP_FAILED, "Could not map template file '" + path + "'!");
+
+      res->mData = static_cast<const char*>(addr);
+      res->mMapped = true;
+   }
+   else
+      ::close(fd);
+#endif
+
+   res->mSegments.push_back({0, 0, res->mSize, {1, 1}});
+   return res;
+}
+
+std::shared_ptr<const LiteralPool> LiteralPool::slice(std::shared_ptr<const LiteralPool> owner, string_view data,
+                                                      std::vector<Segment> segments)
+{
+   std::shared_ptr<LiteralPool> res{new LiteralPool};
+   res->mOwner = std::move(owner);
+   res->mData = data.data();
+   res->mSize = data.size();
+   res->mSegments = std::move(segments);
+   if (res->mSegments.empty())
+      res->mSegments.push_back({0, 0, 0, {}});
+   return res;
+}
+
+LiteralPool::~LiteralPool()
+{
+#if !defined(_WIN32)
+   if (mMapped)
+      ::munmap(const_cast<char*>(mData), mSize);
+#endif
+}
+
+Exception::Position LiteralPool::findPosition(string_view needle) const
+{
+   Exception::Position res;
+   if (needle.data() < mData || needle.data() >= mData + mSize)
+   {
+      for (auto&& part : mParts)
+      {
+         auto partData = part->data();
+         if (needle.data() >= partData.data() && needle.data() < partData.data() + partData.size())
+            return part->findPosition(needle);
+      }
+      return res;
+   }
+
+   size_t offset = needle.data() - mData;
+   auto segment = std::upper_bound(mSegments.begin(), mSegments.end(), offset,
+                                   [](size_t offset, const Segment& s) { return offset < s.poolOffset; });
+   assert(segment != mSegments.begin());
+   --segment;
+   if (offset >= segment->poolOffset + segment->size)
+      return res;
+
+   res = segment->position;
+   advance(res, mData + segment->poolOffset, mData + offset);
+   return res;
+}
+
+}
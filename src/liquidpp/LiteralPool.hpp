@@ -0,0 +1,96 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "Exception.hpp"
+
+namespace liquidpp
+{
+
+struct Template;
+
+// Memory referenced by the nodes of a template that owns its source.
+//
+// Either a compacted copy of only the bytes the nodes reference (tag syntax,
+// comments and stripped whitespace are dropped), a plain copy of the source
+// or a template file mapped into memory (zero copy).
+class LiteralPool
+{
+public:
+   // Consecutive bytes of the source
+   struct Segment
+   {
+      size_t poolOffset;
+      size_t sourceOffset;
+      size_t size;
+      Exception::Position position; // of the first byte in the source
+   };
+
+   // Copies the bytes referenced by the nodes of templ to a new pool and
+   // rebases all views of templ onto it (has to happen before compiling).
+   // Returns nullptr (and leaves templ unchanged) if a tag of the template
+   // does not support relocation or if templ has no contiguous source.
+   static std::shared_ptr<const LiteralPool> compact(Template& templ);
+
+   static std::shared_ptr<const LiteralPool> copy(string_view content);
+
+   // Pool taking over content (without a copy), owner is kept alive if set
+   static std::shared_ptr<const LiteralPool> adopt(std::string content,
+                                                   std::shared_ptr<const LiteralPool> owner = nullptr);
+
+   // The file is read into memory on platforms without mmap
+   static std::shared_ptr<const LiteralPool> mapFile(const std::string& path);
+
+   // Pool owning a part of a source that starts at sourceOffset/position
+   static std::shared_ptr<const LiteralPool> piece(std::string content, size_t sourceOffset,
+                                                   Exception::Position position);
+
+   // Pool without data of its own that keeps parts alive (e.g. the pieces of
+   // a streamed template), findPosition() searches all parts
+   static std::shared_ptr<const LiteralPool> join(std::vector<std::shared_ptr<const LiteralPool>> parts);
+
+   // Pool referencing data of another pool (which is kept alive)
+   static std::shared_ptr<const LiteralPool> slice(std::shared_ptr<const LiteralPool> owner, string_view data,
+                                                   std::vector<Segment> segments);
+
+   ~LiteralPool();
+
+   LiteralPool(const LiteralPool&) = delete;
+   LiteralPool& operator=(const LiteralPool&) = delete;
+
+   string_view data() const
+   {
+      return string_view{mData, mSize};
+   }
+
+   // Bytes held (including the parts of a joined pool)
+   size_t size() const
+   {
+      return mSize + mPartsSize;
+   }
+
+   const std::vector<Segment>& segments() const
+   {
+      return mSegments;
+   }
+
+   // Position in the original source of a view into the pool
+   Exception::Position findPosition(string_view needle) const;
+
+private:
+   LiteralPool() = default;
+
+   std::string mStorage;
+   const char* mData{nullptr};
+   size_t mSize{0};
+   bool mMapped{false};
+   std::shared_ptr<const LiteralPool> mOwner;
+   std::vector<Segment> mSegments;
+   std::vector<std::shared_ptr<const LiteralPool>> mParts;
+   size_t mPartsSize{0};
+};
+
+}
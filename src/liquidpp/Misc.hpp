@@ -2,6 +2,7 @@
 
 #include "config.h"
 
+#include <boost/functional/hash.hpp>
 #include <boost/lexical_cast.hpp>
 
 namespace liquidpp
@@ -25,6 +26,15 @@ inline void enforce(bool t, const std::string& what)
    throw E(what);
 }
 
+// string_view has no std::hash specialization in all supported implementations
+struct StringViewHash
+{
+   size_t operator()(string_view sv) const
+   {
+      return boost::hash_range(sv.begin(), sv.end());
+   }
+};
+
 template<typename T>
 auto lex_cast(string_view in, const char* msg = nullptr)
 {
@@ -0,0 +1,533 @@
+#include "Optimizer.hpp"
+
+#include "LiteralPool.hpp"
+#include "Variable.hpp"
+#include "tags/Assign.hpp"
+#include "tags/Block.hpp"
+#include "tags/Capture.hpp"
+#include "tags/Case.hpp"
+#include "tags/Comment.hpp"
+#include "tags/Conditional.hpp"
+#include "tags/For.hpp"
+
+#include <algorithm>
+
+#include <boost/variant/get.hpp>
+
+namespace liquidpp
+{
+
+namespace
+{
+template<bool Inverted, typename EvaluateF>
+boost::optional<NodeRange> staticBranchOf(const Conditional<Inverted>& tag, EvaluateF&& evaluate)
+{
+   auto matches = evaluate(tag.expression);
+   if (!matches)
+      return boost::none;
+   if (*matches != Inverted)
+      return tag.branches[0].nodes;
+
+   const size_t cnt = tag.branches.size();
+   for (size_t i = 1; i < cnt; i++)
+   {
+      auto& branch = tag.branches[i];
+      if (!branch.condition)
+         return branch.nodes;
+
+      matches = evaluate(*branch.condition);
+      if (!matches)
+         return boost::none;
+      if (*matches)
+         return branch.nodes;
+   }
+
+   // nothing is rendered
+   return NodeRange{};
+}
+
+template<bool Inverted>
+bool conditionsOf(const Conditional<Inverted>& tag, std::vector<const Expression*>& res)
+{
+   res.push_back(&tag.expression);
+   for (auto&& branch : tag.branches)
+   {
+      if (branch.condition)
+         res.push_back(branch.condition.get_ptr());
+   }
+   return true;
+}
+
+// Conditions of 'if' and 'unless' tags (false for other tags)
+bool conditionsOf(const IRenderable& tag, std::vector<const Expression*>& res)
+{
+   if (auto ifTag = dynamic_cast<const If*>(&tag))
+      return conditionsOf(*ifTag, res);
+   if (auto unlessTag = dynamic_cast<const Unless*>(&tag))
+      return conditionsOf(*unlessTag, res);
+   return false;
+}
+
+// Names of the loop variables of a block for the lifetime of the scope
+class LoopScope
+{
+public:
+   LoopScope(std::vector<string_view>& names, const IRenderable& tag)
+      : mNames(names), mSize(names.size())
+   {
+      if (auto forTag = dynamic_cast<const For*>(&tag))
+      {
+         mNames.push_back(forTag->loopVariable);
+         mNames.push_back("forloop");
+      }
+   }
+
+   ~LoopScope()
+   {
+      mNames.resize(mSize);
+   }
+
+   LoopScope(const LoopScope&) = delete;
+   LoopScope& operator=(const LoopScope&) = delete;
+
+private:
+   std::vector<string_view>& mNames;
+   size_t mSize;
+};
+
+bool contains(const std::vector<string_view>& names, string_view name)
+{
+   return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+Block* toBlock(Node& node)
+{
+   if (type(node) != NodeType::Tag)
+      return nullptr;
+
+   // tags are const after parsing only
+   auto block = dynamic_cast<const Block*>(boost::get<std::unique_ptr<const IRenderable>>(node).get());
+   return const_cast<Block*>(block);
+}
+}
+
+Optimizer::Optimizer(const boost::optional<std::locale>& locale, std::shared_ptr<const LiteralPool> constants)
+   : mLocaleKnown(!!locale), mConstants(std::move(constants))
+{
+   if (locale)
+      mContext.setLocale(*locale);
+}
+
+Optimizer::Optimizer(const Context& staticData, std::vector<Path> staticPaths,
+                     std::shared_ptr<const LiteralPool> constants)
+   : mContext(&staticData), mLocaleKnown(true), mSpecializing(true), mStaticPaths(std::move(staticPaths)),
+     mConstants(std::move(constants))
+{
+}
+
+bool Optimizer::run(BlockBody& root)
+{
+   if (mSpecializing)
+      collectBoundNames(root);
+
+   bool changed = prune(root);
+
+   planMerges(root, nullptr);
+   if (mPlans.empty())
+      return changed;
+
+   if (!mPoolContent.empty())
+      mConstants = LiteralPool::adopt(std::move(mPoolContent), std::move(mConstants));
+   for (auto&& plan : mPlans)
+      applyMerges(plan);
+
+   return true;
+}
+
+bool Optimizer::prune(BlockBody& body)
+{
+   bool changed = false;
+   BlockBody::Nodes res;
+   res.reserve(body.nodeList.size());
+
+   for (auto&& node : body.nodeList)
+   {
+      if (auto block = toBlock(node))
+      {
+         if (dynamic_cast<const Comment*>(block))
+         {
+            changed = true;
+            continue;
+         }
+
+         bool bodyChanged = false;
+         {
+            LoopScope scope{mShadowed, *block};
+            bodyChanged = prune(block->body);
+         }
+         if (bodyChanged)
+            block->finalize();
+
+         if (auto branch = staticBranch(*block))
+         {
+            for (auto i = branch->begin; i < branch->end; i++)
+               res.push_back(std::move(block->body.nodeList[i]));
+            changed = true;
+            continue;
+         }
+      }
+
+      res.push_back(std::move(node));
+   }
+
+   body.nodeList = std::move(res);
+   return changed;
+}
+
+boost::optional<NodeRange> Optimizer::staticBranch(const Block& block)
+{
+   auto evaluate = [this](const Expression& expression) { return this->evaluate(expression); };
+
+   boost::optional<NodeRange> res;
+   if (auto tag = dynamic_cast<const If*>(&block))
+      res = staticBranchOf(*tag, evaluate);
+   else if (auto tag = dynamic_cast<const Unless*>(&block))
+      res = staticBranchOf(*tag, evaluate);
+
+   // the nodes must not become branches of the surrounding block
+   if (res)
+   {
+      for (auto i = res->begin; i < res->end; i++)
+      {
+         auto& node = block.body.nodeList[i];
+         if (isSpecificTag(node, "else") || isSpecificTag(node, "elsif") || isSpecificTag(node, "when"))
+            return boost::none;
+      }
+   }
+
+   return res;
+}
+
+boost::optional<bool> Optimizer::evaluate(const Expression& expression)
+{
+   if (!isStatic(expression))
+      return boost::none;
+
+   try {
+      return static_cast<bool>(expression(mContext));
+   } catch (std::exception&) {
+      // reported when rendering
+      return boost::none;
+   }
+}
+
+void Optimizer::planMerges(BlockBody& body, Block* block)
+{
+   BodyPlan plan{&body, block, {}};
+   auto& nodes = body.nodeList;
+   const size_t cnt = nodes.size();
+
+   for (size_t i = 0; i < cnt;)
+   {
+      const size_t begin = i;
+      std::string text;
+      string_view view;
+      bool contiguous = true;
+      for (; i < cnt; i++)
+      {
+         auto& node = nodes[i];
+         if (type(node) == NodeType::String)
+         {
+            auto sv = boost::get<string_view>(node);
+            if (sv.empty())
+               continue;
+
+            if (view.empty())
+               view = sv;
+            else if (view.data() + view.size() == sv.data())
+               view = string_view{view.data(), view.size() + sv.size()};
+            else
+               contiguous = false;
+            text.append(sv.data(), sv.size());
+         }
+         else if (type(node) == NodeType::Variable || type(node) == NodeType::Tag)
+         {
+            auto folded = type(node) == NodeType::Variable ? foldedText(node) : renderedText(node);
+            if (!folded)
+               break;
+
+            contiguous = false;
+            text += *folded;
+         }
+         else
+            break;
+      }
+
+      if (i == begin)
+      {
+         if (auto subBlock = toBlock(nodes[i]))
+         {
+            LoopScope scope{mShadowed, *subBlock};
+            planMerges(subBlock->body, subBlock);
+         }
+         i++;
+         continue;
+      }
+
+      // a single string node is kept
+      if (i - begin == 1 && type(nodes[begin]) == NodeType::String && !text.empty())
+         continue;
+
+      Replacement replacement{begin, i, {}, false, 0, text.size()};
+      if (contiguous)
+         replacement.text = view;
+      else
+      {
+         replacement.pooled = true;
+         replacement.offset = mPoolContent.size();
+         mPoolContent += text;
+      }
+      plan.replacements.push_back(replacement);
+   }
+
+   if (!plan.replacements.empty())
+      mPlans.push_back(std::move(plan));
+}
+
+boost::optional<std::string> Optimizer::foldedText(const Node& node)
+{
+   auto& variable = boost::get<Variable>(node);
+   if (!isStatic(variable.variable))
+      return boost::none;
+   if (variable.filterChain && !isStatic(*variable.filterChain))
+      return boost::none;
+
+   try {
+      auto val = Expression::value(mContext, variable.variable,
+                                   variable.filterChain ? boost::optional<const Expression::FilterChain&>{*variable.filterChain} : boost::none);
+      if (val.isRange())
+         return boost::none;
+
+      std::string res;
+      Variable::append(res, val);
+      return res;
+   } catch (std::exception&) {
+      // reported when rendering
+      return boost::none;
+   }
+}
+
+boost::optional<std::string> Optimizer::renderedText(const Node& node)
+{
+   if (!mSpecializing)
+      return boost::none;
+
+   auto& tag = *boost::get<std::unique_ptr<const IRenderable>>(node);
+   if (!isStaticTag(tag, false))
+      return boost::none;
+
+   try {
+      std::string res;
+      tag.render(mContext, res);
+      return res;
+   } catch (std::exception&) {
+      // reported when rendering
+      return boost::none;
+   }
+}
+
+bool Optimizer::isStaticPath(PathRef path) const
+{
+   if (path.empty() || !path[0].isName())
+      return false;
+
+   for (auto&& key : path)
+   {
+      if (key.isIndexVariable() && !isStaticPath(key.indexVariable()))
+         return false;
+   }
+
+   auto name = path[0].name();
+   if (contains(mLocals, name))
+      return true;
+   if (contains(mShadowed, name) || mBoundNames.count(to_string(name)))
+      return false;
+
+   for (auto&& prefix : mStaticPaths)
+   {
+      if (prefix.size() <= path.size() && std::equal(prefix.begin(), prefix.end(), path.begin()))
+         return true;
+   }
+
+   return false;
+}
+
+bool Optimizer::isStatic(const Expression::Token& token) const
+{
+   if (token.which() == 2)
+      return isStaticPath(boost::get<Path>(token));
+   return true;
+}
+
+bool Optimizer::isStatic(const Expression& expression) const
+{
+   for (auto&& token : expression.tokens)
+   {
+      if (!isStatic(token))
+         return false;
+   }
+   return true;
+}
+
+bool Optimizer::isStatic(const Expression::FilterChain& filterChain) const
+{
+   for (auto&& filter : filterChain)
+   {
+      using Purity = filters::Filter::Purity;
+      auto purity = filter.function.purity;
+      if (purity == Purity::Impure || (purity == Purity::PureForLocale && !mLocaleKnown))
+         return false;
+
+      for (auto&& arg : filter.args)
+      {
+         if (!isStatic(arg))
+            return false;
+      }
+   }
+   return true;
+}
+
+bool Optimizer::isStatic(const BlockBody& body, NodeRange range, bool inLoop)
+{
+   for (auto i = range.begin; i < range.end; i++)
+   {
+      auto& node = body.nodeList[i];
+      switch (type(node))
+      {
+         case NodeType::String:
+         case NodeType::UnevaluatedTag:
+            break;
+         case NodeType::Variable:
+         {
+            auto& variable = boost::get<Variable>(node);
+            if (!isStatic(variable.variable) || (variable.filterChain && !isStatic(*variable.filterChain)))
+               return false;
+            break;
+         }
+         case NodeType::Tag:
+            if (!isStaticTag(*boost::get<std::unique_ptr<const IRenderable>>(node), inLoop))
+               return false;
+            break;
+      }
+   }
+
+   return true;
+}
+
+bool Optimizer::isStaticTag(const IRenderable& tag, bool inLoop)
+{
+   if (dynamic_cast<const Comment*>(&tag))
+      return true;
+   if (dynamic_cast<const Break*>(&tag) || dynamic_cast<const Continue*>(&tag))
+      return inLoop;
+
+   if (auto forTag = dynamic_cast<const For*>(&tag))
+   {
+      if (forTag->rangeExpression)
+      {
+         if (!isStatic(forTag->rangeExpression->startIdxToken) || !isStatic(forTag->rangeExpression->endIdxToken))
+            return false;
+      }
+      else if (!isStaticPath(forTag->rangePath))
+         return false;
+
+      if ((forTag->limitToken && !isStatic(*forTag->limitToken)) ||
+          (forTag->offsetToken && !isStatic(*forTag->offsetToken)))
+         return false;
+      if (!isStatic(forTag->body, forTag->elseBody, inLoop))
+         return false;
+
+      LoopScope scope{mLocals, tag};
+      return isStatic(forTag->body, forTag->loopBody, true);
+   }
+
+   std::vector<const Expression*> conditions;
+   if (conditionsOf(tag, conditions))
+   {
+      for (auto condition : conditions)
+      {
+         if (!isStatic(*condition))
+            return false;
+      }
+   }
+   else if (auto caseTag = dynamic_cast<const Case*>(&tag))
+   {
+      if (!isStatic(caseTag->valueToken))
+         return false;
+      for (auto&& branch : caseTag->branches)
+      {
+         for (auto&& value : branch.values)
+         {
+            if (!isStatic(value))
+               return false;
+         }
+      }
+   }
+   else
+      return false; // e.g. 'assign', 'capture', 'cycle' or custom tags
+
+   auto& block = static_cast<const Block&>(tag);
+   return isStatic(block.body, NodeRange{0, block.body.nodeList.size()}, inLoop);
+}
+
+void Optimizer::collectBoundNames(const BlockBody& body)
+{
+   for (auto&& node : body.nodeList)
+   {
+      if (type(node) != NodeType::Tag)
+         continue;
+
+      auto& tag = *boost::get<std::unique_ptr<const IRenderable>>(node);
+      if (auto assign = dynamic_cast<const Assign*>(&tag))
+         mBoundNames.insert(to_string(assign->variableName));
+      else if (auto capture = dynamic_cast<const Capture*>(&tag))
+         mBoundNames.insert(to_string(capture->variableName));
+
+      if (auto block = dynamic_cast<const Block*>(&tag))
+         collectBoundNames(block->body);
+   }
+}
+
+void Optimizer::applyMerges(BodyPlan& plan)
+{
+   auto& nodes = plan.body->nodeList;
+   BlockBody::Nodes res;
+   res.reserve(nodes.size());
+
+   auto replacement = plan.replacements.begin();
+   for (size_t i = 0; i < nodes.size(); i++)
+   {
+      if (replacement == plan.replacements.end() || i != replacement->begin)
+      {
+         res.push_back(std::move(nodes[i]));
+         continue;
+      }
+
+      if (replacement->size > 0)
+      {
+         if (replacement->pooled)
+            res.push_back(string_view{mConstants->data().data() + replacement->offset, replacement->size});
+         else
+            res.push_back(replacement->text);
+      }
+
+      i = replacement->end - 1;
+      ++replacement;
+   }
+
+   nodes = std::move(res);
+   if (plan.block)
+      plan.block->finalize();
+}
+
+}
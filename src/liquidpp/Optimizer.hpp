@@ -0,0 +1,110 @@
+#pragma once
+
+#include <locale>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "BlockBody.hpp"
+#include "Context.hpp"
+
+namespace liquidpp
+{
+
+struct Block;
+struct Variable;
+class LiteralPool;
+
+// Optimization pass over a parsed node tree (see Template::optimize()).
+//
+// 1. Comments are removed and 'if'/'unless' tags with constant conditions
+//    are replaced by the nodes of the branch that is rendered.
+// 2. Variables on constant values with pure filters only are evaluated and
+//    runs of literals are merged into one string node each. Text that does
+//    not exist in the source is copied to a new constant pool.
+//
+// With static data (see Template::specialize()) the values below the static
+// paths are constants, too. Variables and conditions reading them are folded
+// and loops, conditions and 'case' tags depending only on them (and on their
+// own loop variables) are rendered to text. Names set by the template are
+// never static.
+//
+// Blocks whose body changed are finalized again.
+class Optimizer
+{
+public:
+   Optimizer(const boost::optional<std::locale>& locale, std::shared_ptr<const LiteralPool> constants);
+
+   // Specialization for the values of staticData below staticPaths (the
+   // locale of staticData is used by the folded filters)
+   Optimizer(const Context& staticData, std::vector<Path> staticPaths, std::shared_ptr<const LiteralPool> constants);
+
+   // Returns false if nothing was changed
+   bool run(BlockBody& root);
+
+   // Pool referenced by the folded and merged literals (keeps the previous
+   // pool alive)
+   std::shared_ptr<const LiteralPool> constants() const
+   {
+      return mConstants;
+   }
+
+private:
+   // Literal nodes [begin, end) of a body replaced by text
+   struct Replacement
+   {
+      size_t begin;
+      size_t end;
+      string_view text;  // if the text is contiguous in the source
+      bool pooled;       // text is [offset, offset + size) of the constant pool otherwise
+      size_t offset;
+      size_t size;
+   };
+
+   struct BodyPlan
+   {
+      BlockBody* body;
+      Block* block;
+      std::vector<Replacement> replacements;
+   };
+
+   bool prune(BlockBody& body);
+   boost::optional<NodeRange> staticBranch(const Block& block);
+   boost::optional<bool> evaluate(const Expression& expression);
+
+   void planMerges(BlockBody& body, Block* block);
+   boost::optional<std::string> foldedText(const Node& node);
+   boost::optional<std::string> renderedText(const Node& node);
+   void applyMerges(BodyPlan& plan);
+
+   // Whether the value is known before rendering
+   bool isStaticPath(PathRef path) const;
+   bool isStatic(const Expression::Token& token) const;
+   bool isStatic(const Expression& expression) const;
+   bool isStatic(const Expression::FilterChain& filterChain) const;
+
+   // Whether the output of the nodes depends on static values only and
+   // rendering them has no other effects
+   bool isStatic(const BlockBody& body, NodeRange range, bool inLoop);
+   bool isStaticTag(const IRenderable& tag, bool inLoop);
+
+   void collectBoundNames(const BlockBody& body);
+
+   Context mContext;
+   bool mLocaleKnown;
+   bool mSpecializing{false};
+   std::vector<Path> mStaticPaths;
+   std::set<std::string> mBoundNames;
+
+   // Loop variables of the static tags being checked and of the loops around
+   // the nodes being optimized
+   std::vector<string_view> mLocals;
+   std::vector<string_view> mShadowed;
+   std::shared_ptr<const LiteralPool> mConstants;
+   std::string mPoolContent;
+   std::vector<BodyPlan> mPlans;
+};
+
+}
@@ -0,0 +1,314 @@
+#include "Program.hpp"
+
+#include "Context.hpp"
+#include "Template.hpp"
+#include "Variable.hpp"
+
+#include "tags/Block.hpp"
+#include "tags/Comment.hpp"
+#include "tags/Conditional.hpp"
+#include "tags/For.hpp"
+
+#include <boost/variant/get.hpp>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LIQUIDPP_THREADED_INTERPRETER
+#endif
+
+namespace liquidpp
+{
+
+struct Program::Compiler
+{
+   using Itr = BlockBody::Nodes::const_iterator;
+
+   Program& program;
+
+   std::uint32_t pc() const
+   {
+      return static_cast<std::uint32_t>(program.mCode.size());
+   }
+
+   std::uint32_t emit(OpCode op, std::uint32_t arg = 0, std::uint32_t target = 0)
+   {
+      auto res = pc();
+      program.mCode.push_back({op, arg, target});
+      return res;
+   }
+
+   void patch(std::uint32_t instruction)
+   {
+      program.mCode[instruction].target = pc();
+   }
+
+   template<typename T, typename U>
+   static std::uint32_t add(std::vector<T>& pool, U&& val)
+   {
+      pool.push_back(std::forward<U>(val));
+      return static_cast<std::uint32_t>(pool.size() - 1);
+   }
+
+   void compile(Itr itr, Itr end)
+   {
+      for (; itr != end; ++itr)
+         compile(*itr);
+   }
+
+   void compile(const Node& node)
+   {
+      switch(type(node))
+      {
+         case NodeType::String:
+         {
+            auto sv = boost::get<string_view>(node);
+            if (!sv.empty())
+               emit(OpCode::Literal, add(program.mLiterals, sv));
+            break;
+         }
+         case NodeType::Variable:
+         {
+            auto& var = boost::get<Variable>(node);
+            emit(OpCode::Push, add(program.mTokens, var.variable));
+            if (var.filterChain)
+            {
+               for (auto&& filter : *var.filterChain)
+                  emit(OpCode::Filter, add(program.mFilters, filter));
+            }
+            emit(OpCode::Output);
+            break;
+         }
+         case NodeType::Tag:
+            compile(*boost::get<std::unique_ptr<const IRenderable>>(node));
+            break;
+         case NodeType::UnevaluatedTag:
+            break;
+      }
+   }
+
+   void compile(const IRenderable& tag)
+   {
+      if (auto ifTag = dynamic_cast<const If*>(&tag))
+         return compileConditional(*ifTag);
+      if (auto unlessTag = dynamic_cast<const Unless*>(&tag))
+         return compileConditional(*unlessTag);
+      if (auto forTag = dynamic_cast<const For*>(&tag))
+         return compileLoop(*forTag);
+      if (dynamic_cast<const Comment*>(&tag))
+         return;
+      if (dynamic_cast<const Break*>(&tag))
+      {
+         emit(OpCode::Break);
+         return;
+      }
+      if (dynamic_cast<const Continue*>(&tag))
+      {
+         emit(OpCode::Continue);
+         return;
+      }
+
+      emit(OpCode::Tag, add(program.mTags, &tag));
+   }
+
+   void compile(const BlockBody& body, NodeRange range)
+   {
+      compile(body.nodeList.begin() + range.begin, body.nodeList.begin() + range.end);
+   }
+
+   template<bool Inverted>
+   void compileConditional(const Conditional<Inverted>& tag)
+   {
+      SmallVector<std::uint32_t, 4> exitJumps;
+      const size_t cnt = tag.branches.size();
+
+      for (size_t i = 0; i < cnt; i++)
+      {
+         auto& branch = tag.branches[i];
+
+         boost::optional<std::uint32_t> skipJump;
+         if (i == 0)
+            skipJump = emit(Inverted ? OpCode::JumpIfTrue : OpCode::JumpIfFalse,
+                            add(program.mConditions, tag.expression));
+         else if (branch.condition)
+            skipJump = emit(OpCode::JumpIfFalse, add(program.mConditions, *branch.condition));
+
+         compile(tag.body, branch.nodes);
+
+         if (!skipJump)
+            break; // 'else' branch: following branches are unreachable
+         if (i + 1 < cnt)
+            exitJumps.push_back(emit(OpCode::Jump));
+         patch(*skipJump);
+      }
+
+      for (auto&& jump : exitJumps)
+         patch(jump);
+   }
+
+   void compileLoop(const For& tag)
+   {
+      auto loopIdx = add(program.mLoops, Loop{&tag, 0, 0});
+
+      emit(OpCode::LoopBegin, loopIdx);
+      compile(tag.body, tag.loopBody);
+      emit(OpCode::LoopNext);
+
+      program.mLoops[loopIdx].elseTarget = pc();
+      compile(tag.body, tag.elseBody);
+      program.mLoops[loopIdx].exitTarget = pc();
+   }
+};
+
+Program::Program(const Template& templ)
+{
+   try {
+      Compiler compiler{*this};
+      compiler.compile(templ.root.nodeList.begin(), templ.root.nodeList.end());
+      compiler.emit(OpCode::Halt);
+   } catch(Exception& e) {
+      e.position() = templ.findPosition(e.errorPart());
+      throw;
+   }
+}
+
+RenderStatus Program::render(Context& context, std::string& out) const
+{
+   return run(0, context, out);
+}
+
+std::uint32_t Program::runLoop(std::uint32_t pc, Context& context, std::string& out) const
+{
+   auto& loopInfo = mLoops[mCode[pc].arg];
+   auto& tag = *loopInfo.tag;
+
+   auto loop = tag.evaluate(context);
+   if (loop.limit == 0)
+      return loopInfo.elseTarget;
+
+   tag.renderLoop(context, out, loop, [&](Context& loopContext, std::string& loopOut) {
+      return run(pc + 1, loopContext, loopOut) != RenderStatus::Break;
+   });
+
+   return loopInfo.exitTarget;
+}
+
+// Every operation has to leave its scope before dispatching the next one
+// (computed goto does not unwind local objects).
+#ifdef LIQUIDPP_THREADED_INTERPRETER
+#define LIQUIDPP_VM_DISPATCH() goto *dispatchTable[static_cast<size_t>(code[pc].op)]
+#define LIQUIDPP_VM_SWITCH() LIQUIDPP_VM_DISPATCH();
+#define LIQUIDPP_VM_CASE(op) op_##op:
+#else
+#define LIQUIDPP_VM_DISPATCH() continue
+#define LIQUIDPP_VM_SWITCH() for(;;) switch(code[pc].op)
+#define LIQUIDPP_VM_CASE(op) case OpCode::op:
+#endif
+
+RenderStatus Program::run(std::uint32_t pc, Context& context, std::string& out) const
+{
+   const Instruction* code = mCode.data();
+   Value acc;
+   PathRef accPath;
+
+#ifdef LIQUIDPP_THREADED_INTERPRETER
+   static const void* const dispatchTable[] = {
+      &&op_Literal, &&op_Push, &&op_Filter, &&op_Output,
+      &&op_JumpIfFalse, &&op_JumpIfTrue, &&op_Jump,
+      &&op_LoopBegin, &&op_LoopNext, &&op_Break, &&op_Continue,
+      &&op_Tag, &&op_Halt
+   };
+   static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) == static_cast<size_t>(OpCode::Halt) + 1,
+                 "Dispatch table does not match the op codes!");
+#endif
+
+   LIQUIDPP_VM_SWITCH()
+   {
+      LIQUIDPP_VM_CASE(Literal)
+      {
+         auto& sv = mLiterals[code[pc].arg];
+         out.append(sv.data(), sv.size());
+         ++pc;
+         LIQUIDPP_VM_DISPATCH();
+      }
+      LIQUIDPP_VM_CASE(Push)
+      {
+         auto& token = mTokens[code[pc].arg];
+         if (token.which() == 2)
+         {
+            accPath = boost::get<Path>(token);
+            acc = context.get(accPath);
+         }
+         else
+         {
+            accPath = PathRef{};
+            acc = Expression::value(context, token);
+         }
+         ++pc;
+         LIQUIDPP_VM_DISPATCH();
+      }
+      LIQUIDPP_VM_CASE(Filter)
+      {
+         Expression::applyFilter(context, acc, accPath, mFilters[code[pc].arg]);
+         ++pc;
+         LIQUIDPP_VM_DISPATCH();
+      }
+      LIQUIDPP_VM_CASE(Output)
+      {
+         Variable::append(out, acc);
+         ++pc;
+         LIQUIDPP_VM_DISPATCH();
+      }
+      LIQUIDPP_VM_CASE(JumpIfFalse)
+      {
+         pc = mConditions[code[pc].arg](context) ? pc + 1 : code[pc].target;
+         LIQUIDPP_VM_DISPATCH();
+      }
+      LIQUIDPP_VM_CASE(JumpIfTrue)
+      {
+         pc = mConditions[code[pc].arg](context) ? code[pc].target : pc + 1;
+         LIQUIDPP_VM_DISPATCH();
+      }
+      LIQUIDPP_VM_CASE(Jump)
+      {
+         pc = code[pc].target;
+         LIQUIDPP_VM_DISPATCH();
+      }
+      LIQUIDPP_VM_CASE(LoopBegin)
+      {
+         pc = runLoop(pc, context, out);
+         LIQUIDPP_VM_DISPATCH();
+      }
+      LIQUIDPP_VM_CASE(LoopNext)
+      {
+         return RenderStatus::Normal;
+      }
+      LIQUIDPP_VM_CASE(Break)
+      {
+         return RenderStatus::Break;
+      }
+      LIQUIDPP_VM_CASE(Continue)
+      {
+         return RenderStatus::Continue;
+      }
+      LIQUIDPP_VM_CASE(Tag)
+      {
+         auto status = mTags[code[pc].arg]->renderWithStatus(context, out);
+         if (status != RenderStatus::Normal)
+            return status;
+         ++pc;
+         LIQUIDPP_VM_DISPATCH();
+      }
+      LIQUIDPP_VM_CASE(Halt)
+      {
+         return RenderStatus::Normal;
+      }
+   }
+
+   assert(false);
+   return RenderStatus::Normal;
+}
+
+#undef LIQUIDPP_VM_CASE
+#undef LIQUIDPP_VM_SWITCH
+#undef LIQUIDPP_VM_DISPATCH
+
+}
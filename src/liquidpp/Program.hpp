@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "config.h"
+#include "BlockBody.hpp"
+#include "Expression.hpp"
+
+namespace liquidpp
+{
+
+struct Template;
+struct For;
+
+// Flat bytecode representation of a parsed template.
+//
+// The node tree is lowered to one contiguous instruction stream that is run by
+// a threaded interpreter (computed goto on GCC/Clang, a switch loop otherwise).
+// Literals, tokens, filters and conditions are copied to the constant pools of
+// the program. Loops and tags without a lowering of their own are referenced
+// and rendered by the tree renderer, so the template has to outlive the
+// program (moving the template is fine, tags are heap allocated).
+class Program
+{
+public:
+   enum class OpCode : std::uint8_t
+   {
+      Literal,     // append literal [arg] to the output
+      Push,        // load the value of token [arg] into the accumulator
+      Filter,      // apply filter [arg] to the accumulator
+      Output,      // append the accumulator to the output
+      JumpIfFalse, // jump to [target] if condition [arg] does not match
+      JumpIfTrue,  // jump to [target] if condition [arg] matches
+      Jump,        // jump to [target]
+      LoopBegin,   // iterate loop [arg], the body starts at the next instruction
+      LoopNext,    // end of a loop body
+      Break,
+      Continue,
+      Tag,         // render tag [arg] with the tree renderer
+      Halt
+   };
+
+   struct Instruction
+   {
+      OpCode op;
+      std::uint32_t arg;
+      std::uint32_t target;
+   };
+
+   struct Loop
+   {
+      const For* tag;
+      std::uint32_t elseTarget; // first instruction of the 'else' body
+      std::uint32_t exitTarget; // first instruction after the loop
+   };
+
+   explicit Program(const Template& templ);
+
+   // Returns 'Break' or 'Continue' if such a tag is rendered outside of loops
+   RenderStatus render(Context& context, std::string& out) const;
+
+   const std::vector<Instruction>& code() const
+   {
+      return mCode;
+   }
+
+private:
+   struct Compiler;
+
+   RenderStatus run(std::uint32_t pc, Context& context, std::string& out) const;
+   std::uint32_t runLoop(std::uint32_t pc, Context& context, std::string& out) const;
+
+   std::vector<Instruction> mCode;
+   std::vector<string_view> mLiterals;
+   std::vector<Expression::Token> mTokens;
+   std::vector<Expression::FilterData> mFilters;
+   std::vector<Expression> mConditions;
+   std::vector<Loop> mLoops;
+   std::vector<const IRenderable*> mTags;
+};
+
+}
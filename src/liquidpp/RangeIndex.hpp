@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cassert>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "config.h"
+#include "Misc.hpp"
+#include "Value.hpp"
+
+namespace liquidpp
+{
+
+// Hash set of the string elements of a range for repeated 'contains' checks
+// (see Context::rangeIndex()). Only string elements are equal to string
+// needles, other needles of ranges without inline values are compared with
+// the elements one by one. Inline values are compared with the needle as
+// string.
+class RangeIndex
+{
+public:
+   explicit RangeIndex(const RangeDefinition& range) : mUsesInlineValues(range.usesInlineValues()), mSize(range.size())
+   {
+      mStrings.reserve(mSize);
+      mSet.reserve(mSize);
+      if (mUsesInlineValues)
+      {
+         for (auto&& val : range.inlineValues())
+            add(val);
+      }
+   }
+
+   RangeIndex(const RangeIndex&) = delete;
+   RangeIndex& operator=(const RangeIndex&) = delete;
+
+   // Adds an element of a range without inline values
+   void insert(const Value& element)
+   {
+      if (element.isStringType())
+         add(*element);
+   }
+
+   // Whether the range contains needle, none if it can't be answered by the index
+   boost::optional<bool> contains(const Value& needle) const
+   {
+      if (mUsesInlineValues)
+         return mSet.count(needle.toString()) != 0;
+      if (!needle.isStringType())
+         return boost::none;
+      return mSet.count(*needle) != 0;
+   }
+
+   size_t rangeSize() const
+   {
+      return mSize;
+   }
+
+private:
+   void add(string_view str)
+   {
+      // reserved, the views of the set stay valid
+      assert(mStrings.size() < mStrings.capacity());
+      mStrings.push_back(to_string(str));
+      mSet.insert(mStrings.back());
+   }
+
+   bool mUsesInlineValues;
+   size_t mSize;
+   std::vector<std::string> mStrings;
+   std::unordered_set<string_view, StringViewHash> mSet;
+};
+
+}
@@ -0,0 +1,156 @@
+#include "Reparse.hpp"
+
+#include "ViewRelocator.hpp"
+#include "Misc.hpp"
+
+#include <algorithm>
+
+namespace liquidpp
+{
+
+namespace
+{
+bool startsWith(string_view str, string_view prefix)
+{
+   return str.substr(0, prefix.size()) == prefix;
+}
+
+bool endsWith(string_view str, string_view suffix)
+{
+   return str.size() >= suffix.size() && str.substr(str.size() - suffix.size()) == suffix;
+}
+
+// Whitespace control of a tag at the end of text affects the following node
+bool stripsNext(string_view text)
+{
+   return endsWith(text, "-}}") || endsWith(text, "-%}");
+}
+
+// Whitespace control of a tag at the start of text affects the preceding node
+bool stripsPrevious(string_view text)
+{
+   return startsWith(text, "{{-") || startsWith(text, "{%-");
+}
+}
+
+namespace impl
+{
+
+std::shared_ptr<const LiteralPool> applyEdit(string_view source, const TextEdit& edit)
+{
+   enforce(edit.offset <= source.size() && edit.removedLength <= source.size() - edit.offset,
+           "Edit exceeds the template source!");
+
+   std::string res;
+   res.reserve(source.size() - edit.removedLength + edit.insertedText.size());
+   res.append(source.data(), edit.offset);
+   res.append(edit.insertedText.data(), edit.insertedText.size());
+   auto tail = source.substr(edit.offset + edit.removedLength);
+   res.append(tail.data(), tail.size());
+
+   return LiteralPool::adopt(std::move(res));
+}
+
+EditRegion editRegion(const Template& templ, string_view editedSource, const TextEdit& edit)
+{
+   const auto& offsets = templ.rootOffsets;
+   const auto n = offsets.size();
+   assert(n > 0);
+
+   // start of node i in the edited source (for nodes behind the edit)
+   auto editedOffset = [&](size_t i) {
+      return i < n ? offsets[i] - edit.removedLength + edit.insertedText.size() : editedSource.size();
+   };
+
+   // the nodes touching the edit and one neighbour on each side
+   auto editEnd = edit.offset + edit.removedLength;
+   EditRegion res;
+   res.first = std::upper_bound(offsets.begin(), offsets.end(), edit.offset) - offsets.begin() - 1;
+   res.last = std::upper_bound(offsets.begin(), offsets.end(), editEnd) - offsets.begin() - 1;
+   res.first = res.first > 0 ? res.first - 1 : 0;
+   res.last = std::min(res.last + 1, n - 1);
+
+   res.begin = offsets[res.first];
+   res.end = editedOffset(res.last + 1);
+
+   // widen the region while its neighbours would be parsed differently
+   // (split strings, whitespace control or plain strings next to each other)
+   for (bool changed = true; changed;)
+   {
+      changed = false;
+
+      if (res.first > 0 && (editedSource[res.begin - 1] == '{' || stripsNext(editedSource.substr(0, res.begin)) ||
+                            stripsPrevious(editedSource.substr(res.begin))))
+      {
+         res.begin = offsets[--res.first];
+         changed = true;
+      }
+
+      if (res.last + 1 < n)
+      {
+         auto fragment = editedSource.substr(res.begin, res.end - res.begin);
+         auto next = editedSource.substr(res.end);
+         if (endsWith(fragment, "{") || stripsNext(fragment) || stripsPrevious(next) ||
+             type(templ.root.nodeList[res.last + 1]) == NodeType::String)
+         {
+            res.end = editedOffset(++res.last + 1);
+            changed = true;
+         }
+      }
+   }
+
+   return res;
+}
+
+bool spliceNodes(Template& templ, const TextEdit& edit, const EditRegion& region,
+                 BlockBody& regionBody, const std::vector<size_t>& regionOffsets, Template& res)
+{
+   const auto oldSource = templ.root.templateRange;
+   const auto newSource = res.root.templateRange;
+   const auto inserted = edit.insertedText.size();
+
+   ViewRelocator relocator{[&](string_view& sv) {
+      if (sv.data() < oldSource.data() || sv.data() + sv.size() > oldSource.data() + oldSource.size())
+         return;
+
+      size_t offset = sv.data() - oldSource.data();
+      if (offset >= edit.offset)
+         offset = offset - edit.removedLength + inserted;
+      sv = string_view{newSource.data() + offset, sv.size()};
+   }};
+
+   auto& oldNodes = templ.root.nodeList;
+   auto& nodes = res.root.nodeList;
+   auto& offsets = res.rootOffsets;
+   auto count = oldNodes.size() - (region.last - region.first + 1) + regionBody.nodeList.size();
+   nodes.reserve(count);
+   offsets.reserve(count);
+
+   for (size_t i = 0; i < region.first; i++)
+   {
+      if (!relocator(oldNodes[i]))
+         return false;
+      nodes.push_back(std::move(oldNodes[i]));
+      offsets.push_back(templ.rootOffsets[i]);
+   }
+
+   for (size_t i = 0; i < regionBody.nodeList.size(); i++)
+   {
+      nodes.push_back(std::move(regionBody.nodeList[i]));
+      offsets.push_back(region.begin + regionOffsets[i]);
+   }
+
+   for (size_t i = region.last + 1; i < oldNodes.size(); i++)
+   {
+      if (!relocator(oldNodes[i]))
+         return false;
+      nodes.push_back(std::move(oldNodes[i]));
+      offsets.push_back(templ.rootOffsets[i] - edit.removedLength + inserted);
+   }
+
+   return true;
+}
+
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "config.h"
+#include "parser.hpp"
+
+namespace liquidpp
+{
+
+// Replacement of removedLength bytes at offset by insertedText
+struct TextEdit
+{
+   size_t offset{0};
+   size_t removedLength{0};
+   string_view insertedText;
+};
+
+namespace impl
+{
+// Top level nodes [first, last] of a template that have to be parsed again
+// after an edit and the source range of them in the edited text
+struct EditRegion
+{
+   size_t first{0};
+   size_t last{0};
+   size_t begin{0};
+   size_t end{0};
+};
+
+std::shared_ptr<const LiteralPool> applyEdit(string_view source, const TextEdit& edit);
+EditRegion editRegion(const Template& templ, string_view editedSource, const TextEdit& edit);
+
+// Moves the nodes of templ outside of region and the parsed region into res
+// (returns false if a reused node does not support relocation)
+bool spliceNodes(Template& templ, const TextEdit& edit, const EditRegion& region,
+                 BlockBody& regionBody, const std::vector<size_t>& regionOffsets, Template& res);
+}
+
+// Applies edit to the source of templ and parses only the affected top level
+// nodes again, all other nodes are reused. The result owns the edited source.
+//
+// Falls back to parsing the whole edited source if the edit changes the
+// structure beyond the affected nodes (e.g. opens a block) or if templ was
+// not parsed from a source directly (compacted or deserialized templates).
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+Template reparse(Template&& templ, const TextEdit& edit)
+{
+   auto source = templ.root.templateRange;
+   enforce(source.data() != nullptr || templ.root.nodeList.empty(),
+           "Template does not reference its source (compacted and deserialized templates can not be edited)!");
+
+   auto edited = impl::applyEdit(source, edit);
+   auto editedSource = edited->data();
+   if (templ.rootOffsets.empty() || templ.rootOffsets.size() != templ.root.nodeList.size())
+      return parse<TagFactoryT, FilterFactoryT>(std::move(edited));
+
+   auto region = impl::editRegion(templ, editedSource, edit);
+
+   BlockBody regionBody;
+   std::vector<size_t> regionOffsets;
+   try {
+      impl::fastParser<TagFactoryT, FilterFactoryT>(editedSource.substr(region.begin, region.end - region.begin),
+                                                    regionBody, &regionOffsets);
+   } catch(Exception&) {
+      // the edit affects more than the region (the full parse reports errors properly)
+      return parse<TagFactoryT, FilterFactoryT>(std::move(edited));
+   }
+
+   Template res;
+   res.literals = edited;
+   res.root.templateRange = editedSource;
+   res.mMaxResultSize = templ.mMaxResultSize;
+   if (!impl::spliceNodes(templ, edit, region, regionBody, regionOffsets, res))
+      return parse<TagFactoryT, FilterFactoryT>(std::move(edited));
+
+   res.bindSlots();
+   if (templ.program)
+      res.compile();
+   return res;
+}
+
+}
@@ -0,0 +1,213 @@
+#include "Scanner.hpp"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIQUIDPP_SCANNER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(LIQUIDPP_SCANNER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define LIQUIDPP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LIQUIDPP_TARGET_AVX2
+#endif
+
+namespace liquidpp
+{
+namespace scanner
+{
+
+constexpr CharClassTable::CharClassTable()
+   : classes{}
+{
+   for (auto c : " \t\r\n")
+      classes[static_cast<unsigned char>(c)] |= Whitespace;
+   // '|' starts a filter, ':' and ',' separate filter arguments
+   for (auto c : "=!<>|:,")
+      classes[static_cast<unsigned char>(c)] |= OperatorChar;
+   for (auto c : "'\"")
+      classes[static_cast<unsigned char>(c)] |= Quote;
+   // the loops include the terminating zeros
+   classes[0] = 0;
+}
+
+constexpr CharClassTable charClassTable{};
+
+namespace
+{
+size_t findPairScalar(const char* data, size_t size, char first, char second, char alternative)
+{
+   for (size_t i = 1; i < size; i++)
+   {
+      const auto c = data[i];
+      if ((c == second || c == alternative) && data[i-1] == first)
+         return i - 1;
+   }
+
+   return npos;
+}
+
+#ifdef LIQUIDPP_SCANNER_X86
+inline unsigned lowestBit(unsigned mask)
+{
+#ifdef _MSC_VER
+   unsigned long idx;
+   _BitScanForward(&idx, mask);
+   return idx;
+#else
+   return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Compares the block at i with the block at i+1, the rest is scanned by the
+// narrower implementation
+size_t findPairSse2(const char* data, size_t size, char first, char second, char alternative)
+{
+   const auto firstV = _mm_set1_epi8(first);
+   const auto secondV = _mm_set1_epi8(second);
+   const auto alternativeV = _mm_set1_epi8(alternative);
+
+   size_t i = 0;
+   for (; i + 16 < size; i += 16)
+   {
+      const auto current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      const auto next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+      const auto matches = _mm_and_si128(_mm_cmpeq_epi8(current, firstV),
+                                         _mm_or_si128(_mm_cmpeq_epi8(next, secondV), _mm_cmpeq_epi8(next, alternativeV)));
+      const auto mask = static_cast<unsigned>(_mm_movemask_epi8(matches));
+      if (mask != 0)
+         return i + lowestBit(mask);
+   }
+
+   auto res = findPairScalar(data + i, size - i, first, second, alternative);
+   return res == npos ? npos : i + res;
+}
+
+LIQUIDPP_TARGET_AVX2
+size_t findPairAvx2(const char* data, size_t size, char first, char second, char alternative)
+{
+   const auto firstV = _mm256_set1_epi8(first);
+   const auto secondV = _mm256_set1_epi8(second);
+   const auto alternativeV = _mm256_set1_epi8(alternative);
+
+   size_t i = 0;
+   for (; i + 32 < size; i += 32)
+   {
+      const auto current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+      const auto next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+      const auto matches = _mm256_and_si256(_mm256_cmpeq_epi8(current, firstV),
+                                            _mm256_or_si256(_mm256_cmpeq_epi8(next, secondV), _mm256_cmpeq_epi8(next, alternativeV)));
+      const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(matches));
+      if (mask != 0)
+         return i + lowestBit(mask);
+   }
+
+   auto res = findPairSse2(data + i, size - i, first, second, alternative);
+   return res == npos ? npos : i + res;
+}
+
+bool cpuHasAvx2()
+{
+#ifdef _MSC_VER
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return false;
+
+   // AVX has to be supported by the OS (XSAVE of the YMM registers)
+   __cpuid(info, 1);
+   const bool osxsave = (info[2] & (1 << 27)) != 0;
+   const bool avx = (info[2] & (1 << 28)) != 0;
+   if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+      return false;
+
+   __cpuidex(info, 7, 0);
+   return (info[1] & (1 << 5)) != 0;
+#else
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+using FindPairF = size_t (*)(const char*, size_t, char, char, char);
+
+FindPairF implementation(Isa isa)
+{
+   switch (isa)
+   {
+#ifdef LIQUIDPP_SCANNER_X86
+      case Isa::AVX2:
+         return &findPairAvx2;
+      case Isa::SSE2:
+         return &findPairSse2;
+#endif
+      default:
+         return &findPairScalar;
+   }
+}
+
+Isa bestIsa()
+{
+#ifdef LIQUIDPP_SCANNER_X86
+   return cpuHasAvx2() ? Isa::AVX2 : Isa::SSE2;
+#else
+   return Isa::Scalar;
+#endif
+}
+
+struct Dispatch
+{
+   std::atomic<Isa> isa{bestIsa()};
+   std::atomic<FindPairF> findPair{implementation(isa)};
+};
+
+Dispatch& dispatch()
+{
+   static Dispatch res;
+   return res;
+}
+}
+
+Isa activeIsa()
+{
+   return dispatch().isa;
+}
+
+bool isSupported(Isa isa)
+{
+   return static_cast<int>(isa) <= static_cast<int>(bestIsa());
+}
+
+std::string supportedIsas()
+{
+   std::string res = "Scalar";
+   if (isSupported(Isa::SSE2))
+      res += ", SSE2";
+   if (isSupported(Isa::AVX2))
+      res += ", AVX2";
+   return res;
+}
+
+bool setIsa(Isa isa)
+{
+   if (!isSupported(isa))
+      return false;
+
+   auto& d = dispatch();
+   d.isa = isa;
+   d.findPair = implementation(isa);
+   return true;
+}
+
+size_t findPair(const char* data, size_t size, char first, char second, char alternative)
+{
+   return dispatch().findPair.load(std::memory_order_relaxed)(data, size, first, second, alternative);
+}
+
+}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "config.h"
+
+// Byte scanners used by the parser.
+//
+// Literal text makes up most of a template, so finding the tag delimiters
+// dominates parsing. The scanners compare 16 (SSE2) or 32 (AVX2) bytes at once,
+// the implementation is selected at runtime according to the CPU. Other
+// platforms use the scalar implementation.
+namespace liquidpp
+{
+namespace scanner
+{
+
+enum class Isa
+{
+   Scalar,
+   SSE2,
+   AVX2
+};
+
+// Implementation used by the scanners
+Isa activeIsa();
+
+// Implementations supported by this CPU (in ascending order)
+std::string supportedIsas();
+bool isSupported(Isa isa);
+
+// Selects the implementation (e.g. for tests and benchmarks), returns false
+// if it is not supported by this CPU
+bool setIsa(Isa isa);
+
+constexpr size_t npos = std::string::npos;
+
+// Index of the first position p with data[p] == first and data[p+1] being
+// second or alternative, npos if there is none
+size_t findPair(const char* data, size_t size, char first, char second, char alternative);
+
+inline size_t findPair(const char* data, size_t size, char first, char second)
+{
+   return findPair(data, size, first, second, second);
+}
+
+// Index of the '{' of the first tag opening ("{{" or "{%")
+inline size_t findTagOpening(const char* data, size_t size)
+{
+   return findPair(data, size, '{', '{', '%');
+}
+
+// Character classes of the expression lexer
+enum CharClass : std::uint8_t
+{
+   Whitespace = 1,
+   OperatorChar = 2,
+   Quote = 4
+};
+
+struct CharClassTable
+{
+   std::uint8_t classes[256];
+
+   constexpr CharClassTable();
+};
+
+extern const CharClassTable charClassTable;
+
+inline std::uint8_t charClass(char c)
+{
+   return charClassTable.classes[static_cast<unsigned char>(c)];
+}
+
+}
+}
@@ -0,0 +1,386 @@
+#include "Serialization.hpp"
+
+#include <fstream>
+#include <limits>
+
+namespace liquidpp
+{
+
+namespace binary
+{
+
+namespace
+{
+class Writer
+{
+public:
+   Writer(string_view base)
+      : mBase(base)
+   {
+   }
+
+   template<typename T>
+   void write(const T& val)
+   {
+      static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written!");
+      mNodes.append(reinterpret_cast<const char*>(&val), sizeof(T));
+   }
+
+   void count(size_t cnt)
+   {
+      enforce(cnt <= std::numeric_limits<std::uint32_t>::max(), "Too many elements for binary template!");
+      write(static_cast<std::uint32_t>(cnt));
+   }
+
+   // Views into the base are stored as offsets, others are copied to the end of the pool
+   void view(string_view sv)
+   {
+      size_t offset = 0;
+      if (sv.data() >= mBase.data() && sv.data() + sv.size() <= mBase.data() + mBase.size())
+         offset = sv.data() - mBase.data();
+      else if (!sv.empty())
+      {
+         offset = mBase.size() + mExtra.size();
+         mExtra.append(sv.data(), sv.size());
+      }
+
+      count(offset);
+      count(sv.size());
+   }
+
+   void key(const Key& key)
+   {
+      if (key.isName())
+      {
+         write(KeyType::Name);
+         view(key.name());
+      }
+      else if (key.isIndex())
+      {
+         write(KeyType::Index);
+         write(static_cast<std::uint64_t>(key.index()));
+      }
+      else
+      {
+         write(KeyType::IndexVariable);
+         auto keys = key.indexVariable();
+         count(keys.size());
+         for (auto&& k : keys)
+            this->key(k);
+      }
+   }
+
+   void path(PathRef path)
+   {
+      count(path.size());
+      for (auto&& k : path)
+         key(k);
+   }
+
+   void value(const Value& val)
+   {
+      if (val.isStringView())
+      {
+         write(ValueType::View);
+         view(*val);
+      }
+      else if (val.isStringType())
+      {
+         write(ValueType::String);
+         view(*val);
+      }
+      else if (val.isIntegral())
+      {
+         write(ValueType::Integral);
+         write(static_cast<std::int64_t>(val.integralValue()));
+      }
+      else if (val.isFloatingPoint())
+      {
+         write(ValueType::FloatingPoint);
+         write(val.floatingPointValue());
+      }
+      else if (val.isBool())
+      {
+         write(ValueType::Bool);
+         write(static_cast<std::uint8_t>(val.isTrue()));
+      }
+      else if (val.isValueTag())
+      {
+         write(ValueType::Tag);
+         for (auto tag : {ValueTag::Object, ValueTag::Null, ValueTag::OutOfRange, ValueTag::SubValue})
+         {
+            if (val == tag)
+               write(tag);
+         }
+      }
+      else
+         throw std::runtime_error("Ranges can not be stored in binary templates!");
+   }
+
+   void token(const Expression::Token& token)
+   {
+      switch (token.which())
+      {
+         case 0:
+            write(TokenType::Operator);
+            write(boost::get<Expression::Operator>(token));
+            break;
+         case 1:
+            write(TokenType::Value);
+            value(boost::get<Value>(token));
+            break;
+         case 2:
+            write(TokenType::Path);
+            path(boost::get<Path>(token));
+            break;
+      }
+   }
+
+   void filterChain(const Expression::FilterChain& filterChain)
+   {
+      count(filterChain.size());
+      for (auto&& filter : filterChain)
+      {
+         view(filter.name);
+         count(filter.args.size());
+         for (auto&& arg : filter.args)
+            token(arg);
+      }
+   }
+
+   void tag(const Tag& tag)
+   {
+      view(tag.name);
+      view(tag.value);
+   }
+
+   void node(const Node& node)
+   {
+      auto nodeType = type(node);
+      write(static_cast<std::uint8_t>(nodeType));
+
+      switch (nodeType)
+      {
+         case NodeType::String:
+            view(boost::get<string_view>(node));
+            break;
+         case NodeType::Variable:
+         {
+            auto& var = boost::get<Variable>(node);
+            token(var.variable);
+            write(static_cast<std::uint8_t>(var.filterChain ? 1 : 0));
+            if (var.filterChain)
+               filterChain(*var.filterChain);
+            break;
+         }
+         case NodeType::UnevaluatedTag:
+            tag(boost::get<UnevaluatedTag>(node));
+            break;
+         case NodeType::Tag:
+         {
+            auto t = dynamic_cast<const Tag*>(boost::get<std::unique_ptr<const IRenderable>>(node).get());
+            enforce(t != nullptr, "Renderables that are no tags can not be stored in binary templates!");
+            tag(*t);
+
+            auto block = dynamic_cast<const Block*>(t);
+            write(static_cast<std::uint8_t>(block ? 1 : 0));
+            if (block)
+               body(block->body);
+            break;
+         }
+      }
+   }
+
+   void body(const BlockBody& body)
+   {
+      count(body.nodeList.size());
+      for (auto&& n : body.nodeList)
+         node(n);
+   }
+
+   const std::string& nodes() const
+   {
+      return mNodes;
+   }
+
+   const std::string& extra() const
+   {
+      return mExtra;
+   }
+
+private:
+   string_view mBase;
+   std::string mNodes;
+   std::string mExtra;
+};
+
+template<typename T>
+void append(std::string& out, const T& val)
+{
+   out.append(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+}
+
+string_view Reader::view()
+{
+   size_t offset = read<std::uint32_t>();
+   size_t size = read<std::uint32_t>();
+   enforce(offset <= mPool.size() && size <= mPool.size() - offset, "View exceeds the pool of the binary template!");
+   return mPool.substr(offset, size);
+}
+
+Key Reader::key()
+{
+   switch (read<KeyType>())
+   {
+      case KeyType::Name:
+         return Key{view()};
+      case KeyType::Index:
+         return Key{static_cast<size_t>(read<std::uint64_t>())};
+      case KeyType::IndexVariable:
+      {
+         std::vector<Key> keys;
+         const auto cnt = count();
+         for (size_t i = 0; i < cnt; i++)
+            keys.push_back(key());
+         bindBuiltinProperties(keys);
+         return Key{gsl::span<const Key>(keys)};
+      }
+   }
+
+   throw std::runtime_error("Invalid key type in binary template!");
+}
+
+Path Reader::path()
+{
+   Path res;
+   const auto cnt = count();
+   for (size_t i = 0; i < cnt; i++)
+      res.push_back(key());
+   bindBuiltinProperties(res);
+   return res;
+}
+
+Value Reader::value()
+{
+   switch (read<ValueType>())
+   {
+      case ValueType::View:
+         return Value::reference(view());
+      case ValueType::String:
+         return Value{to_string(view())};
+      case ValueType::Integral:
+         return Value{static_cast<std::intmax_t>(read<std::int64_t>())};
+      case ValueType::FloatingPoint:
+         return Value{read<double>()};
+      case ValueType::Bool:
+         return Value{read<std::uint8_t>() != 0};
+      case ValueType::Tag:
+         return Value{read<ValueTag>()};
+   }
+
+   throw std::runtime_error("Invalid value type in binary template!");
+}
+
+Expression::Token Reader::token()
+{
+   switch (read<TokenType>())
+   {
+      case TokenType::Operator:
+         return read<Expression::Operator>();
+      case TokenType::Value:
+         return value();
+      case TokenType::Path:
+         return path();
+   }
+
+   throw std::runtime_error("Invalid token type in binary template!");
+}
+
+UnevaluatedTag Reader::rawTag()
+{
+   auto name = view();
+   return UnevaluatedTag{name, view()};
+}
+
+std::shared_ptr<const LiteralPool> readPool(Reader& reader, std::shared_ptr<const LiteralPool> data)
+{
+   auto magic = reader.bytes(sizeof(Magic));
+   enforce(std::memcmp(magic.data(), Magic, sizeof(Magic)) == 0, "Data is no binary template!");
+   enforce(reader.read<std::uint32_t>() == Version, "Unsupported version of binary template!");
+   enforce(reader.read<std::uint32_t>() == ByteOrderMark, "Binary template was written on a platform with different byte order!");
+
+   const auto poolSize = reader.read<std::uint64_t>();
+   const auto segmentCnt = reader.read<std::uint64_t>();
+   auto pool = reader.bytes(poolSize);
+
+   std::vector<LiteralPool::Segment> segments;
+   segments.reserve(segmentCnt);
+   for (size_t i = 0; i < segmentCnt; i++)
+   {
+      LiteralPool::Segment segment;
+      segment.poolOffset = reader.read<std::uint64_t>();
+      segment.sourceOffset = reader.read<std::uint64_t>();
+      segment.size = reader.read<std::uint64_t>();
+      segment.position.line = reader.read<std::uint64_t>();
+      segment.position.column = reader.read<std::uint64_t>();
+      segments.push_back(segment);
+   }
+
+   reader.setPool(pool);
+   return LiteralPool::slice(std::move(data), pool, std::move(segments));
+}
+
+}
+
+std::string serialize(const Template& templ)
+{
+   auto base = templ.literals ? templ.literals->data() : templ.root.templateRange;
+   enforce(base.size() <= std::numeric_limits<std::uint32_t>::max(), "Template is too large for the binary format!");
+
+   binary::Writer writer{base};
+   writer.body(templ.root);
+
+   std::vector<LiteralPool::Segment> segments;
+   if (templ.literals && !templ.literals->segments().empty())
+      segments = templ.literals->segments();
+   else
+      segments.push_back({0, 0, base.size(), {1, 1}});
+
+   std::string res;
+   res.reserve(64 + base.size() + writer.extra().size() + segments.size() * 5 * sizeof(std::uint64_t) +
+               writer.nodes().size());
+
+   res.append(binary::Magic, sizeof(binary::Magic));
+   binary::append(res, binary::Version);
+   binary::append(res, binary::ByteOrderMark);
+   binary::append(res, static_cast<std::uint64_t>(base.size() + writer.extra().size()));
+   binary::append(res, static_cast<std::uint64_t>(segments.size()));
+
+   res.append(base.data(), base.size());
+   res += writer.extra();
+
+   for (auto&& segment : segments)
+   {
+      binary::append(res, static_cast<std::uint64_t>(segment.poolOffset));
+      binary::append(res, static_cast<std::uint64_t>(segment.sourceOffset));
+      binary::append(res, static_cast<std::uint64_t>(segment.size));
+      binary::append(res, static_cast<std::uint64_t>(segment.position.line));
+      binary::append(res, static_cast<std::uint64_t>(segment.position.column));
+   }
+
+   res += writer.nodes();
+   return res;
+}
+
+void saveBinary(const Template& templ, const std::string& path)
+{
+   auto data = serialize(templ);
+
+   std::ofstream file(path, std::ios::binary | std::ios::trunc);
+   enforce(file.good(), "Could not open file '" + path + "' for writing!");
+   file.write(data.data(), data.size());
+   enforce(file.good(), "Could not write binary template to '" + path + "'!");
+}
+
+}
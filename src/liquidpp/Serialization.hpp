@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "config.h"
+#include "Template.hpp"
+#include "LiteralPool.hpp"
+#include "TagFactory.hpp"
+#include "FilterFactory.hpp"
+#include "tags/Block.hpp"
+#include "Misc.hpp"
+
+#include <boost/variant/get.hpp>
+
+// Versioned binary representation of parsed templates.
+//
+// Layout (native byte order, checked on loading):
+//   header   magic, version, byte order mark, pool size, segment count
+//   pool     the bytes referenced by the nodes (views are stored as offsets)
+//   segments position information of the pool (see LiteralPool::Segment)
+//   nodes    the node tree
+//
+// Tags are stored by name and value and are created by the tag factory on
+// loading, filters are re-bound by name through the filter factory. Loaded
+// templates reference the pool of the binary data without copying it.
+namespace liquidpp
+{
+
+namespace binary
+{
+constexpr char Magic[4] = {'L', 'Q', 'P', 'B'};
+constexpr std::uint32_t Version = 1;
+constexpr std::uint32_t ByteOrderMark = 0x01020304;
+
+enum class TokenType : std::uint8_t { Operator, Value, Path };
+enum class ValueType : std::uint8_t { View, String, Integral, FloatingPoint, Bool, Tag };
+enum class KeyType : std::uint8_t { Name, Index, IndexVariable };
+
+class Reader
+{
+public:
+   explicit Reader(string_view data)
+      : mData(data)
+   {
+   }
+
+   template<typename T>
+   T read()
+   {
+      static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be read!");
+      enforce(mPos + sizeof(T) <= mData.size(), "Binary template is truncated!");
+
+      T res;
+      std::memcpy(&res, mData.data() + mPos, sizeof(T));
+      mPos += sizeof(T);
+      return res;
+   }
+
+   string_view bytes(size_t size)
+   {
+      enforce(size <= mData.size() - mPos, "Binary template is truncated!");
+      auto res = mData.substr(mPos, size);
+      mPos += size;
+      return res;
+   }
+
+   size_t count()
+   {
+      return read<std::uint32_t>();
+   }
+
+   bool atEnd() const
+   {
+      return mPos == mData.size();
+   }
+
+   void setPool(string_view pool)
+   {
+      mPool = pool;
+   }
+
+   string_view view();
+   Key key();
+   Path path();
+   Value value();
+   Expression::Token token();
+
+   template<typename FilterFactoryT>
+   Expression::FilterChain filterChain(const FilterFactoryT& filterFac)
+   {
+      Expression::FilterChain res;
+      const auto cnt = count();
+      for (size_t i = 0; i < cnt; i++)
+      {
+         Expression::FilterData filter;
+         filter.name = view();
+         filter.function = filterFac(filter.name);
+         if (!filter)
+            throw Exception("Unknown filter!", filter.name);
+
+         const auto argCnt = count();
+         for (size_t j = 0; j < argCnt; j++)
+            filter.args.push_back(token());
+         res.push_back(std::move(filter));
+      }
+
+      return res;
+   }
+
+   template<typename TagFactoryT, typename FilterFactoryT>
+   void body(BlockBody& res)
+   {
+      const auto cnt = count();
+      for (size_t i = 0; i < cnt; i++)
+         res.nodeList.push_back(node<TagFactoryT, FilterFactoryT>());
+   }
+
+   template<typename TagFactoryT, typename FilterFactoryT>
+   Node node()
+   {
+      switch (static_cast<NodeType>(read<std::uint8_t>()))
+      {
+         case NodeType::String:
+            return view();
+         case NodeType::Variable:
+         {
+            Variable var{token()};
+            if (read<std::uint8_t>())
+               var.filterChain = filterChain(FilterFactoryT{});
+            return var;
+         }
+         case NodeType::UnevaluatedTag:
+            return rawTag();
+         case NodeType::Tag:
+         {
+            auto raw = rawTag();
+            auto name = raw.name;
+            bool isBlock = read<std::uint8_t>() != 0;
+
+            auto tag = TagFactoryT{}(FilterFactoryT{}, std::move(raw));
+            if (!tag)
+               throw Exception("Unknown tag!", name);
+
+            auto block = dynamic_cast<Block*>(tag.get());
+            enforce(isBlock == (block != nullptr), "Tag of binary template does not match the tag factory!");
+            if (block)
+            {
+               body<TagFactoryT, FilterFactoryT>(block->body);
+               block->finalize();
+            }
+
+            return std::unique_ptr<const IRenderable>{std::move(tag)};
+         }
+      }
+
+      throw std::runtime_error("Invalid node type in binary template!");
+   }
+
+private:
+   UnevaluatedTag rawTag();
+
+   string_view mData;
+   size_t mPos{0};
+   string_view mPool;
+};
+
+// Header and pool of binary data (the reader is positioned at the nodes)
+std::shared_ptr<const LiteralPool> readPool(Reader& reader, std::shared_ptr<const LiteralPool> data);
+}
+
+// Binary representation of a parsed template (see Serialization.hpp)
+std::string serialize(const Template& templ);
+
+void saveBinary(const Template& templ, const std::string& path);
+
+// Loads a template from binary data, the template keeps data alive and references it
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+Template deserialize(std::shared_ptr<const LiteralPool> data)
+{
+   binary::Reader reader{data->data()};
+
+   Template res;
+   res.literals = binary::readPool(reader, std::move(data));
+   try {
+      reader.body<TagFactoryT, FilterFactoryT>(res.root);
+      enforce(reader.atEnd(), "Unexpected data after end of binary template!");
+      res.bindSlots();
+   } catch(Exception& e) {
+      e.position() = res.findPosition(e.errorPart());
+      throw;
+   }
+
+   return res;
+}
+
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+Template deserialize(string_view data)
+{
+   return deserialize<TagFactoryT, FilterFactoryT>(LiteralPool::copy(data));
+}
+
+// Maps a file written by saveBinary() into memory and loads it
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+Template loadBinary(const std::string& path)
+{
+   return deserialize<TagFactoryT, FilterFactoryT>(LiteralPool::mapFile(path));
+}
+
+}
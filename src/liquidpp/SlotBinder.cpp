@@ -0,0 +1,223 @@
+#include "SlotBinder.hpp"
+
+#include "Variable.hpp"
+#include "tags/Assign.hpp"
+#include "tags/Capture.hpp"
+#include "tags/Case.hpp"
+#include "tags/Conditional.hpp"
+#include "tags/Cycle.hpp"
+#include "tags/For.hpp"
+#include "tags/Increment.hpp"
+
+#include <boost/variant/get.hpp>
+
+namespace liquidpp
+{
+
+namespace
+{
+// Tags are const after parsing only
+IRenderable* toTag(Node& node)
+{
+   if (type(node) != NodeType::Tag)
+      return nullptr;
+
+   return const_cast<IRenderable*>(boost::get<std::unique_ptr<const IRenderable>>(node).get());
+}
+}
+
+SlotIndex SlotBinder::run(BlockBody& root)
+{
+   // names assigned anywhere are bound everywhere, they may be read before
+   // the assignment (e.g. in a loop)
+   collect(root);
+   bind(root);
+   return mCount;
+}
+
+void SlotBinder::collect(BlockBody& body)
+{
+   for (auto&& node : body.nodeList)
+   {
+      auto tag = toTag(node);
+      if (!tag)
+         continue;
+
+      if (auto assign = dynamic_cast<Assign*>(tag))
+         assign->slot = documentSlot(to_string(assign->variableName));
+      else if (auto capture = dynamic_cast<Capture*>(tag))
+         capture->slot = documentSlot(to_string(capture->variableName));
+      else if (auto cycle = dynamic_cast<Cycle*>(tag))
+         cycle->slot = documentSlot(cycle->keyName);
+      else if (auto increment = dynamic_cast<Increment*>(tag))
+         increment->slot = documentSlot(increment->keyName);
+      else if (auto decrement = dynamic_cast<Decrement*>(tag))
+         decrement->slot = documentSlot(decrement->keyName);
+
+      if (auto block = dynamic_cast<Block*>(tag))
+         collect(block->body);
+   }
+}
+
+void SlotBinder::bind(BlockBody& body, NodeRange range)
+{
+   for (auto i = range.begin; i < range.end; i++)
+   {
+      auto& node = body.nodeList[i];
+      if (type(node) == NodeType::Variable)
+      {
+         auto& variable = boost::get<Variable>(node);
+         bind(variable.variable);
+         if (variable.filterChain)
+            bind(*variable.filterChain);
+      }
+      else if (auto tag = toTag(node))
+         bindTag(*tag);
+   }
+}
+
+void SlotBinder::bind(BlockBody& body)
+{
+   bind(body, NodeRange{0, body.nodeList.size()});
+}
+
+void SlotBinder::bindTag(IRenderable& tag)
+{
+   if (auto forTag = dynamic_cast<For*>(&tag))
+   {
+      if (forTag->rangeExpression)
+      {
+         bind(forTag->rangeExpression->startIdxToken);
+         bind(forTag->rangeExpression->endIdxToken);
+      }
+      bind(forTag->rangePath);
+      if (forTag->limitToken)
+         bind(*forTag->limitToken);
+      if (forTag->offsetToken)
+         bind(*forTag->offsetToken);
+
+      forTag->loopVariableSlot = mCount++;
+      forTag->forloopSlot = mCount++;
+      mLoopScopes.emplace_back(forTag->loopVariable, forTag->loopVariableSlot);
+      mLoopScopes.emplace_back("forloop", forTag->forloopSlot);
+      bind(forTag->body, forTag->loopBody);
+      mLoopScopes.resize(mLoopScopes.size() - 2);
+
+      bind(forTag->body, forTag->elseBody);
+      return;
+   }
+
+   if (auto ifTag = dynamic_cast<If*>(&tag))
+   {
+      bind(ifTag->expression);
+      for (auto&& branch : ifTag->branches)
+      {
+         if (branch.condition)
+            bind(*branch.condition);
+      }
+   }
+   else if (auto unlessTag = dynamic_cast<Unless*>(&tag))
+   {
+      bind(unlessTag->expression);
+      for (auto&& branch : unlessTag->branches)
+      {
+         if (branch.condition)
+            bind(*branch.condition);
+      }
+   }
+   else if (auto caseTag = dynamic_cast<Case*>(&tag))
+   {
+      bind(caseTag->valueToken);
+      for (auto&& branch : caseTag->branches)
+      {
+         for (auto&& value : branch.values)
+            bind(value);
+      }
+   }
+   else if (auto assign = dynamic_cast<Assign*>(&tag))
+   {
+      bind(assign->assignment);
+      bind(assign->filterChain);
+   }
+   else if (auto cycle = dynamic_cast<Cycle*>(&tag))
+   {
+      for (auto&& value : cycle->values)
+         bind(value);
+   }
+
+   if (auto block = dynamic_cast<Block*>(&tag))
+      bind(block->body);
+}
+
+template<typename Keys>
+void SlotBinder::bindKeys(Keys& keys)
+{
+   for (auto&& key : keys)
+   {
+      if (key.isIndexVariable())
+         bindKeys(key.mutableIndexVariable());
+   }
+
+   if (keys.empty() || !keys[0].isName())
+      return;
+
+   auto slot = lookup(keys[0].name());
+   keys[0].bindSlot(slot);
+
+   // 'forloop.index' etc. of the enclosing loop read its counters directly
+   if (keys.size() == 2 && keys[1].isName())
+   {
+      bool counter = keys[0] == "forloop" && slot != NoSlot;
+      keys[1].bindLoopProperty(counter ? toLoopProperty(keys[1].name()) : LoopProperty::None);
+   }
+}
+
+void SlotBinder::bind(Path& path)
+{
+   bindKeys(path);
+}
+
+void SlotBinder::bind(Expression::Token& token)
+{
+   if (token.which() == 2)
+      bind(boost::get<Path>(token));
+}
+
+void SlotBinder::bind(Expression& expression)
+{
+   for (auto&& token : expression.tokens)
+      bind(token);
+}
+
+void SlotBinder::bind(Expression::FilterChain& filterChain)
+{
+   for (auto&& filter : filterChain)
+   {
+      for (auto&& arg : filter.args)
+         bind(arg);
+   }
+}
+
+SlotIndex SlotBinder::documentSlot(const std::string& name)
+{
+   auto itr = mDocumentSlots.find(name);
+   if (itr != mDocumentSlots.end())
+      return itr->second;
+
+   mDocumentSlots.emplace(name, mCount);
+   return mCount++;
+}
+
+SlotIndex SlotBinder::lookup(string_view name) const
+{
+   for (auto itr = mLoopScopes.rbegin(); itr != mLoopScopes.rend(); ++itr)
+   {
+      if (itr->first == name)
+         return itr->second;
+   }
+
+   auto itr = mDocumentSlots.find(to_string(name));
+   return itr == mDocumentSlots.end() ? NoSlot : itr->second;
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+#include "BlockBody.hpp"
+
+namespace liquidpp
+{
+
+struct Block;
+
+// Binds the template local variables to slots of the document scope (see
+// Template::bindSlots()).
+//
+// Every 'for' tag gets a slot for its loop variable and one for 'forloop',
+// references in the loop body are bound to them ('forloop.<property>' to the
+// counter of the loop, see LoopProperty). Names set by 'assign' or
+// 'capture' get one slot per name, the counters of 'increment', 'decrement'
+// and 'cycle' one per counter. All other names are looked up by name. A
+// reference to a slot that is not set yet (e.g. a name assigned later) falls
+// back to the lookup by name.
+class SlotBinder
+{
+public:
+   // Returns the number of slots
+   SlotIndex run(BlockBody& root);
+
+private:
+   void collect(BlockBody& body);
+   void bind(BlockBody& body, NodeRange range);
+   void bind(BlockBody& body);
+   void bindTag(IRenderable& tag);
+
+   template<typename Keys>
+   void bindKeys(Keys& keys);
+   void bind(Path& path);
+   void bind(Expression::Token& token);
+   void bind(Expression& expression);
+   void bind(Expression::FilterChain& filterChain);
+
+   SlotIndex documentSlot(const std::string& name);
+   SlotIndex lookup(string_view name) const;
+
+   std::unordered_map<std::string, SlotIndex> mDocumentSlots;
+   std::vector<std::pair<string_view, SlotIndex>> mLoopScopes;
+   SlotIndex mCount{0};
+};
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <future>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "parser.hpp"
+
+// Parsing of templates that arrive in chunks (e.g. large generated documents
+// read from storage).
+//
+// Every chunk is parsed as soon as it is fed. A node that is incomplete at the
+// end of a chunk (e.g. a tag straddling the chunk boundary) is carried over
+// into the next chunk, long strings are split into several nodes instead.
+// The input is never concatenated: the template keeps the parsed chunks alive
+// (see LiteralPool::join()), so besides the template itself only the current
+// chunk and the carried part are held.
+namespace liquidpp
+{
+
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+class StreamingParser
+{
+public:
+   StreamingParser() = default;
+
+   StreamingParser(const StreamingParser&) = delete;
+   StreamingParser& operator=(const StreamingParser&) = delete;
+
+   // Parses the complete nodes of chunk (and of the part carried over)
+   void feed(string_view chunk)
+   {
+      enforce(!mFinished, "Streamed template is finished already!");
+
+      std::string content;
+      content.reserve(mCarry.size() + chunk.size());
+      content += mCarry;
+      content.append(chunk.data(), chunk.size());
+      parsePiece(std::move(content), false);
+   }
+
+   // Parses the rest of the input and returns the template (owning its input)
+   Template finish()
+   {
+      enforce(!mFinished, "Streamed template is finished already!");
+
+      parsePiece(std::move(mCarry), true);
+      mFinished = true;
+      try {
+         mParser.finish();
+         mTemplate.bindSlots();
+      } catch(Exception& e) {
+         e.position() = findPosition(e.errorPart());
+         throw;
+      }
+
+      mTemplate.literals = LiteralPool::join(std::move(mPieces));
+      return std::move(mTemplate);
+   }
+
+private:
+   void parsePiece(std::string content, bool final)
+   {
+      auto piece = LiteralPool::piece(std::move(content), mOffset, mPosition);
+      mPieces.push_back(piece);
+
+      auto rest = piece->data();
+      try {
+         mParser.parse(rest, final);
+      } catch(Exception& e) {
+         mFinished = true;
+         e.position() = findPosition(e.errorPart());
+         throw;
+      }
+
+      const size_t consumed = piece->size() - rest.size();
+      for (auto c : piece->data().substr(0, consumed))
+      {
+         if (c == '\n')
+         {
+            mPosition.line++;
+            mPosition.column = 1;
+         }
+         else
+            mPosition.column++;
+      }
+      mOffset += consumed;
+      mCarry = to_string(rest);
+
+      // nothing references the piece
+      if (consumed == 0)
+         mPieces.pop_back();
+   }
+
+   Exception::Position findPosition(string_view needle) const
+   {
+      return LiteralPool::join(mPieces)->findPosition(needle);
+   }
+
+   Template mTemplate;
+   impl::Parser<TagFactoryT, FilterFactoryT> mParser{mTemplate.root};
+   std::vector<std::shared_ptr<const LiteralPool>> mPieces;
+   std::string mCarry;
+   size_t mOffset{0};
+   Exception::Position mPosition{1, 1};
+   bool mFinished{false};
+};
+
+// Parses a template from a stream in chunks of chunkSize bytes, the next chunk
+// is read while the current one is parsed
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+Template parseStream(std::istream& input, size_t chunkSize = 64 * 1024)
+{
+   enforce(chunkSize > 0, "Chunk size has to be positive!");
+
+   auto read = [&input, chunkSize] {
+      std::string chunk(chunkSize, '\0');
+      input.read(&chunk[0], chunkSize);
+      chunk.resize(static_cast<size_t>(input.gcount()));
+      return chunk;
+   };
+
+   StreamingParser<TagFactoryT, FilterFactoryT> parser;
+   auto next = std::async(std::launch::async, read);
+   for (auto chunk = next.get(); !chunk.empty(); chunk = next.get())
+   {
+      next = std::async(std::launch::async, read);
+      parser.feed(chunk);
+   }
+
+   enforce(!input.bad(), "Could not read the template stream!");
+   return parser.finish();
+}
+
+}
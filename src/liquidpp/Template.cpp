@@ -1,6 +1,12 @@
 #include "Template.hpp"
 
 #include "Context.hpp"
+#include "Dependencies.hpp"
+#include "LiteralPool.hpp"
+#include "Optimizer.hpp"
+#include "Program.hpp"
+#include "Serialization.hpp"
+#include "SlotBinder.hpp"
 
 namespace liquidpp {
 
@@ -26,9 +32,13 @@ std::string Template::operator()(const Context &context) const {
     auto maxResSize = mMaxResultSize;
     res.reserve(maxResSize);
     Context mutableScopedContext{&context};
+    mutableScopedContext.setSlotCount(slotCount);
 
-    for (auto &&node : root.nodeList)
-      renderNode(mutableScopedContext, node, res);
+    if (program)
+      enforceNormal(program->render(mutableScopedContext, res));
+    else
+      enforceNormal(renderNodes(mutableScopedContext, root,
+                                NodeRange{0, root.nodeList.size()}, res));
 
     if (res.size() > maxResSize)
        mMaxResultSize = res.size();
@@ -39,7 +49,54 @@ std::string Template::operator()(const Context &context) const {
   }
 }
 
+void Template::compile() { program = std::make_shared<Program>(*this); }
+
+void Template::optimize(const boost::optional<std::locale> &locale) {
+  Optimizer optimizer{locale, constants};
+  if (!optimizer.run(root))
+    return;
+
+  // the template does not mirror the source node by node anymore
+  rootOffsets.clear();
+  constants = optimizer.constants();
+  bindSlots();
+  if (program)
+    compile();
+}
+
+Template Template::specialize(const Context &staticData,
+                              const std::vector<std::string> &staticPaths) const {
+  auto res = deserialize(serialize(*this));
+
+  std::vector<Path> paths;
+  for (auto &&path : staticPaths)
+    paths.push_back(toPath(path));
+
+  Optimizer optimizer{staticData, std::move(paths), res.constants};
+  if (optimizer.run(res.root)) {
+    res.constants = optimizer.constants();
+    res.bindSlots();
+  }
+  if (program)
+    res.compile();
+  return res;
+}
+
+std::vector<std::string> Template::dependencies() const {
+  DependencyCollector collector;
+  collector.run(root);
+  return collector.result();
+}
+
+void Template::bindSlots() {
+  SlotBinder binder;
+  slotCount = binder.run(root);
+}
+
 Exception::Position Template::findPosition(string_view needle) const {
+  if (literals)
+    return literals->findPosition(needle);
+
   Exception::Position res;
   auto &templ = root.templateRange;
 
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <locale>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "config.h"
 #include "BlockBody.hpp"
 
@@ -7,13 +12,61 @@ namespace liquidpp {
 
 std::ostream& operator<<(std::ostream& os, NodeType t);
 
-void renderNode(Context& context, const Node& node, std::string& res);
+class Context;
+class Program;
+class LiteralPool;
 
 struct Template {
    BlockBody root;
    mutable size_t mMaxResultSize{0};
+   std::shared_ptr<const Program> program;
+
+   // Number of slots bound by bindSlots()
+   SlotIndex slotCount{0};
+
+   // Memory referenced by the nodes if the template owns its source
+   // (see SourceStorage), the caller keeps the source alive otherwise
+   std::shared_ptr<const LiteralPool> literals;
+
+   // Text of literals folded or merged by optimize()
+   std::shared_ptr<const LiteralPool> constants;
+
+   // Source offset of every node in root (see reparse())
+   std::vector<size_t> rootOffsets;
 
    std::string operator()(const Context& context) const;
+
+   // Lowers the node tree to a flat bytecode program (see Program.hpp) that
+   // is used for all further renderings instead of walking the tree
+   void compile();
+
+   // Evaluates pure filters on constant values, removes comments and
+   // statically known branches and merges adjacent literals (see
+   // Optimizer.hpp). Filters depending on the locale are only folded if the
+   // locale of the render contexts is passed. Has to happen before compile().
+   void optimize(const boost::optional<std::locale>& locale = boost::none);
+
+   // Copy of the template for render contexts that share the values of
+   // staticData below staticPaths ("settings", "shop.locale"), e.g. by layering
+   // over its frozen values. Variables, conditions, loops and 'case' tags
+   // depending only on them are evaluated and folded into literal text, the
+   // copy is optimized, too (see Optimizer.hpp). Tags and filters are
+   // re-created by the default factories (see Serialization.hpp).
+   Template specialize(const Context& staticData, const std::vector<std::string>& staticPaths) const;
+
+   template <typename... Paths>
+   Template specialize(const Context& staticData, const Paths&... staticPaths) const {
+      return specialize(staticData, std::vector<std::string>{to_string(string_view{staticPaths})...});
+   }
+
+   // Data paths the template may read from the context, loop variables and
+   // aliases are resolved to their source (see Dependencies.hpp)
+   std::vector<std::string> dependencies() const;
+
+   // Binds loop variables and the names set by the template to numbered slots
+   // of the render context (see SlotBinder.hpp), done by all ways to create
+   // a template
+   void bindSlots();
       
    Exception::Position findPosition(string_view needle) const;
 };
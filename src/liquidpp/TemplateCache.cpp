@@ -0,0 +1,248 @@
+#include "TemplateCache.hpp"
+
+#include "parser.hpp"
+#include "LiteralPool.hpp"
+#include "Misc.hpp"
+
+namespace liquidpp
+{
+
+Template TemplateCache::defaultParser(string_view content)
+{
+   return parse(content);
+}
+
+TemplateCache::TemplateCache()
+   : TemplateCache(defaultOptions())
+{
+}
+
+TemplateCache::TemplateCache(Options options, Parser parser)
+   : mOptions(options), mParser(std::move(parser))
+{
+   if (mOptions.shardCount == 0)
+      mOptions.shardCount = 1;
+
+   // every shard gets an equal share of the limits (but has room for at least one entry)
+   if (mOptions.maxBytes)
+      mMaxBytesPerShard = std::max<size_t>(mOptions.maxBytes / mOptions.shardCount, 1);
+   if (mOptions.maxEntries)
+      mMaxEntriesPerShard = std::max<size_t>(mOptions.maxEntries / mOptions.shardCount, 1);
+
+   mShards.reserve(mOptions.shardCount);
+   for (size_t i = 0; i < mOptions.shardCount; i++)
+      mShards.push_back(std::make_unique<Shard>());
+}
+
+TemplateCache::Key TemplateCache::key(string_view str)
+{
+   return Key{str, StringViewHash{}(str)};
+}
+
+std::shared_ptr<const Template> TemplateCache::templateOf(const EntryPtr& entry)
+{
+   // shares the ownership of the entry (and so of the source)
+   return std::shared_ptr<const Template>(entry, &entry->templ);
+}
+
+TemplateCache::Shard& TemplateCache::shardFor(const Key& key) const
+{
+   return *mShards[key.hash % mShards.size()];
+}
+
+TemplateCache::Index& TemplateCache::indexOf(Shard& shard, const Entry& entry) const
+{
+   return entry.name.empty() ? shard.byContent : shard.byName;
+}
+
+TemplateCache::EntryPtr TemplateCache::makeEntry(std::string name, std::string source) const
+{
+   auto entry = std::make_shared<Entry>();
+   entry->name = std::move(name);
+   entry->source = std::move(source);
+
+   // the entry is not moved anymore, so the template may reference its source
+   entry->templ = mParser(entry->source);
+
+   // entries keyed by content need their source as key
+   auto& templ = entry->templ;
+   if (mOptions.compact && !entry->name.empty() && !templ.literals)
+   {
+      templ.literals = LiteralPool::compact(templ);
+      if (templ.literals)
+      {
+         entry->source.clear();
+         entry->source.shrink_to_fit();
+      }
+   }
+
+   if (mOptions.compile)
+      templ.compile();
+
+   // nested nodes are not accounted, the sources dominate the memory usage
+   entry->bytes = sizeof(Entry) + entry->name.size() + entry->source.size()
+                + (templ.literals ? templ.literals->size() : 0)
+                + templ.root.nodeList.size() * sizeof(Node);
+   return entry;
+}
+
+std::shared_ptr<const Template> TemplateCache::lookup(Shard& shard, Index& index, const Key& key)
+{
+   auto itr = index.find(key);
+   if (itr == index.end())
+      return nullptr;
+
+   shard.lru.splice(shard.lru.begin(), shard.lru, itr->second);
+   mHits++;
+   return templateOf(*itr->second);
+}
+
+std::shared_ptr<const Template> TemplateCache::insert(Shard& shard, EntryPtr entry, bool replace)
+{
+   auto& index = indexOf(shard, *entry);
+   auto entryKey = key(entry->name.empty() ? entry->source : entry->name);
+
+   std::lock_guard<std::mutex> lock(shard.mutex);
+   auto itr = index.find(entryKey);
+   if (itr != index.end())
+   {
+      // inserted by another thread in the meantime
+      if (!replace)
+      {
+         shard.lru.splice(shard.lru.begin(), shard.lru, itr->second);
+         return templateOf(*itr->second);
+      }
+
+      remove(shard, itr->second);
+   }
+
+   shard.lru.push_front(entry);
+   shard.bytes += entry->bytes;
+   index.emplace(entryKey, shard.lru.begin());
+   evict(shard);
+
+   return templateOf(entry);
+}
+
+void TemplateCache::remove(Shard& shard, LruList::iterator itr)
+{
+   auto entry = *itr;
+   auto& index = indexOf(shard, *entry);
+   index.erase(key(entry->name.empty() ? entry->source : entry->name));
+   shard.bytes -= entry->bytes;
+   shard.lru.erase(itr);
+}
+
+void TemplateCache::evict(Shard& shard)
+{
+   auto exceedsLimits = [&]{
+      if (mMaxBytesPerShard && shard.bytes > mMaxBytesPerShard)
+         return true;
+      if (mMaxEntriesPerShard && shard.lru.size() > mMaxEntriesPerShard)
+         return true;
+      return false;
+   };
+
+   // the most recently used entry is never evicted
+   while (shard.lru.size() > 1 && exceedsLimits())
+   {
+      remove(shard, std::prev(shard.lru.end()));
+      mEvictions++;
+   }
+}
+
+std::shared_ptr<const Template> TemplateCache::get(string_view content)
+{
+   auto contentKey = key(content);
+   auto& shard = shardFor(contentKey);
+   {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      if (auto res = lookup(shard, shard.byContent, contentKey))
+         return res;
+   }
+
+   // parse without holding the lock
+   mMisses++;
+   return insert(shard, makeEntry(std::string{}, to_string(content)), false);
+}
+
+std::shared_ptr<const Template> TemplateCache::get(string_view name, const Loader& loader)
+{
+   enforce(!name.empty(), "Template name may not be empty!");
+
+   auto nameKey = key(name);
+   auto& shard = shardFor(nameKey);
+   {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      if (auto res = lookup(shard, shard.byName, nameKey))
+         return res;
+   }
+
+   mMisses++;
+   return insert(shard, makeEntry(to_string(name), loader()), false);
+}
+
+std::shared_ptr<const Template> TemplateCache::put(std::string name, std::string content)
+{
+   enforce(!name.empty(), "Template name may not be empty!");
+
+   auto& shard = shardFor(key(name));
+   return insert(shard, makeEntry(std::move(name), std::move(content)), true);
+}
+
+std::shared_ptr<const Template> TemplateCache::find(string_view name)
+{
+   auto nameKey = key(name);
+   auto& shard = shardFor(nameKey);
+
+   std::lock_guard<std::mutex> lock(shard.mutex);
+   auto res = lookup(shard, shard.byName, nameKey);
+   if (!res)
+      mMisses++;
+   return res;
+}
+
+bool TemplateCache::erase(string_view name)
+{
+   auto nameKey = key(name);
+   auto& shard = shardFor(nameKey);
+
+   std::lock_guard<std::mutex> lock(shard.mutex);
+   auto itr = shard.byName.find(nameKey);
+   if (itr == shard.byName.end())
+      return false;
+
+   remove(shard, itr->second);
+   return true;
+}
+
+void TemplateCache::clear()
+{
+   for (auto&& shard : mShards)
+   {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      shard->byName.clear();
+      shard->byContent.clear();
+      shard->lru.clear();
+      shard->bytes = 0;
+   }
+}
+
+TemplateCache::Statistics TemplateCache::statistics() const
+{
+   Statistics res;
+   res.hits = mHits;
+   res.misses = mMisses;
+   res.evictions = mEvictions;
+
+   for (auto&& shard : mShards)
+   {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      res.entries += shard->lru.size();
+      res.bytes += shard->bytes;
+   }
+
+   return res;
+}
+
+}
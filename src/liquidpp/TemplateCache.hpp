@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+#include "Template.hpp"
+
+namespace liquidpp
+{
+
+// Thread safe, bounded cache of parsed templates.
+//
+// A Template only references its source, so the cache owns the source of every
+// entry. Returned templates share the ownership of their entry and stay valid
+// after they got evicted. Templates are keyed by a name or by their content.
+// Entries are distributed over independently locked shards, each shard evicts
+// its least recently used entries as soon as it exceeds its share of the limits.
+class TemplateCache
+{
+public:
+   using Parser = std::function<Template(string_view)>;
+   using Loader = std::function<std::string()>;
+
+   struct Options
+   {
+      size_t maxBytes;   // 0: unlimited
+      size_t maxEntries; // 0: unlimited
+      size_t shardCount;
+      bool compile;      // compile templates to bytecode (see Template::compile())
+      bool compact;      // named templates keep only the bytes they reference (see LiteralPool)
+   };
+
+   struct Statistics
+   {
+      size_t hits{0};
+      size_t misses{0};
+      size_t evictions{0};
+      size_t entries{0};
+      size_t bytes{0};
+   };
+
+   static Options defaultOptions()
+   {
+      return {64 * 1024 * 1024, 0, 16, false, true};
+   }
+
+   static Template defaultParser(string_view content);
+
+   TemplateCache();
+   explicit TemplateCache(Options options, Parser parser = &defaultParser);
+
+   TemplateCache(const TemplateCache&) = delete;
+   TemplateCache& operator=(const TemplateCache&) = delete;
+
+   // Template keyed by its content (parsed on a miss)
+   std::shared_ptr<const Template> get(string_view content);
+
+   // Template keyed by name (loaded and parsed on a miss)
+   std::shared_ptr<const Template> get(string_view name, const Loader& loader);
+
+   // Adds or replaces the template with the given name
+   std::shared_ptr<const Template> put(std::string name, std::string content);
+
+   // Template with the given name or nullptr if it is not cached
+   std::shared_ptr<const Template> find(string_view name);
+
+   bool erase(string_view name);
+   void clear();
+
+   Statistics statistics() const;
+
+private:
+   struct Entry
+   {
+      std::string name; // empty for entries keyed by content
+      std::string source;
+      Template templ;
+      size_t bytes{0};
+   };
+
+   using EntryPtr = std::shared_ptr<const Entry>;
+   using LruList = std::list<EntryPtr>;
+
+   struct Key
+   {
+      string_view str;
+      size_t hash;
+
+      bool operator==(const Key& other) const
+      {
+         return str == other.str;
+      }
+   };
+
+   struct KeyHash
+   {
+      size_t operator()(const Key& key) const
+      {
+         return key.hash;
+      }
+   };
+
+   using Index = std::unordered_map<Key, LruList::iterator, KeyHash>;
+
+   struct Shard
+   {
+      mutable std::mutex mutex;
+      LruList lru; // most recently used entry first
+      Index byName;
+      Index byContent;
+      size_t bytes{0};
+   };
+
+   Options mOptions;
+   Parser mParser;
+   size_t mMaxBytesPerShard{0};
+   size_t mMaxEntriesPerShard{0};
+   std::vector<std::unique_ptr<Shard>> mShards;
+
+   std::atomic<size_t> mHits{0};
+   std::atomic<size_t> mMisses{0};
+   std::atomic<size_t> mEvictions{0};
+
+   static Key key(string_view str);
+   static std::shared_ptr<const Template> templateOf(const EntryPtr& entry);
+
+   Shard& shardFor(const Key& key) const;
+   Index& indexOf(Shard& shard, const Entry& entry) const;
+   EntryPtr makeEntry(std::string name, std::string source) const;
+   std::shared_ptr<const Template> lookup(Shard& shard, Index& index, const Key& key);
+   std::shared_ptr<const Template> insert(Shard& shard, EntryPtr entry, bool replace);
+   void remove(Shard& shard, LruList::iterator itr);
+   void evict(Shard& shard);
+};
+
+}
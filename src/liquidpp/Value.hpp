@@ -132,6 +132,14 @@ public:
   Value &operator=(const Value &) = default;
   Value &operator=(Value &&) = default;
 
+  // Sets a copy of sv, reusing the memory of a previous copy
+  void assign(string_view sv) {
+    if (auto str = boost::get<std::string>(&data))
+      str->assign(sv.data(), sv.size());
+    else
+      data = std::string(sv.data(), sv.size());
+  }
+
   static Value reference(string_view sv) {
     Value res;
     res.data = sv;
@@ -288,13 +296,15 @@ private:
     }
   };
 
+public:
+  // Values of different types (besides strings and numbers) are unequal and
+  // not ordered
   template <template <typename> class C>
   bool compareWith(const Value &other) const {
     Compare<C<void>> comp;
     return boost::apply_visitor(comp, this->data, other.data);
   }
 
-public:
   bool operator==(const Value &other) const {
     return compareWith<std::equal_to>(other);
   }
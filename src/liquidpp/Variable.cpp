@@ -15,7 +15,10 @@ bool Variable::operator==(const Variable& other) const {
 
 void Variable::render(Context& context, std::string& out) const {
    auto&& val = Expression::value(context, variable, filterChain ? boost::optional<const Expression::FilterChain&>{*filterChain} : boost::none);
+   append(out, val);
+}
 
+void Variable::append(std::string& out, const Value& val) {
    if (val.isStringViewRepresentable())
    {
       auto sv = *val;
@@ -28,6 +28,8 @@ struct Variable {
    bool operator==(const Variable& other) const;
 
    void render(Context& context, std::string& out) const;
+
+   static void append(std::string& out, const Value& val);
 };
 
 }
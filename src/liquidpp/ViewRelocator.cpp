@@ -0,0 +1,115 @@
+#include "ViewRelocator.hpp"
+
+#include "tags/Tag.hpp"
+
+#include <boost/variant/get.hpp>
+
+namespace liquidpp
+{
+
+void ViewRelocator::operator()(Key& key) const
+{
+   if (key.isName())
+   {
+      auto name = key.name();
+      (*this)(name);
+      key.relocateName(name);
+   }
+   else if (key.isIndexVariable())
+      each(key.mutableIndexVariable());
+}
+
+void ViewRelocator::operator()(Path& path) const
+{
+   each(path);
+}
+
+void ViewRelocator::operator()(Value& val) const
+{
+   if (!val.isStringView())
+      return;
+
+   auto sv = *val;
+   (*this)(sv);
+   val = Value::reference(sv);
+}
+
+void ViewRelocator::operator()(Expression::Token& token) const
+{
+   switch (token.which())
+   {
+      case 1:
+         (*this)(boost::get<Value>(token));
+         break;
+      case 2:
+         (*this)(boost::get<Path>(token));
+         break;
+   }
+}
+
+void ViewRelocator::operator()(Expression::FilterData& filter) const
+{
+   (*this)(filter.name);
+   each(filter.args);
+}
+
+void ViewRelocator::operator()(Expression::FilterChain& filterChain) const
+{
+   each(filterChain);
+}
+
+void ViewRelocator::operator()(Expression& expression) const
+{
+   each(expression.tokens);
+}
+
+void ViewRelocator::operator()(Expression::Lexeme& lexeme) const
+{
+   (*this)(lexeme.text);
+}
+
+void ViewRelocator::operator()(Variable& variable) const
+{
+   (*this)(variable.variable);
+   (*this)(variable.filterChain);
+}
+
+bool ViewRelocator::operator()(Node& node) const
+{
+   switch (type(node))
+   {
+      case NodeType::String:
+         (*this)(boost::get<string_view>(node));
+         return true;
+      case NodeType::Variable:
+         (*this)(boost::get<Variable>(node));
+         return true;
+      case NodeType::UnevaluatedTag:
+         return boost::get<UnevaluatedTag>(node).relocate(*this);
+      case NodeType::Tag:
+      {
+         auto tag = dynamic_cast<const Tag*>(boost::get<std::unique_ptr<const IRenderable>>(node).get());
+         if (!tag)
+            return false;
+
+         // tags are created mutable by the factories, the node only guards them on rendering
+         return const_cast<Tag*>(tag)->relocate(*this);
+      }
+   }
+
+   assert(false);
+   return false;
+}
+
+bool ViewRelocator::operator()(BlockBody& body) const
+{
+   for (auto&& node : body.nodeList)
+   {
+      if (!(*this)(node))
+         return false;
+   }
+
+   return true;
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+
+#include "config.h"
+#include "BlockBody.hpp"
+
+namespace liquidpp
+{
+
+// Passes every string view of a node tree to a callback that may rebase it
+// to another buffer (see LiteralPool::compact()).
+//
+// Tags take part via Tag::relocate(), the visiting functions return false if
+// the tree contains a tag that does not support relocation.
+class ViewRelocator
+{
+public:
+   using Callback = std::function<void(string_view&)>;
+
+   explicit ViewRelocator(Callback callback)
+      : mCallback(std::move(callback))
+   {
+   }
+
+   void operator()(string_view& sv) const
+   {
+      mCallback(sv);
+   }
+
+   void operator()(Key& key) const;
+   void operator()(Path& path) const;
+   void operator()(Value& val) const;
+   void operator()(Expression::Token& token) const;
+   void operator()(Expression::FilterData& filter) const;
+   void operator()(Expression::FilterChain& filterChain) const;
+   void operator()(Expression& expression) const;
+   void operator()(Expression::Lexeme& lexeme) const;
+   void operator()(Variable& variable) const;
+
+   bool operator()(Node& node) const;
+   bool operator()(BlockBody& body) const;
+
+   template<typename T>
+   void operator()(boost::optional<T>& opt) const
+   {
+      if (opt)
+         (*this)(*opt);
+   }
+
+   template<typename RangeT>
+   void each(RangeT& range) const
+   {
+      for (auto&& elem : range)
+         (*this)(elem);
+   }
+
+private:
+   Callback mCallback;
+};
+
+}
@@ -0,0 +1,112 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace liquidpp
+{
+
+struct WorkerPool::Job
+{
+   Job(size_t count, const std::function<void(size_t)>& task)
+      : count(count), task(task)
+   {
+   }
+
+   const size_t count;
+   const std::function<void(size_t)>& task;
+   std::atomic<size_t> next{0};
+
+   std::mutex mutex;
+   std::condition_variable finished;
+   size_t done{0};
+};
+
+WorkerPool& WorkerPool::instance()
+{
+   static WorkerPool pool{std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1};
+   return pool;
+}
+
+WorkerPool::WorkerPool(size_t threads)
+{
+   for (size_t i = 0; i < threads; i++)
+      mThreads.emplace_back([this] { work(); });
+}
+
+WorkerPool::~WorkerPool()
+{
+   {
+      std::lock_guard<std::mutex> lock{mMutex};
+      mStopping = true;
+   }
+   mWakeUp.notify_all();
+
+   for (auto&& thread : mThreads)
+      thread.join();
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)>& task)
+{
+   if (count == 0)
+      return;
+
+   auto job = std::make_shared<Job>(count, task);
+   if (count > 1 && !mThreads.empty())
+   {
+      {
+         std::lock_guard<std::mutex> lock{mMutex};
+         mJobs.push_back(job);
+      }
+      mWakeUp.notify_all();
+   }
+
+   process(*job);
+
+   std::unique_lock<std::mutex> lock{job->mutex};
+   job->finished.wait(lock, [&] { return job->done == job->count; });
+}
+
+void WorkerPool::work()
+{
+   for (;;)
+   {
+      std::shared_ptr<Job> job;
+      {
+         std::unique_lock<std::mutex> lock{mMutex};
+         mWakeUp.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+         if (mStopping)
+            return;
+
+         job = mJobs.front();
+         // all calls of the job are taken, the remaining ones are in progress
+         if (job->next >= job->count)
+         {
+            mJobs.pop_front();
+            continue;
+         }
+      }
+
+      process(*job);
+   }
+}
+
+void WorkerPool::process(Job& job)
+{
+   size_t processed = 0;
+   for (size_t i = job.next++; i < job.count; i = job.next++)
+   {
+      job.task(i);
+      processed++;
+   }
+
+   if (processed == 0)
+      return;
+
+   std::lock_guard<std::mutex> lock{job.mutex};
+   job.done += processed;
+   if (job.done == job.count)
+      job.finished.notify_all();
+}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+
+namespace liquidpp
+{
+
+// Process wide pool of worker threads (one per hardware thread) used for
+// parallel rendering of loops (see For::renderParallel()).
+//
+// The calling thread works on its own jobs, too. Jobs never wait for other
+// jobs, so jobs started by workers or by many threads at once can not
+// deadlock the pool (at worst the caller does all the work).
+class WorkerPool
+{
+public:
+   static WorkerPool& instance();
+
+   explicit WorkerPool(size_t threads);
+   ~WorkerPool();
+
+   WorkerPool(const WorkerPool&) = delete;
+   WorkerPool& operator=(const WorkerPool&) = delete;
+
+   // Number of threads working on a job (including the caller)
+   size_t concurrency() const
+   {
+      return mThreads.size() + 1;
+   }
+
+   // Calls task(i) for all i in [0, count) and returns when all calls are
+   // finished. task must not throw.
+   void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+   struct Job;
+
+   void work();
+   static void process(Job& job);
+
+   std::mutex mMutex;
+   std::condition_variable mWakeUp;
+   std::deque<std::shared_ptr<Job>> mJobs;
+   bool mStopping{false};
+   std::vector<std::thread> mThreads;
+};
+
+}
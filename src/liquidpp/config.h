@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include <experimental/string_view>
+
+/* #undef LIQUIDPP_HAVE_RAPIDJSON */
+#define LIQUIDPP_HAVE_BOOST_SMALL_VECTOR
+/* #undef LIQUIDPP_HAVE_PROTOBUF */
+
+#ifdef LIQUIDPP_HAVE_BOOST_SMALL_VECTOR
+#include <boost/container/small_vector.hpp>
+#endif
+
+#include <gsl/span>
+
+namespace liquidpp
+{
+   using string_view = std::experimental::string_view;
+
+#ifdef LIQUIDPP_HAVE_BOOST_SMALL_VECTOR
+   template<typename T, size_t S>
+   using SmallVector = boost::container::small_vector<T, S>;
+#else
+   template<typename T, size_t S>
+   using SmallVector = std::vector<T>;
+#endif
+   
+   // std::string_view has no member to_string and the others can not be converted implicitly
+   inline std::string to_string(string_view sv)
+   {
+      return std::string{sv.data(), sv.size()};
+   }
+   
+   namespace literals
+   {
+      /*TODO:constexpr*/ inline string_view operator""_sv(const char* str, std::size_t len)
+      {
+         return string_view{str, len};
+      }
+   }
+}
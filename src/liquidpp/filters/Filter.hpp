@@ -26,6 +26,15 @@ struct Filter {
                      FuncContext1Arg, FuncContext2Arg>;
   FilterFunction mFunction;
 
+  // Whether the result only depends on the input and the arguments, pure
+  // filters on constant inputs are folded by Template::optimize()
+  enum class Purity {
+    Impure,       // e.g. depends on the current time or on the context
+    Pure,
+    PureForLocale // depends on the locale of the context only
+  };
+  Purity purity{Purity::Impure};
+
   Filter() = default;
 
   template<typename T>
@@ -31,6 +31,7 @@ struct Map {
     path.insert(path.end(), basePath.begin(), basePath.end());
     path.push_back(Key{});
     path.insert(path.end(), subPath.begin(), subPath.end());
+    bindBuiltinProperties(path);
     auto &idxKey = path[basePath.size()];
 
     for (size_t i = 0; i < cnt; i++) {
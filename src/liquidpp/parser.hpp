@@ -6,6 +6,8 @@
 #include "tags/UnevaluatedTag.hpp"
 #include "TagFactory.hpp"
 #include "FilterFactory.hpp"
+#include "LiteralPool.hpp"
+#include "Scanner.hpp"
 
 #include <boost/variant/get.hpp>
 
@@ -18,25 +20,21 @@ namespace
 {
 inline string_view popString(string_view& str) {
    const auto len = str.size();
-   for (size_t i = 0; i < len; i++) {
-      const auto c = str[i];
-      if (c == '{' || c == '%') {
-         if (i != 0 && str[i-1] == '{') {
-            auto res = str.substr(0, i-1);
-            str.remove_prefix(i-1);
-
-            if (i+1 < len && str[2] == '-')
-            {
-               auto idx = res.find_last_not_of(" \t\r\n");
-               if (idx == std::string::npos)
-                  return string_view{};
-               else
-                  res.remove_suffix(res.size() - idx - 1);
-            }
+   const auto idx = scanner::findTagOpening(str.data(), len);
+   if (idx != scanner::npos) {
+      auto res = str.substr(0, idx);
+      str.remove_prefix(idx);
 
-            return res;
-         }
+      if (idx+2 < len && str[2] == '-')
+      {
+         auto pos = res.find_last_not_of(" \t\r\n");
+         if (pos == std::string::npos)
+            return string_view{};
+         else
+            res.remove_suffix(res.size() - pos - 1);
       }
+
+      return res;
    }
 
    auto res = str;
@@ -44,40 +42,41 @@ inline string_view popString(string_view& str) {
    return res;
 }
 
+// Index of the '}' of the first closing + '}' behind the tag opening at the
+// start of str, npos if the node is not terminated
+inline size_t findNodeEnd(string_view str, char closing) {
+   if (str.size() < 4)
+      return scanner::npos;
+
+   const auto idx = scanner::findPair(str.data() + 2, str.size() - 2, closing, '}');
+   return idx == scanner::npos ? idx : idx + 3;
+}
+
 inline string_view popTag(string_view& str, bool& stripNextString) {
    assert(str.substr(0, 2) == "{%");
 
-   auto len = str.size();
-   for (size_t i = 3; i < len; i++) {
-      if (str[i] == '}') {
-         if (str[i-1] == '%') {
-            stripNextString = str[i-2] == '-';
-            auto res = str.substr(0, i+1);
-            str.remove_prefix(i+1);
-            return res;
-         }
-      }
-   }
+   const auto i = findNodeEnd(str, '%');
+   if (i == scanner::npos)
+      throw Exception("Unterminated tag!", str.substr(0, 2));
 
-   throw Exception("Unterminated tag!", str.substr(0, 2));
+   stripNextString = str[i-2] == '-';
+   auto res = str.substr(0, i+1);
+   str.remove_prefix(i+1);
+   return res;
 }
 
 inline string_view popVariable(string_view& str, bool& stripNextString) {
    assert(str.substr(0, 2) == "{{");
 
-   auto len = str.size();
-   for (size_t i = 3; i < len; i++) {
-      if (str[i] == '}') {
-         if (str[i-1] == '}') {
-            stripNextString = str[i-2] == '-';
-            auto res = str.substr(0, i+1);
-            str.remove_prefix(i+1);
-            return res;
-         }
-      }
-   }
+   const auto i = findNodeEnd(str, '}');
+   if (i == scanner::npos)
+      throw Exception("Unterminated tag!", str.substr(0, 2));
 
-   throw Exception("Unterminated tag!", str.substr(0, 2));
+   stripNextString = str[i-2] == '-';
+   auto res = str.substr(0, i+1);
+   str.remove_prefix(i+1);
+   return res;
+}
 }
 
 struct BlockItem
@@ -85,6 +84,7 @@ struct BlockItem
    BlockBody* body;
    boost::optional<std::string> endTagName;
    string_view openingTagName;
+   Block* tag{nullptr};
 };
 
 inline void ensureValidTagName(string_view tagName)
@@ -113,106 +113,191 @@ inline void ensureValidTagName(string_view tagName)
    }
 }
 
+// Index of the '{' or '%' of the first tag opening ("{{" or "{%") in str
+inline size_t findTagOpening(string_view str) {
+   const auto idx = scanner::findTagOpening(str.data(), str.size());
+   return idx == scanner::npos ? idx : idx + 1;
+}
+
+// Whether str starts with a node that can be parsed without further input
+inline bool isCompleteNode(string_view str) {
+   const auto len = str.size();
+   if (len < 2)
+      return false;
+
+   if (str[0] == '{' && (str[1] == '{' || str[1] == '%'))
+      return findNodeEnd(str, str[1] == '{' ? '}' : '%') != scanner::npos;
+
+   // the character behind the tag opening decides about whitespace control
+   auto idx = findTagOpening(str);
+   return idx != std::string::npos && idx + 1 < len;
+}
+
+// Parser state that can be fed with consecutive parts of a template.
+//
+// rootOffsets (if set) receives the offset of every node added to rootBlock
+// relative to the content passed to parse().
 template<typename TagFactoryT, typename FilterFactoryT>
-void fastParser(string_view content, BlockBody& rootBlock)
+class Parser
 {
-   SmallVector<BlockItem, 4> stack{{&rootBlock}};
-   auto block = &stack.back();
-
-   enum class State
+public:
+   explicit Parser(BlockBody& rootBlock, std::vector<size_t>* rootOffsets = nullptr)
+      : mStack{{&rootBlock}}, mRootOffsets(rootOffsets)
    {
-      String,
-      Variable,
-      Tag
-   };
-
-   auto getType = [](string_view cont){
-      auto prefix = cont.substr(0, 2);
-      if (prefix == "{{")
-         return State::Variable;
-      if (prefix == "{%")
-         return State::Tag;
-      return State::String;
-   };
-
-   bool stripLeadingWhitespace = false;
-   while(!content.empty())
+   }
+
+   Parser(const Parser&) = delete;
+   Parser& operator=(const Parser&) = delete;
+
+   // Parses the nodes at the beginning of content and removes them from it.
+   // Unless final, a node is only parsed if it is complete (the rest stays in
+   // content) and the beginning of a long string is split off as a node of its own.
+   void parse(string_view& content, bool final)
    {
-      if (stripLeadingWhitespace)
+      const char* begin = content.data();
+      auto block = &mStack.back();
+
+      enum class State
       {
-         auto pos = content.find_first_not_of(" \t\r\n");
-         if (pos != std::string::npos)
-            content.remove_prefix(pos);
-         else
-            return;
-         stripLeadingWhitespace = false;
-      }
+         String,
+         Variable,
+         Tag
+      };
+
+      auto getType = [](string_view cont){
+         auto prefix = cont.substr(0, 2);
+         if (prefix == "{{")
+            return State::Variable;
+         if (prefix == "{%")
+            return State::Tag;
+         return State::String;
+      };
 
-      switch(getType(content))
+      while(!content.empty())
       {
-         case State::String:
-            block->body->nodeList.emplace_back(popString(content));
-            break;
-         case State::Tag:
+         if (mStripLeadingWhitespace)
          {
-            UnevaluatedTag rawTag{popTag(content, stripLeadingWhitespace)};
-            if (block->endTagName && rawTag.name == *block->endTagName)
+            auto pos = content.find_first_not_of(" \t\r\n");
+            if (pos == std::string::npos)
             {
-               stack.resize(stack.size()-1);
-               block = &stack.back();
+               // the whitespace may continue in the next part
+               content.remove_prefix(content.size());
+               return;
             }
-            else
+            content.remove_prefix(pos);
+            mStripLeadingWhitespace = false;
+         }
+
+         if (!final && !isCompleteNode(content))
+         {
+            splitString(content, begin);
+            return;
+         }
+
+         if (mRootOffsets && mStack.size() == 1)
+            mRootOffsets->push_back(content.data() - begin);
+
+         switch(getType(content))
+         {
+            case State::String:
+               block->body->nodeList.emplace_back(popString(content));
+               break;
+            case State::Tag:
             {
-               auto tag = TagFactoryT{}(FilterFactoryT{}, std::move(rawTag));
-               if (tag)
+               UnevaluatedTag rawTag{popTag(content, mStripLeadingWhitespace)};
+               if (block->endTagName && rawTag.name == *block->endTagName)
                {
-                  auto subBlock = dynamic_cast<Block*>(tag.get());
-                  block->body->nodeList.push_back(std::move(tag));
-                  if (subBlock)
-                  {
-                     std::string endTagName = "end";
-                     endTagName.append(subBlock->name.data(), subBlock->name.size());
-                     stack.push_back({&subBlock->body, std::move(endTagName), subBlock->name});
-                     block = &stack.back();
-                  }
+                  block->tag->finalize();
+                  mStack.resize(mStack.size()-1);
+                  block = &mStack.back();
                }
                else
                {
-                  ensureValidTagName(rawTag.name);
-                  block->body->nodeList.push_back(std::move(rawTag));
+                  auto tag = TagFactoryT{}(FilterFactoryT{}, std::move(rawTag));
+                  if (tag)
+                  {
+                     auto subBlock = dynamic_cast<Block*>(tag.get());
+                     block->body->nodeList.push_back(std::move(tag));
+                     if (subBlock)
+                     {
+                        std::string endTagName = "end";
+                        endTagName.append(subBlock->name.data(), subBlock->name.size());
+                        mStack.push_back({&subBlock->body, std::move(endTagName), subBlock->name, subBlock});
+                        block = &mStack.back();
+                     }
+                  }
+                  else
+                  {
+                     ensureValidTagName(rawTag.name);
+                     block->body->nodeList.push_back(std::move(rawTag));
+                  }
                }
+               break;
             }
-            break;
-         }
-         case State::Variable:
-         {
-            auto varStr = popVariable(content, stripLeadingWhitespace);
-            varStr.remove_prefix(varStr[2] == '-' ? 3 : 2);
-            if (varStr.size() < 3)
-               throw Exception("Tag is too short!", varStr);
-            varStr.remove_suffix(varStr[varStr.size() - 3] == '-' ? 3 : 2);
-            
-            auto tokens = Expression::splitTokens(varStr);
-            switch(tokens.size())
+            case State::Variable:
             {
-            case 0:
-               throw Exception("Variable definition without token!", varStr);
-            case 1:
-               block->body->nodeList.emplace_back(Variable(Expression::toToken(tokens[0])));
-               break;
-            default:
-               block->body->nodeList.emplace_back(Variable(Expression::toToken(tokens[0]), Expression::toFilterChain(FilterFactoryT{}, tokens, 1)));
+               auto varStr = popVariable(content, mStripLeadingWhitespace);
+               varStr.remove_prefix(varStr[2] == '-' ? 3 : 2);
+               if (varStr.size() < 3)
+                  throw Exception("Tag is too short!", varStr);
+               varStr.remove_suffix(varStr[varStr.size() - 3] == '-' ? 3 : 2);
+               
+               auto tokens = Expression::lex(varStr);
+               switch(tokens.size())
+               {
+               case 0:
+                  throw Exception("Variable definition without token!", varStr);
+               case 1:
+                  block->body->nodeList.emplace_back(Variable(Expression::toToken(tokens[0])));
+                  break;
+               default:
+                  block->body->nodeList.emplace_back(Variable(Expression::toToken(tokens[0]), Expression::toFilterChain(FilterFactoryT{}, tokens, 1)));
+                  break;
+               }
+
                break;
             }
-
-            break;
          }
       }
    }
-   
-   if (stack.size() > 1)
-      throw Exception("Closing tag is missing for this block tag! Please add '{% " + *stack.back().endTagName + " %}' to the template.", stack.back().openingTagName);
-}
+
+   // Has to be called after the last part was parsed
+   void finish()
+   {
+      if (mStack.size() > 1)
+         throw Exception("Closing tag is missing for this block tag! Please add '{% " + *mStack.back().endTagName + " %}' to the template.", mStack.back().openingTagName);
+   }
+
+private:
+   // Adds the beginning of an incomplete string as a node (keeping trailing
+   // whitespace and '{' that may belong to the next tag)
+   void splitString(string_view& content, const char* begin)
+   {
+      if (content.size() < 2 || (content[0] == '{' && (content[1] == '{' || content[1] == '%')))
+         return;
+
+      auto end = content.substr(0, findTagOpening(content)).find_last_not_of(" \t\r\n{");
+      if (end == std::string::npos)
+         return;
+
+      if (mRootOffsets && mStack.size() == 1)
+         mRootOffsets->push_back(content.data() - begin);
+      mStack.back().body->nodeList.emplace_back(content.substr(0, end + 1));
+      content.remove_prefix(end + 1);
+   }
+
+   SmallVector<BlockItem, 4> mStack;
+   std::vector<size_t>* mRootOffsets;
+   bool mStripLeadingWhitespace{false};
+};
+
+// rootOffsets (if set) receives the source offset of every node added to rootBlock
+template<typename TagFactoryT, typename FilterFactoryT>
+void fastParser(string_view content, BlockBody& rootBlock, std::vector<size_t>* rootOffsets = nullptr)
+{
+   Parser<TagFactoryT, FilterFactoryT> parser{rootBlock, rootOffsets};
+   parser.parse(content, true);
+   parser.finish();
 }
 
 }
@@ -223,11 +308,12 @@ Template parse(string_view content) {
    ast.root.templateRange = content;
    
    try {
-      impl::fastParser<TagFactoryT, FilterFactoryT>(content, ast.root);
+      impl::fastParser<TagFactoryT, FilterFactoryT>(content, ast.root, &ast.rootOffsets);
 
       //auto itr = flatNodes.nodeList.begin();
       //ast.root = impl::buildBlocks<TagFactoryT, FilterFactoryT>(itr, flatNodes.nodeList.end());
       ast.root.templateRange = content;
+      ast.bindSlots();
    } catch(Exception& e) {
       e.position() = ast.findPosition(e.errorPart());
       throw;
@@ -235,5 +321,45 @@ Template parse(string_view content) {
 
    return ast;
 }
+
+enum class SourceStorage {
+   Reference, // the nodes reference the source (which has to outlive the template)
+   Compact    // the bytes referenced by the nodes are copied to a pool owned by the template
+};
+
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+Template parse(string_view content, SourceStorage storage) {
+   auto res = parse<TagFactoryT, FilterFactoryT>(content);
+   if (storage == SourceStorage::Compact)
+   {
+      res.literals = LiteralPool::compact(res);
+      if (!res.literals)
+      {
+         // a tag does not support relocation: parse an owned copy instead
+         auto copy = LiteralPool::copy(content);
+         res = parse<TagFactoryT, FilterFactoryT>(copy->data());
+         res.literals = std::move(copy);
+      }
+   }
+
+   return res;
+}
+
+// Parses the content of a pool (with SourceStorage::Reference the template
+// keeps the pool alive and references it without a copy)
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+Template parse(std::shared_ptr<const LiteralPool> source, SourceStorage storage = SourceStorage::Reference) {
+   auto res = parse<TagFactoryT, FilterFactoryT>(source->data(), storage);
+   if (!res.literals)
+      res.literals = std::move(source);
+
+   return res;
+}
+
+// Parses a template file mapped into memory (see LiteralPool::mapFile())
+template<typename TagFactoryT = TagFactory, typename FilterFactoryT = FilterFactory>
+Template parseFile(const std::string& path, SourceStorage storage = SourceStorage::Reference) {
+   return parse<TagFactoryT, FilterFactoryT>(LiteralPool::mapFile(path), storage);
+}
 }
 
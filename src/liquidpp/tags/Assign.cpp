@@ -5,21 +5,25 @@ namespace liquidpp
 
 void Assign::render(Context& context, std::string& res) const
 {
-   auto v = Expression::value(context, assignment, filterChain);
+   store(context, Key{variableName, slot}, Expression::value(context, assignment, filterChain), assignment);
+}
+
+void Assign::store(Context& context, const Key& local, const Value& v, const Expression::Token& assignment)
+{
    if (v == ValueTag::Object || v.isRange())
    {
       if (v.isRange() && v.range().usesInlineValues())
       {
          auto& vals = v.range().inlineValues();
-         context.documentScopeContext().set(to_string(variableName), std::vector<std::string>{vals.begin(), vals.end()});
+         context.documentScopeContext().set(local, std::vector<std::string>{vals.begin(), vals.end()});
       }
       else
-         context.documentScopeContext().setLink(to_string(variableName), boost::get<Path>(assignment));
+         context.documentScopeContext().setLink(local, boost::get<Path>(assignment));
    }
    else if (v.isStringView())
-      context.documentScopeContext().set(to_string(variableName), v.toString());
+      context.documentScopeContext().set(local, v.toString());
    else
-      context.documentScopeContext().setLiquidValue(to_string(variableName), v);
+      context.documentScopeContext().setLiquidValue(local, v);
 }
 
 }
@@ -11,25 +11,38 @@ namespace liquidpp {
 
 struct Assign : public Tag {
    string_view variableName;
+   SlotIndex slot{NoSlot};
    Expression::Token assignment;
    Expression::FilterChain filterChain;
 
    template<typename FilterFactoryT>
-   Assign(const FilterFactoryT& filterFac, Tag&& tag)
+   Assign(const FilterFactoryT& filterFac, UnevaluatedTag&& tag)
     : Tag(std::move(tag))
    {
-      auto tokens = Expression::splitTokens(value);
+      auto& tokens = tag.tokens;
       if (tokens.size() < 3)
          throw Exception("Malformed assign statement (three tokens required)!", value);
       if (tokens[1] != "=")
          throw Exception("Malformed assign statement (assignment operator '=' required)!", value);
 
-      variableName = tokens[0];
+      variableName = tokens[0].text;
       Expression::assureIsSingleKeyPath(variableName);
       assignment = Expression::toToken(tokens[2]);
       filterChain = Expression::toFilterChain(filterFac, tokens, 3);
    }
 
+   bool relocate(const ViewRelocator& relocator) override
+   {
+      relocator(variableName);
+      relocator(assignment);
+      relocator(filterChain);
+      return relocateNameAndValue(relocator);
+   }
+
    void render(Context& context, std::string& res) const override final;
+
+   // Stores the value v of the assigned token (after the filters) in the
+   // document scope
+   static void store(Context& context, const Key& local, const Value& v, const Expression::Token& assignment);
 };
 }
@@ -2,6 +2,7 @@
 
 #include "Tag.hpp"
 #include "../BlockBody.hpp"
+#include "../ViewRelocator.hpp"
 
 namespace liquidpp
 {
@@ -11,6 +12,18 @@ struct Block : public Tag {
       : Tag(std::move(tag)) {}
 
    BlockBody body;
+
+   // Called by the parser as soon as the closing tag of the block was parsed
+   // (and again if Template::optimize() changed the body)
+   virtual void finalize()
+   {}
+
+protected:
+   bool relocateBlock(const ViewRelocator& relocator)
+   {
+      relocateNameAndValue(relocator);
+      return relocator(body);
+   }
 };
 
 }
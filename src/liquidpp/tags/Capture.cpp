@@ -5,23 +5,28 @@
 namespace liquidpp
 {
 
-Capture::Capture(Tag&& tag)
+Capture::Capture(UnevaluatedTag&& tag)
    : Block(std::move(tag)) {
-   auto tokens = Expression::splitTokens(tag.value);
+   auto& tokens = tag.tokens;
    if (tokens.size() != 1)
       throw Exception("Capture tag requires exactly once argument!", tag.value);
 
-   variableName = tokens[0];
+   variableName = tokens[0].text;
 }
 
 void Capture::render(Context& context, std::string& res) const
+{
+   enforceNormal(renderWithStatus(context, res));
+}
+
+RenderStatus Capture::renderWithStatus(Context& context, std::string& res) const
 {
    std::string varOut;
    
-   for (auto&& node : body.nodeList)
-      renderNode(context, node, varOut);
+   auto status = renderNodes(context, body, NodeRange{0, body.nodeList.size()}, varOut);
    
-   context.documentScopeContext().set(to_string(variableName), std::move(varOut));
+   context.documentScopeContext().set(Key{variableName, slot}, std::move(varOut));
+   return status;
 }
 
 }
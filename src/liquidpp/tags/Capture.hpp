@@ -9,10 +9,20 @@ namespace liquidpp
 struct Capture : public Block
 {
    string_view variableName;
+   SlotIndex slot{NoSlot};
 
-   Capture(Tag&& tag);
+   Capture(UnevaluatedTag&& tag);
+
+   bool relocate(const ViewRelocator& relocator) override
+   {
+      relocator(variableName);
+      return relocateBlock(relocator);
+   }
 
    void render(Context& context, std::string& res) const override final;
+
+   // 'break' or 'continue' stop capturing, the captured output is assigned
+   RenderStatus renderWithStatus(Context& context, std::string& res) const override final;
 };
 
 }
\ No newline at end of file
@@ -2,11 +2,13 @@
 
 #include "../Context.hpp"
 
+#include <cmath>
+
 namespace liquidpp {
 
-Case::Case(Tag&& tag)
+Case::Case(UnevaluatedTag&& tag)
    : Block(std::move(tag)) {
-   auto tokens = Expression::splitTokens(value);
+   auto& tokens = tag.tokens;
    if (tokens.size() != 1)
       throw Exception("Malformed 'case' tag!", value);
 
@@ -15,41 +17,194 @@ Case::Case(Tag&& tag)
 
 namespace
 {
-Value caseValue(Context& context, const Node& node)
+SmallVector<Expression::Token, 1> whenValues(const UnevaluatedTag& tag)
 {
-   auto& tag = boost::get<UnevaluatedTag>(node);
-   auto tokens = Expression::splitTokens(tag.value);
-   if (tokens.size() != 1)
-      throw Exception("'case' tag with invalid argument count!", tag.value);
-   return Expression::value(context, Expression::toToken(tokens[0]));
+   // when <value> [(,|or) <value>]...
+   auto& tokens = tag.tokens;
+   if (tokens.empty())
+      throw Exception("'when' tag without value!", tag.value);
+
+   SmallVector<Expression::Token, 1> res;
+   const size_t cnt = tokens.size();
+   for (size_t i = 0; i < cnt; i++)
+   {
+      auto& token = tokens[i];
+      if (i % 2)
+      {
+         if (token != "," && token != "or")
+            throw Exception("Expected ',' or 'or' as separator of 'when' values!", token.text);
+         if (i == cnt-1)
+            throw Exception("'when' tag is ending with a separator!", token.text);
+      }
+      else
+      {
+         res.push_back(Expression::toToken(token));
+         if (res.back().which() == 0)
+            throw Exception("Expected value in 'when' tag but got operator!", token.text);
+      }
+   }
+
+   return res;
 }
 }
 
-void Case::render(Context& context, std::string& res) const {
-   auto actualValue = Expression::value(context, valueToken);
+void Case::finalize() {
+   auto& nodes = body.nodeList;
+   const size_t cnt = nodes.size();
+
+   branches.clear();
+   for (size_t i = 0; i < cnt; i++)
+   {
+      bool isElse = isSpecificTag(nodes[i], "else");
+      if (!isElse && !isSpecificTag(nodes[i], "when"))
+         continue;
+
+      if (!branches.empty())
+         branches.back().nodes.end = i;
+
+      Branch branch;
+      branch.nodes.begin = i + 1;
+      if (!isElse)
+         branch.values = whenValues(boost::get<UnevaluatedTag>(nodes[i]));
+      branches.push_back(std::move(branch));
+   }
+
+   if (!branches.empty())
+      branches.back().nodes.end = cnt;
+
+   buildLookupTables();
+}
+
+bool Case::relocate(const ViewRelocator& relocator) {
+   relocator(valueToken);
+   for (auto&& branch : branches)
+      relocator.each(branch.values);
+
+   // the string table is keyed by views
+   buildLookupTables();
+   return relocateBlock(relocator);
+}
+
+void Case::buildLookupTables() {
+   useLookupTables = false;
+   stringLookup.clear();
+   integerLookup.clear();
+   firstElse = boost::none;
 
-   bool matchingCase = false;
-   for (auto&& node : this->body.nodeList)
+   const size_t cnt = branches.size();
+   for (size_t i = 0; i < cnt; i++)
    {
-      if (isSpecificTag(node, "when"))
+      auto& branch = branches[i];
+      if (branch.isElse())
       {
-         auto actStr = actualValue.toString();
-         auto caseStr = caseValue(context, node).toString();
-         if (actualValue == caseValue(context, node))
-            matchingCase = true;
-         else if (matchingCase)
-            break;
+         if (!firstElse)
+            firstElse = i;
+         continue;
       }
-      else if (isSpecificTag(node, "else"))
+
+      for (auto&& token : branch.values)
       {
-         if (matchingCase)
-            break;
+         if (token.which() != 1)
+            return;
+
+         auto& val = boost::get<Value>(token);
+         if (val.isStringType())
+            stringLookup.emplace(*val, i);
+         else if (val.isIntegral())
+            integerLookup.emplace(val.integralValue(), i);
          else
-            matchingCase = true;
+            return;
       }
-      else if (matchingCase)
-         renderNode(context, node, res);
    }
+
+   useLookupTables = true;
+}
+
+bool Case::matches(Context& context, const Branch& branch, const Value& actualValue) const {
+   for (auto&& token : branch.values)
+   {
+      if (actualValue == Expression::value(context, token))
+         return true;
+   }
+
+   return false;
 }
 
-}
\ No newline at end of file
+boost::optional<size_t> Case::lookup(const Value& actualValue) const {
+   if (actualValue.isStringType())
+   {
+      auto itr = stringLookup.find(*actualValue);
+      if (itr != stringLookup.end())
+         return itr->second;
+   }
+   else if (actualValue.isIntegral() || actualValue.isFloatingPoint())
+   {
+      std::intmax_t key = 0;
+      if (actualValue.isIntegral())
+         key = actualValue.integralValue();
+      else
+      {
+         // floating point values are equal to integers with the same value
+         auto d = actualValue.floatingPointValue();
+         if (d != std::floor(d) || d < static_cast<double>(std::numeric_limits<std::intmax_t>::min())
+             || d >= static_cast<double>(std::numeric_limits<std::intmax_t>::max()))
+            return boost::none;
+         key = static_cast<std::intmax_t>(d);
+      }
+
+      auto itr = integerLookup.find(key);
+      if (itr != integerLookup.end())
+         return itr->second;
+   }
+
+   return boost::none;
+}
+
+boost::optional<size_t> Case::firstMatch(Context& context, const Value& actualValue) const {
+   if (useLookupTables)
+   {
+      auto res = lookup(actualValue);
+      if (firstElse && (!res || *firstElse < *res))
+         return firstElse;
+      return res;
+   }
+
+   const size_t cnt = branches.size();
+   for (size_t i = 0; i < cnt; i++)
+   {
+      auto& branch = branches[i];
+      if (branch.isElse() || matches(context, branch, actualValue))
+         return i;
+   }
+
+   return boost::none;
+}
+
+void Case::render(Context& context, std::string& res) const {
+   enforceNormal(renderWithStatus(context, res));
+}
+
+RenderStatus Case::renderWithStatus(Context& context, std::string& res) const {
+   auto actualValue = Expression::value(context, valueToken);
+
+   auto first = firstMatch(context, actualValue);
+   if (!first)
+      return RenderStatus::Normal;
+
+   // directly following 'when' branches with a matching value are rendered too
+   const size_t cnt = branches.size();
+   for (size_t i = *first; i < cnt; i++)
+   {
+      auto& branch = branches[i];
+      if (i != *first && (branch.isElse() || !matches(context, branch, actualValue)))
+         break;
+
+      auto status = renderNodes(context, body, branch.nodes, res);
+      if (status != RenderStatus::Normal)
+         return status;
+   }
+
+   return RenderStatus::Normal;
+}
+
+}
@@ -2,17 +2,51 @@
 
 #include "Block.hpp"
 #include "../config.h"
+#include "../Misc.hpp"
+
+#include <unordered_map>
 
 namespace liquidpp
 {
 
 struct Case : public Block
 {
+   struct Branch
+   {
+      // values of the 'when' tag (empty for the 'else' branch)
+      SmallVector<Expression::Token, 1> values;
+      NodeRange nodes;
+
+      bool isElse() const
+      {
+         return values.empty();
+      }
+   };
+
    Expression::Token valueToken;
+   SmallVector<Branch, 4> branches;
+
+   // Index of the first branch per 'when' value (only used if all values are
+   // string or integer literals)
+   bool useLookupTables{false};
+   std::unordered_map<string_view, size_t, StringViewHash> stringLookup;
+   std::unordered_map<std::intmax_t, size_t> integerLookup;
+   boost::optional<size_t> firstElse;
 
-   Case(Tag&& tag);
+   Case(UnevaluatedTag&& tag);
+
+   void finalize() override;
+
+   bool relocate(const ViewRelocator& relocator) override;
 
    void render(Context& context, std::string& res) const override final;
+   RenderStatus renderWithStatus(Context& context, std::string& res) const override final;
+
+private:
+   bool matches(Context& context, const Branch& branch, const Value& actualValue) const;
+   boost::optional<size_t> firstMatch(Context& context, const Value& actualValue) const;
+   boost::optional<size_t> lookup(const Value& actualValue) const;
+   void buildLookupTables();
 };
 
-}
\ No newline at end of file
+}
@@ -11,5 +11,12 @@ struct Comment : public Block
    void render(Context& /*context*/, std::string& /*res*/) const override final
    {
    }
+
+   bool relocate(const ViewRelocator& relocator) override
+   {
+      // the content is never rendered, so it does not have to be kept
+      body.nodeList.clear();
+      return relocateNameAndValue(relocator);
+   }
 };
 }
\ No newline at end of file
@@ -10,61 +10,76 @@ namespace liquidpp {
 
 template<bool Inverted>
 struct Conditional : public Block {
+   struct Branch {
+      boost::optional<Expression> condition; // not set for 'else' branches
+      NodeRange nodes;
+   };
+
    Expression expression;
 
-   Conditional(Tag&& tag)
-      : Block{std::move(tag)}, expression{Expression::fromSequence(value)} {
+   // branches[0] is rendered if 'expression' matches (does not match for
+   // 'unless'), the following 'elsif'/'else' branches are checked in order
+   SmallVector<Branch, 2> branches;
+
+   Conditional(UnevaluatedTag&& tag)
+      : Block{std::move(tag)}, expression{Expression::fromLexemes(tag.tokens, value)} {
    }
 
-   void render(Context& context, std::string& res, bool matches) const {
-      if (matches)
-      {
-         for (auto&& node : body.nodeList)
-         {
-            if (isSpecificTag(node, "else") || isSpecificTag(node, "elsif"))
-               break;
+   void finalize() override {
+      auto& nodes = body.nodeList;
+      const size_t cnt = nodes.size();
 
-            renderNode(context, node, res);
-         }
-      }
-      else
+      branches.clear();
+      Branch current;
+      for (size_t i = 0; i < cnt; i++)
       {
-         bool active = false;
-         for (auto&& node : body.nodeList)
+         bool isElse = isSpecificTag(nodes[i], "else");
+         if (!isElse && !isSpecificTag(nodes[i], "elsif"))
+            continue;
+
+         current.nodes.end = i;
+         branches.push_back(std::move(current));
+
+         current = Branch{};
+         current.nodes.begin = i + 1;
+         if (!isElse)
          {
-            if (isSpecificTag(node, "else"))
-            {
-               if (active)
-                  break;
-               active = true;
-               continue;
-            }
-            else if (isSpecificTag(node, "elsif"))
-            {
-               if (active)
-                  break;
-               auto elsIfExpression = Expression::fromSequence(boost::get<UnevaluatedTag>(node).value);
-               if (elsIfExpression(context))
-               {
-                  active = true;
-                  continue;
-               }
-            }
-
-            if (active)
-               renderNode(context, node, res);
+            auto& elsif = boost::get<UnevaluatedTag>(nodes[i]);
+            current.condition = Expression::fromLexemes(elsif.tokens, elsif.value);
          }
       }
+
+      current.nodes.end = cnt;
+      branches.push_back(std::move(current));
+   }
+
+   bool relocate(const ViewRelocator& relocator) override {
+      relocator(expression);
+      for (auto&& branch : branches)
+         relocator(branch.condition);
+      return relocateBlock(relocator);
    }
 
    void render(Context& context, std::string& res) const override final {
-      if (expression(context))
-         render(context, res, !Inverted);
-      else
-         render(context, res, Inverted);
+      enforceNormal(renderWithStatus(context, res));
+   }
+
+   RenderStatus renderWithStatus(Context& context, std::string& res) const override final {
+      if (static_cast<bool>(expression(context)) != Inverted)
+         return renderNodes(context, body, branches[0].nodes, res);
+
+      const size_t cnt = branches.size();
+      for (size_t i = 1; i < cnt; i++)
+      {
+         auto& branch = branches[i];
+         if (!branch.condition || static_cast<bool>((*branch.condition)(context)))
+            return renderNodes(context, body, branch.nodes, res);
+      }
+
+      return RenderStatus::Normal;
    }
 };
 
 using If = Conditional<false>;
 using Unless = Conditional<true>;
-}
\ No newline at end of file
+}
@@ -9,9 +9,10 @@ namespace liquidpp {
 
 struct Cycle : public Tag {
   std::string keyName;
+  SlotIndex slot{NoSlot};
   SmallVector<Expression::Token, 4> values;
 
-  static std::string generateKeyName(Expression::RawTokens tokens) {
+  static std::string generateKeyName(const Expression::Lexemes &tokens) {
     std::string var;
     var += '\0';
     var += "cyc";
@@ -20,10 +21,10 @@ struct Cycle : public Tag {
     assert(!tokens.empty());
 
     if (tokens.size() == 1 || tokens[1] == ":")
-      hash = boost::hash_range(tokens[0].begin(), tokens[0].end());
+      hash = boost::hash_range(tokens[0].text.begin(), tokens[0].text.end());
     else {
       for (auto &&t : tokens) {
-        auto h = boost::hash_range(t.begin(), t.end());
+        auto h = boost::hash_range(t.text.begin(), t.text.end());
         boost::hash_combine(hash, h);
       }
     }
@@ -32,8 +33,8 @@ struct Cycle : public Tag {
     return var;
   }
 
-  Cycle(Tag &&tag) : Tag(std::move(tag)) {
-    auto tokens = Expression::splitTokens(value);
+  Cycle(UnevaluatedTag &&tag) : Tag(std::move(tag)) {
+    auto &tokens = tag.tokens;
     if (tokens.empty())
       throw Exception("Missing parameters!", value);
     keyName = generateKeyName(tokens);
@@ -47,15 +48,21 @@ struct Cycle : public Tag {
       if (i % 2 == 0)
         values.push_back(Expression::toToken(t));
       else if (t != ",")
-        throw Exception("Expected ',' as separator!", t);
+        throw Exception("Expected ',' as separator!", t.text);
     }
   }
 
+  bool relocate(const ViewRelocator &relocator) override {
+    relocator.each(values);
+    return relocateNameAndValue(relocator);
+  }
+
   void render(Context &context, std::string &res) const override final {
     auto &dsc = context.documentScopeContext();
+    const Key counter{keyName, slot};
 
     std::intmax_t numVal = 0;
-    auto val = dsc.get(keyName);
+    auto val = dsc.get(PathRef{&counter, 1});
     if (val.isIntegral())
       numVal = val.integralValue();
 
@@ -66,7 +73,7 @@ struct Cycle : public Tag {
     numVal++;
     if (static_cast<size_t>(numVal) == values.size())
       numVal = 0;
-    dsc.set(keyName, numVal);
+    dsc.set(counter, numVal);
   }
 };
 }
\ No newline at end of file
@@ -1,32 +1,90 @@
 #include "For.hpp"
 
 #include "../Context.hpp"
+#include "../Variable.hpp"
+#include "../WorkerPool.hpp"
+#include "Case.hpp"
+#include "Comment.hpp"
+#include "Conditional.hpp"
+
+#include <atomic>
 
 namespace liquidpp {
-For::For(Tag &&tag) : Block(std::move(tag)) {
-  auto tokens = Expression::splitTokens(value);
+namespace {
+// Whether rendering the nodes has no effect besides the output ('break' and
+// 'continue' are fine in nested loops)
+bool isPure(const BlockBody &body, NodeRange range, bool inNestedLoop) {
+  for (auto i = range.begin; i < range.end; i++) {
+    auto &node = body.nodeList[i];
+    switch (type(node)) {
+    case NodeType::String:
+    case NodeType::UnevaluatedTag:
+      break;
+    case NodeType::Variable: {
+      auto &variable = boost::get<Variable>(node);
+      if (variable.filterChain) {
+        for (auto &&filter : *variable.filterChain) {
+          if (filter.function.purity == filters::Filter::Purity::Impure)
+            return false;
+        }
+      }
+      break;
+    }
+    case NodeType::Tag: {
+      auto tag =
+          boost::get<std::unique_ptr<const IRenderable>>(node).get();
+      if (dynamic_cast<const Comment *>(tag))
+        break;
+      if (dynamic_cast<const Break *>(tag) ||
+          dynamic_cast<const Continue *>(tag)) {
+        if (!inNestedLoop)
+          return false;
+      } else if (auto forTag = dynamic_cast<const For *>(tag)) {
+        if (!isPure(forTag->body, forTag->loopBody, true) ||
+            !isPure(forTag->body, forTag->elseBody, inNestedLoop))
+          return false;
+      } else if (dynamic_cast<const If *>(tag) ||
+                 dynamic_cast<const Unless *>(tag) ||
+                 dynamic_cast<const Case *>(tag)) {
+        auto &block = static_cast<const Block &>(*tag);
+        if (!isPure(block.body, NodeRange{0, block.body.nodeList.size()},
+                    inNestedLoop))
+          return false;
+      } else
+        return false; // e.g. 'assign', 'capture', 'cycle' or custom tags
+      break;
+    }
+    }
+  }
+
+  return true;
+}
+}
+
+For::For(UnevaluatedTag &&tag) : Block(std::move(tag)) {
+  auto &tokens = tag.tokens;
   if (tokens.size() < 3)
     throw Exception("Not enough parameters in 'for' tag!", value);
 
-  loopVariable = tokens[0];
+  loopVariable = tokens[0].text;
   Expression::assureIsSingleKeyPath(loopVariable);
   
   if (tokens[1] != "in")
     throw Exception("Second token in 'for' tag has to be the 'in' keyword!",
-                    tokens[1]);
-  rangeExpression = toRangeDefinition(tokens[2]);
+                    tokens[1].text);
+  rangeExpression = toRangeDefinition(tokens[2].text);
   if (!rangeExpression)
-    rangePath = toPath(tokens[2]);
+    rangePath = toPath(tokens[2].text);
 
   auto cnt = tokens.size();
   for (size_t i = 3; i < cnt; i++) {
-    auto &key = tokens[i];
+    auto key = tokens[i].text;
 
     if (key == "limit") {
       if (i + 2 < cnt) {
         if (tokens[i + 1] != ":")
           throw Exception("Expected operator ':' after parameter name!",
-                          tokens[i + 1]);
+                          tokens[i + 1].text);
         limitToken = Expression::toToken(tokens[i + 2]);
         i += 2;
       } else
@@ -35,7 +93,7 @@ For::For(Tag &&tag) : Block(std::move(tag)) {
       if (i + 2 < cnt) {
         if (tokens[i + 1] != ":")
           throw Exception("Expected operator ':' after parameter name!",
-                          tokens[i + 1]);
+                          tokens[i + 1].text);
         offsetToken = Expression::toToken(tokens[i + 2]);
         i += 2;
       } else
@@ -47,6 +105,35 @@ For::For(Tag &&tag) : Block(std::move(tag)) {
   }
 }
 
+void For::finalize() {
+  auto &nodes = body.nodeList;
+  const size_t cnt = nodes.size();
+
+  loopBody = {0, cnt};
+  elseBody = {cnt, cnt};
+  for (size_t i = 0; i < cnt; i++) {
+    if (isSpecificTag(nodes[i], "else")) {
+      loopBody.end = i;
+      elseBody.begin = i + 1;
+      break;
+    }
+  }
+
+  parallelizable = isPure(body, loopBody, false);
+}
+
+bool For::relocate(const ViewRelocator &relocator) {
+  relocator(loopVariable);
+  if (rangeExpression) {
+    relocator(rangeExpression->startIdxToken);
+    relocator(rangeExpression->endIdxToken);
+  }
+  relocator(rangePath);
+  relocator(limitToken);
+  relocator(offsetToken);
+  return relocateBlock(relocator);
+}
+
 boost::optional<For::RangeExpression> For::toRangeDefinition(string_view sv) {
   if (sv.front() == '(') {
     if (sv.back() != ')')
@@ -74,129 +161,85 @@ Value For::LoopData::get(PathRef path) const {
     return ValueTag::Object;
   if (!path.empty())
     return ValueTag::SubValue;
+  if (!key.isName())
+    return ValueTag::Null;
 
-  if (key == "first")
-    return toValue(idx == 0);
-  if (key == "index")
-    return toValue(idx + 1);
-  if (key == "index0")
-    return toValue(idx);
-  if (key == "last")
-    return toValue(idx + 1 == size);
-  if (key == "length")
-    return toValue(size);
-  if (key == "rindex")
-    return toValue(size - idx);
-  if (key == "rindex0")
-    return toValue(size - idx - 1);
-
-  return ValueTag::Null;
-}
-
-struct RecursiveDepth {
-  size_t &depth;
-  const size_t pattern;
-
-  explicit RecursiveDepth(size_t &d)
-      : depth(d), pattern((1 << (10 - depth)) - 1) {
-    depth++;
-  }
+  return LoopCounters::get(toLoopProperty(key.name()));
+}
 
-  bool checkRequired(size_t i) const {
-    if (depth > 10)
-      return true;
+For::Watchdog::Watchdog(Context &context, const std::string &out,
+                        string_view tagName)
+    : mContext(context), mOut(out), mOutputSizeBefore(out.size()),
+      mPattern(context.recursiveDepth() < 10
+                   ? (1 << (10 - context.recursiveDepth())) - 1
+                   : 0),
+      mTagName(tagName) {
+  mContext.recursiveDepth()++;
+}
+
+For::Watchdog::~Watchdog() { mContext.recursiveDepth()--; }
 
-    if ((i & pattern) == pattern)
+void For::Watchdog::check(size_t i) const {
+  auto resSize = mOut.size();
+  if (resSize > mContext.maxOutputSize())
+    throw Exception("Maximal output size reached!", mTagName);
+
+  if (longRunning(i, resSize))
+    throw Exception("Long running loop with only few output detected!",
+                    mTagName);
+}
+
+bool For::Watchdog::passes(size_t i, size_t outputSize) const {
+  return outputSize <= mContext.maxOutputSize() && !longRunning(i, outputSize);
+}
+
+bool For::Watchdog::longRunning(size_t i, size_t outputSize) const {
+  auto depth = mContext.recursiveDepth();
+  if (depth > 10 || (i & mPattern) == mPattern) {
+    auto writtenInLoop = outputSize - mOutputSizeBefore;
+    if (writtenInLoop < (mContext.minOutputPer1024Loops() / depth))
       return true;
-    return false;
   }
+  return false;
+}
 
-  ~RecursiveDepth() { depth--; }
-};
-
-void For::render(Context &context, std::string &res) const {
-  size_t rangeExprStart = 0;
+For::Loop For::evaluate(Context &context) const {
+  Loop loop;
   size_t rangeExprEnd = 0;
-  Value val;
 
   if (rangeExpression) {
-    rangeExprStart = static_cast<size_t>(
+    loop.rangeExprStart = static_cast<size_t>(
         Expression::value(context, rangeExpression->startIdxToken)
             .integralValue());
     rangeExprEnd = static_cast<size_t>(
         Expression::value(context, rangeExpression->endIdxToken)
             .integralValue());
 
-    if (rangeExprStart > rangeExprEnd)
+    if (loop.rangeExprStart > rangeExprEnd)
       throw Exception("Start index of range is larger than its end!", value);
   } else
-    val = context.get(rangePath);
+    loop.range = context.get(rangePath);
 
-  size_t size = 0;
   if (rangeExpression)
-    size = rangeExprEnd - rangeExprStart + 1;
-  else if (val.isRange())
-    size = val.size();
-  else if (val.isSimpleValue())
-    size = 1;
-
-  auto getValue = [&](size_t i) mutable {
-    if (rangeExpression)
-      return std::make_tuple(toValue(rangeExprStart + i), Path{});
-    else if (val.isSimpleValue())
-      return std::make_tuple(val, Path{});
-    else if (val.isRange())
-      return Expression::value(context, val.range(), i, rangePath);
-
-    return std::make_tuple(Value{ValueTag::OutOfRange}, Path{});
-  };
+    loop.size = rangeExprEnd - loop.rangeExprStart + 1;
+  else if (loop.range.isRange())
+    loop.size = loop.range.size();
+  else if (loop.range.isSimpleValue())
+    loop.size = 1;
 
-  size_t offset = 0;
   if (offsetToken)
-    offset = static_cast<size_t>(
+    loop.offset = static_cast<size_t>(
         Expression::value(context, *offsetToken).integralValue());
 
-  size_t limit = size - offset;
+  loop.limit = loop.size - loop.offset;
   if (limitToken) {
     auto l = static_cast<size_t>(
         Expression::value(context, *limitToken).integralValue());
-    if (l < limit)
-      limit = l;
+    if (l < loop.limit)
+      loop.limit = l;
   }
 
-  if (limit == 0) {
-    bool elseFound = false;
-    for (auto &&node : body.nodeList) {
-      if (isSpecificTag(node, "else"))
-        elseFound = true;
-      else if (elseFound)
-        renderNode(context, node, res);
-    }
-    return;
-  }
-
-  auto beforOutputSize = res.size();
-  RecursiveDepth depth{context.recursiveDepth()};
-  for (size_t i = 0; i < limit; i++) {
-    size_t idx = i + offset;
-    if (reversed)
-      idx = size - offset - i - 1;
-
-    auto itm = getValue(idx);
-    if (!renderElement(context, res, std::get<0>(itm), std::get<1>(itm),
-                       LoopData{i, limit}))
-      break;
-
-    auto resSize = res.size();
-    if (resSize > context.maxOutputSize())
-      throw Exception("Maximal output size reached!", name);
-    if (depth.checkRequired(i)) {
-      auto writtenInLoop = resSize - beforOutputSize;
-      if (writtenInLoop < (context.minOutputPer1024Loops() / depth.depth))
-        throw Exception("Long running loop with only few output detected!",
-                        name);
-    }
-  }
+  return loop;
 }
 
 template <> struct Accessor<For::LoopData> : public std::true_type {
@@ -206,33 +249,157 @@ template <> struct Accessor<For::LoopData> : public std::true_type {
   }
 };
 
-bool For::renderElement(Context &context, std::string &res,
-                        const Value &currentVal, PathRef idxPath,
-                        LoopData forLoop) const {
-  Context loopVarContext(&context);
-  loopVarContext.set("forloop", forLoop);
+For::Scope::Scope(const For &tag, Context &context, const Loop &loop)
+    : mTag(tag), mContext(context), mLoop(loop),
+      mCounters(std::make_shared<LoopData>(0, loop.limit)) {
+  if (tag.loopVariableSlot == NoSlot || tag.forloopSlot == NoSlot)
+    mLocal = std::make_unique<Context>(&context);
+
+  this->context().set(Key{"forloop", tag.forloopSlot},
+                      std::shared_ptr<const LoopData>{mCounters});
+  if (!mLocal)
+    mPreviousCounters =
+        context.setLoopCounters(tag.forloopSlot, mCounters.get());
+}
+
+For::Scope::~Scope() {
+  if (!mLocal)
+    mContext.setLoopCounters(mTag.forloopSlot, mPreviousCounters);
+}
 
-  if (currentVal.isStringView())
-    loopVarContext.set(to_string(loopVariable), currentVal.toString());
-  else if (currentVal.isSimpleValue())
-    loopVarContext.setLiquidValue(to_string(loopVariable), currentVal);
-  else if (currentVal != ValueTag::OutOfRange)
-    loopVarContext.setLink(to_string(loopVariable), idxPath);
+bool For::Scope::bind(size_t i) {
+  auto &tag = mTag;
+  auto &loop = mLoop;
+
+  size_t idx = i + loop.offset;
+  if (tag.reversed)
+    idx = loop.size - loop.offset - i - 1;
+
+  Value currentVal;
+  if (tag.rangeExpression)
+    currentVal = toValue(loop.rangeExprStart + idx);
+  else if (loop.range.isSimpleValue())
+    currentVal = loop.range;
+  else if (loop.range.isRange())
+    currentVal = std::get<0>(
+        Expression::value(mContext, loop.range.range(), idx, tag.rangePath));
   else
+    currentVal = ValueTag::OutOfRange;
+
+  mCounters->idx = i;
+
+  auto &target = context();
+  const Key local{tag.loopVariable, tag.loopVariableSlot};
+  if (currentVal.isStringType())
+    target.setCopy(local, *currentVal);
+  else if (currentVal.isSimpleValue())
+    target.setLiquidValue(local, currentVal);
+  else if (currentVal != ValueTag::OutOfRange) {
+    if (mRange == nullptr)
+      mRange = &mContext.pinLink(tag.rangePath);
+    target.setElementLink(local, *mRange, loop.range.range().index(idx));
+  } else
     return false;
 
-  try {
-    for (auto &&node : body.nodeList) {
-      if (isSpecificTag(node, "else"))
+  return true;
+}
+
+void For::renderLoop(Context &context, std::string &res, const Loop &loop,
+                     const BodyRenderer &renderBody) const {
+  Watchdog watchdog{context, res, name};
+
+  size_t i = 0;
+  auto minParallelLoopSize = context.minParallelLoopSize();
+  if (parallelizable && minParallelLoopSize > 0 &&
+      loop.limit >= minParallelLoopSize) {
+    i = renderParallel(context, res, loop, watchdog, renderBody);
+    if (i == loop.limit)
+      return;
+  }
+
+  Scope scope{*this, context, loop};
+  for (; i < loop.limit; i++) {
+    if (!scope.bind(i) || !renderBody(scope.context(), res))
+      break;
+
+    watchdog.check(i);
+  }
+}
+
+size_t For::renderParallel(Context &context, std::string &res,
+                           const Loop &loop, const Watchdog &watchdog,
+                           const BodyRenderer &renderBody) const {
+  struct Chunk {
+    std::string out;
+    std::vector<size_t> ends; // size of out after each rendered element
+  };
+
+  auto &pool = WorkerPool::instance();
+  const size_t chunkSize =
+      std::max<size_t>(16, loop.limit / (pool.concurrency() * 4) + 1);
+  std::vector<Chunk> chunks((loop.limit + chunkSize - 1) / chunkSize);
+
+  // the output of the elements rendered so far (stops all chunks if the
+  // maximal output size is exceeded anyway)
+  std::atomic<size_t> written{0};
+  const size_t maxOutputSize = context.maxOutputSize();
+
+  pool.run(chunks.size(), [&](size_t c) {
+    auto &chunk = chunks[c];
+    const size_t begin = c * chunkSize;
+    const size_t end = std::min(begin + chunkSize, loop.limit);
+    chunk.ends.reserve(end - begin);
+
+    try {
+      Context detached{context, Context::Detached{}};
+      Scope scope{*this, detached, loop};
+      for (size_t i = begin; i < end && written <= maxOutputSize; i++) {
+        auto before = chunk.out.size();
+        if (!scope.bind(i) || !renderBody(scope.context(), chunk.out))
+          break;
+
+        chunk.ends.push_back(chunk.out.size());
+        written += chunk.out.size() - before;
+      }
+    } catch (...) {
+      // the element is rendered again serially (reporting the error)
+    }
+  });
+
+  size_t i = 0;
+  for (auto &&chunk : chunks) {
+    const size_t base = res.size();
+    const size_t chunkEnd = std::min(i + chunkSize, loop.limit);
+
+    size_t rendered = 0;
+    for (auto end : chunk.ends) {
+      if (!watchdog.passes(i, base + end))
         break;
-      renderNode(loopVarContext, node, res);
+      rendered = end;
+      i++;
     }
 
-    return true;
-  } catch (DoContinue &) {
-    return true;
-  } catch (DoBreak &) {
-    return false;
+    res.append(chunk.out, 0, rendered);
+    if (i < chunkEnd)
+      return i;
   }
+
+  return i;
+}
+
+void For::render(Context &context, std::string &res) const {
+  enforceNormal(renderWithStatus(context, res));
+}
+
+RenderStatus For::renderWithStatus(Context &context, std::string &res) const {
+  auto loop = evaluate(context);
+
+  if (loop.limit == 0)
+    return renderNodes(context, body, elseBody, res);
+
+  renderLoop(context, res, loop, [this](Context &c, std::string &out) {
+    return renderNodes(c, body, loopBody, out) != RenderStatus::Break;
+  });
+  return RenderStatus::Normal;
 }
 }
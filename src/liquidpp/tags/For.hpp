@@ -1,34 +1,51 @@
 #pragma once
 
 #include "../config.h"
+#include "../Accessor.hpp"
+#include "../Context.hpp"
 #include "Block.hpp"
 
+#include <functional>
+#include <memory>
+
 namespace liquidpp {
 
 class Value;
 
-struct DoBreak : public std::logic_error {
-  DoBreak() : std::logic_error("'break' tag outside of for-loop!") {}
-};
-
-struct DoContinue : public std::logic_error {
-  DoContinue() : std::logic_error("'continue' tag outside of for-loop!") {}
-};
-
 struct Break : public Tag {
   Break(Tag &&tag) : Tag(std::move(tag)) {}
 
+  // only reached outside of loops
   void render(Context &context, std::string &out) const override final {
     throw DoBreak{};
   }
+
+  RenderStatus renderWithStatus(Context &context,
+                                std::string &out) const override final {
+    return RenderStatus::Break;
+  }
+
+  bool relocate(const ViewRelocator &relocator) override {
+    return relocateNameAndValue(relocator);
+  }
 };
 
 struct Continue : public Tag {
   Continue(Tag &&tag) : Tag(std::move(tag)) {}
 
+  // only reached outside of loops
   void render(Context &context, std::string &out) const override final {
     throw DoContinue{};
   }
+
+  RenderStatus renderWithStatus(Context &context,
+                                std::string &out) const override final {
+    return RenderStatus::Continue;
+  }
+
+  bool relocate(const ViewRelocator &relocator) override {
+    return relocateNameAndValue(relocator);
+  }
 };
 
 struct For : public Block {
@@ -38,31 +55,129 @@ struct For : public Block {
   };
 
   string_view loopVariable;
+  SlotIndex loopVariableSlot{NoSlot};
+  SlotIndex forloopSlot{NoSlot};
   boost::optional<RangeExpression> rangeExpression;
   Path rangePath;
   boost::optional<Expression::Token> limitToken;
   boost::optional<Expression::Token> offsetToken;
   bool reversed{false};
 
-  For(Tag &&tag);
+  // nodes rendered per element and nodes rendered for empty ranges
+  NodeRange loopBody;
+  NodeRange elseBody;
 
-  struct LoopData {
-    size_t idx{0};
-    size_t size{0};
+  // The loop body has no effect besides its output (no tags setting
+  // variables, no 'break' or 'continue', only pure filters), its elements
+  // may be rendered in parallel (see Context::setMinParallelLoopSize())
+  bool parallelizable{false};
+
+  For(UnevaluatedTag &&tag);
+
+  void finalize() override;
+
+  bool relocate(const ViewRelocator &relocator) override;
 
+  // 'forloop' for paths not resolved at parse time (see LoopCounters)
+  struct LoopData : public LoopCounters {
     LoopData() = default;
 
-    LoopData(size_t idx, size_t size) : idx(idx), size(size) {}
+    LoopData(size_t idx, size_t size) : LoopCounters{idx, size} {}
 
     Value get(PathRef path) const;
   };
 
+  // Loop header (range, offset and limit) evaluated for one rendering
+  struct Loop {
+    Value range;
+    size_t rangeExprStart{0};
+    size_t size{0};
+    size_t offset{0};
+    size_t limit{0};
+  };
+
+  // Guards against exceeding the maximal output size and against long
+  // running loops with only few output
+  class Watchdog {
+  private:
+    Context &mContext;
+    const std::string &mOut;
+    const size_t mOutputSizeBefore;
+    const size_t mPattern;
+    string_view mTagName;
+
+  public:
+    Watchdog(Context &context, const std::string &out, string_view tagName);
+    ~Watchdog();
+
+    Watchdog(const Watchdog &) = delete;
+    Watchdog &operator=(const Watchdog &) = delete;
+
+    void check(size_t i) const;
+
+    // Whether check(i) passes with an output of the given size
+    bool passes(size_t i, size_t outputSize) const;
+
+  private:
+    bool longRunning(size_t i, size_t outputSize) const;
+  };
+
+  // Loop variables of one rendering of the loop. 'forloop' reads the counters
+  // of the scope and is bound once (resolved 'forloop.<property>' paths read
+  // them directly), the loop variable is rebound in place per
+  // element (strings reuse their copy, objects link to the element of the
+  // range that is resolved once). The variables are stored in their slots,
+  // templates without bound slots (see Template::bindSlots()) use one child
+  // context for all elements.
+  class Scope {
+  public:
+    Scope(const For &tag, Context &context, const Loop &loop);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    // Context the loop body is rendered with
+    Context &context() { return mLocal ? *mLocal : mContext; }
+
+    // Binds the i-th element (returns false if the element is out of range
+    // and the loop has to stop)
+    bool bind(size_t i);
+
+  private:
+    const For &mTag;
+    Context &mContext;
+    const Loop &mLoop;
+    std::unique_ptr<Context> mLocal;
+    std::shared_ptr<LoopData> mCounters;
+    const LoopCounters *mPreviousCounters{nullptr};
+    const ValueGetter *mRange{nullptr};
+  };
+
+  Loop evaluate(Context &context) const;
+
+  // Renders the loop body for the bound element (returns false on 'break')
+  using BodyRenderer = std::function<bool(Context &, std::string &)>;
+
+  // Renders the elements of an evaluated, non empty loop
+  void renderLoop(Context &context, std::string &res, const Loop &loop,
+                  const BodyRenderer &renderBody) const;
+
   void render(Context &context, std::string &res) const override final;
 
+  // 'break' and 'continue' of the else branch belong to the enclosing loop
+  RenderStatus renderWithStatus(Context &context,
+                                std::string &res) const override final;
+
 private:
-  bool renderElement(Context &context, std::string &res,
-                     const Value &currentVal, PathRef idxPath,
-                     LoopData forLoop) const;
+  // Renders chunks of elements on the worker pool and appends them in order.
+  // The watchdog checks are replayed per element, rendering has to continue
+  // serially at the returned element (the first one failing or not rendered)
+  // to get the same output and errors as serial rendering.
+  size_t renderParallel(Context &context, std::string &res, const Loop &loop,
+                        const Watchdog &watchdog,
+                        const BodyRenderer &renderBody) const;
+
   static boost::optional<RangeExpression> toRangeDefinition(string_view sv);
 };
 }
@@ -10,6 +10,7 @@ template<int Step, int Initial>
 struct IncrementBase : public Tag
 {
    std::string keyName;
+   SlotIndex slot{NoSlot};
 
    static std::string generateKeyName(string_view variableName)
    {
@@ -22,28 +23,34 @@ struct IncrementBase : public Tag
       return var;
    }
 
-   IncrementBase(Tag&& tag)
+   IncrementBase(UnevaluatedTag&& tag)
      : Tag(std::move(tag))
    {
-      auto tokens = Expression::splitTokens(value);
+      auto& tokens = tag.tokens;
       if (tokens.size() != 1)
          throw Exception("Invalid parameter count!", value);
 
-      keyName = generateKeyName(tokens[0]);
+      keyName = generateKeyName(tokens[0].text);
+   }
+
+   bool relocate(const ViewRelocator& relocator) override
+   {
+      return relocateNameAndValue(relocator);
    }
 
    void render(Context& context, std::string& res) const override final
    {
       auto& dsc = context.documentScopeContext();
+      const Key counter{keyName, slot};
 
       std::intmax_t numVal = Initial;
-      auto val = dsc.get(keyName);
+      auto val = dsc.get(PathRef{&counter, 1});
       if (val.isIntegral())
          numVal = val.integralValue();
 
       res += boost::lexical_cast<std::string>(numVal);
       numVal += Step;
-      dsc.set(keyName, numVal);
+      dsc.set(counter, numVal);
    }
 };
 
@@ -1,4 +1,7 @@
 #include "Tag.hpp"
+#include "UnevaluatedTag.hpp"
+
+#include "../ViewRelocator.hpp"
 
 #include <tuple>
 
@@ -10,4 +13,19 @@ namespace liquidpp
       return tup(*this) == tup(other);
    }
 
+   bool Tag::relocate(const ViewRelocator& /*relocator*/) {
+      return false;
+   }
+
+   bool Tag::relocateNameAndValue(const ViewRelocator& relocator) {
+      relocator(name);
+      relocator(value);
+      return true;
+   }
+
+   bool UnevaluatedTag::relocate(const ViewRelocator& relocator) {
+      relocator.each(tokens);
+      return relocateNameAndValue(relocator);
+   }
+
 }
\ No newline at end of file
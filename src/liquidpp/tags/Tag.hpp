@@ -5,10 +5,20 @@
 
 namespace liquidpp
 {
+class ViewRelocator;
+
 struct Tag : public IRenderable {
    string_view name;
    string_view value;
 
    bool operator==(const Tag& other) const;
+
+   // Passes all string views of the tag to the relocator (see LiteralPool).
+   // Tags with members referencing the template have to override this, the
+   // default refuses relocation.
+   virtual bool relocate(const ViewRelocator& relocator);
+
+protected:
+   bool relocateNameAndValue(const ViewRelocator& relocator);
 };
 }
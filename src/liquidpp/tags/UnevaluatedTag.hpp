@@ -8,8 +8,19 @@ namespace liquidpp
 {
 
 struct UnevaluatedTag : public Tag {
+   // Tokens of value, the tag constructors use them instead of lexing the
+   // value again
+   Expression::Lexemes tokens;
+
    UnevaluatedTag() = default;
 
+   UnevaluatedTag(string_view name_, string_view value_)
+      : tokens(Expression::lex(value_))
+   {
+      name = name_;
+      value = value_;
+   }
+
    UnevaluatedTag(string_view data)
    {
       data.remove_prefix(data[2] == '-' ? 3 : 2);
@@ -17,14 +28,15 @@ struct UnevaluatedTag : public Tag {
          throw Exception("Tag is too short!", data);
       data.remove_suffix(data[data.size() - 3] == '-' ? 3 : 2);
 
-      auto tokens = Expression::splitTokens(data);
+      tokens = Expression::lex(data);
       if (tokens.empty())
          throw Exception("Tag definition without tag name!", data);
-      name = tokens[0];
-      if (tokens.size() > 1)
+      name = tokens[0].text;
+      tokens.erase(tokens.begin());
+      if (!tokens.empty())
       {
-         const char* start = tokens[1].data();
-         const char* end = tokens.back().data() + tokens.back().size();
+         const char* start = tokens.front().text.data();
+         const char* end = tokens.back().text.data() + tokens.back().text.size();
          size_t len = end - start;
          value = string_view{start, len};
       }
@@ -34,6 +46,8 @@ struct UnevaluatedTag : public Tag {
 
    void render(Context& context, std::string& out) const override final {
    }
+
+   bool relocate(const ViewRelocator& relocator) override;
 };
 
 };
@@ -0,0 +1,62 @@
+#include <liquidpp.hpp>
+#include <liquidpp/CodeGenerator.hpp>
+
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+bool write(const std::string& path, const std::string& content)
+{
+   std::ofstream os(path, std::ios::binary);
+   os << content;
+   if (!os)
+   {
+      std::cerr << "Could not write file '" << path << "'" << std::endl;
+      return false;
+   }
+   return true;
+}
+}
+
+// Translates a template to a C++ render function (see liquidpp::CodeGenerator)
+int main(int argc, char* args[])
+{
+   if (argc != 5)
+   {
+      std::cerr << "Usage: " << args[0] << " <liquid template file> <function name> <output header> <output source>"
+                << std::endl;
+      return 1;
+   }
+
+   const std::string headerPath = args[3];
+   auto headerName = headerPath.substr(headerPath.find_last_of("/\\") + 1);
+
+   try {
+      auto templ = liquidpp::parseFile(args[1]);
+      try {
+         liquidpp::CodeGenerator generator{templ, args[2]};
+         if (!write(headerPath, generator.header()) || !write(args[4], generator.source(headerName)))
+            return 1;
+      }
+      catch(liquidpp::Exception& e)
+      {
+         e.position() = templ.findPosition(e.errorPart());
+         throw;
+      }
+   }
+   catch(liquidpp::Exception& e)
+   {
+      std::cerr << args[1] << ": liquidpp error: " << e.what() << std::endl;
+      std::cerr << "Error at: " << e.errorPart() << std::endl;
+      std::cerr << e.position().toString() << std::endl;
+      return 1;
+   }
+   catch(std::exception& e)
+   {
+      std::cerr << args[1] << ": " << e.what() << std::endl;
+      return 1;
+   }
+
+   return 0;
+}
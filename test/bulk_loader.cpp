@@ -0,0 +1,116 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <direct.h>
+#define LIQUIDPP_TEST_MKDIR(path) _mkdir(path)
+#define LIQUIDPP_TEST_RMDIR(path) _rmdir(path)
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define LIQUIDPP_TEST_MKDIR(path) mkdir(path, 0755)
+#define LIQUIDPP_TEST_RMDIR(path) rmdir(path)
+#endif
+
+#include <liquidpp.hpp>
+#include <liquidpp/BulkLoader.hpp>
+
+namespace BulkLoaderTest
+{
+constexpr const char* TestTags = "[bulk_loader]";
+
+const std::map<std::string, std::string>& theme()
+{
+   static const std::map<std::string, std::string> res{
+      {"layouts/theme", "<html>{{ content }}</html>"},
+      {"sections/header", "<h1>{{ title | upcase }}</h1>"},
+      {"sections/broken", "Line 1\n{% if %}{% endif %}"},
+      {"snippets/list", "{% for i in (1..3) %}{{ i }}{% endfor %}"},
+      {"snippets/unterminated", "{% for i in (1..3) %}"},
+      {"index", "Hello {{ title }}!"}
+   };
+   return res;
+}
+
+liquidpp::Context& testContext()
+{
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized)
+   {
+      c.set("title", "Theme");
+      c.set("content", "body");
+      initialized = true;
+   }
+   return c;
+}
+
+void requireTheme(const liquidpp::BulkLoadResult& res)
+{
+   REQUIRE(res.templates.size() == 4);
+   REQUIRE(res.templates.at("layouts/theme")(testContext()) == "<html>body</html>");
+   REQUIRE(res.templates.at("sections/header")(testContext()) == "<h1>THEME</h1>");
+   REQUIRE(res.templates.at("snippets/list")(testContext()) == "123");
+   REQUIRE(res.templates.at("index")(testContext()) == "Hello Theme!");
+
+   REQUIRE(res.errors.size() == 2);
+   REQUIRE(res.errors[0].name == "sections/broken");
+   REQUIRE(res.errors[0].position.line == 2);
+   REQUIRE(res.errors[1].name == "snippets/unterminated");
+   REQUIRE(res.errors[1].position.line == 1);
+}
+
+TEST_CASE("BulkLoader: directories", TestTags)
+{
+   const std::string root = "liquidpp_bulk_loader_test";
+   for (auto dir : {"", "/layouts", "/sections", "/snippets"})
+      LIQUIDPP_TEST_MKDIR((root + dir).c_str());
+
+   std::vector<std::string> files;
+   for (auto&& templ : theme())
+   {
+      files.push_back(root + "/" + templ.first + ".liquid");
+      std::ofstream(files.back(), std::ios::binary) << templ.second;
+   }
+   files.push_back(root + "/snippets/notes.txt");
+   std::ofstream(files.back()) << "{% not a template";
+
+   for (auto threads : {1, 4})
+   {
+      liquidpp::BulkLoadOptions options;
+      options.threads = threads;
+      requireTheme(liquidpp::loadDirectory(root, options));
+   }
+
+   liquidpp::BulkLoadOptions options;
+   options.storage = liquidpp::SourceStorage::Compact;
+   options.compile = true;
+   auto res = liquidpp::loadDirectory(root, options);
+
+   for (auto&& file : files)
+      std::remove(file.c_str());
+   for (auto dir : {"/layouts", "/sections", "/snippets", ""})
+      LIQUIDPP_TEST_RMDIR((root + dir).c_str());
+
+   requireTheme(res);
+   REQUIRE_THROWS(liquidpp::loadDirectory(root));
+}
+
+TEST_CASE("BulkLoader: bundles", TestTags)
+{
+   const std::string path = "liquidpp_bulk_loader_test.bundle";
+   liquidpp::writeBundle(path, theme());
+
+   liquidpp::BulkLoadOptions options;
+   options.threads = 3;
+   auto res = liquidpp::loadBundle(path, options);
+   std::remove(path.c_str());
+
+   // the templates keep the mapped bundle alive
+   requireTheme(res);
+
+   REQUIRE_THROWS(liquidpp::loadBundle(path));
+}
+}
@@ -0,0 +1,86 @@
+#include "catch.hpp"
+
+#include <liquidpp.hpp>
+#include <liquidpp/CodeGenerator.hpp>
+
+#include "control_flow.liquid.hpp"
+#include "error_page.liquid.hpp"
+#include "order_confirmation.liquid.hpp"
+
+namespace CompiledTemplatesTest
+{
+constexpr const char* TestTags = "[compiled_templates]";
+
+using Object = std::map<std::string, std::string>;
+
+liquidpp::Context& testContext()
+{
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized)
+   {
+      c.set("customer", Object{{"first_name", "ada"}, {"last_name", "Lovelace"}});
+      c.set("order", Object{{"number", "1001"}, {"status", "shipped"}, {"gift", "yes"}});
+      c.set("items", std::vector<Object>{{{"title", "Analytical engine"}, {"quantity", "1"}, {"price", "1999"}},
+                                         {{"title", "Punch cards"}, {"quantity", "250"}, {"price", "0.25"}}});
+      c.set("tags", std::vector<std::string>{"express", "fragile"});
+      c.set("vip", false);
+      c.set("total", 2061.5);
+
+      c.set("name", "Donald Drumpf");
+      c.set("answer", 42);
+      c.set("numbers", std::vector<int>{1, 2, 3, 4, 5, 6});
+      c.set("empty", std::vector<int>{});
+      c.set("products", std::vector<Object>{{{"title", "hat"}, {"type", "cap"}},
+                                            {{"title", "shirt"}, {"type", "top"}},
+                                            {{"title", "pants"}, {"type", "bottom"}}});
+
+      c.set("code", 404);
+      c.set("title", "Not <found>");
+      c.set("message", "No \"such\" page");
+      c.set("details", "<b>GET</b> /missing\nreferer: none");
+      initialized = true;
+   }
+   return c;
+}
+
+// Renders a template of test/templates with the interpreter
+std::string interpret(const std::string& name)
+{
+   auto templ = liquidpp::parseFile(std::string{LIQUIDPP_TEST_TEMPLATES_DIR} + "/" + name + ".liquid");
+   return templ(testContext());
+}
+
+TEST_CASE("Compiled templates: same output as the interpreter", TestTags)
+{
+   auto& c = testContext();
+
+   auto order = compiled_templates::order_confirmation(c);
+   REQUIRE(order == interpret("order_confirmation"));
+   REQUIRE(order.find("Hello Ada LOVELACE,") == 0);
+   REQUIRE(order.find("Your order is on its way.") != std::string::npos);
+
+   auto controlFlow = compiled_templates::control_flow(c);
+   REQUIRE(controlFlow == interpret("control_flow"));
+   REQUIRE(controlFlow.find("1 2 4 \n") == 0);
+
+   auto errorPage = compiled_templates::error_page(c);
+   REQUIRE(errorPage == interpret("error_page"));
+   REQUIRE(errorPage.find("?\?= done?") != std::string::npos);
+}
+
+TEST_CASE("Compiled templates: generated code", TestTags)
+{
+   auto templ = liquidpp::parse("Hi {{ name | upcase }}{% for p in products %}{{ p.title }}{% endfor %}");
+   liquidpp::CodeGenerator generator{templ, "mails::hi"};
+
+   REQUIRE(generator.header().find("namespace mails\n{\nstd::string hi(const liquidpp::Context& context);\n}") != std::string::npos);
+
+   auto source = generator.source("hi.hpp");
+   REQUIRE(source.find("#include \"hi.hpp\"") != std::string::npos);
+   REQUIRE(source.find("out.append(\"Hi \", 3);") != std::string::npos);
+   REQUIRE(source.find("liquidpp::compiled::filter(\"upcase\")") != std::string::npos);
+   REQUIRE(source.find("liquidpp::compiled::path({liquidpp::Key{\"p\"}, liquidpp::Key{\"title\"}})") != std::string::npos);
+   REQUIRE(source.find("for (std::size_t i = 0; i < loop.limit; watchdog.check(i++))") != std::string::npos);
+}
+}
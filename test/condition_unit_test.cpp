@@ -5,6 +5,26 @@
 
 using liquidpp::string_view;
 
+namespace ConditionUnitTest {
+// Value counting how often it is read
+struct Probe
+{
+   int value;
+   int* reads;
+};
+}
+
+namespace liquidpp {
+template <>
+struct Accessor<ConditionUnitTest::Probe> : public std::true_type {
+   static Value get(const ConditionUnitTest::Probe& probe, PathRef path)
+   {
+      (*probe.reads)++;
+      return probe.value;
+   }
+};
+}
+
 namespace ConditionUnitTest {
 
 liquidpp::Expression::Token toToken(int val)
@@ -31,6 +51,7 @@ template<typename... Args>
 bool evaluate(liquidpp::Context& c, Args... args) {
    liquidpp::Expression expr;
    expr.tokens = {toToken(args)...};
+   expr.compile();
    if (expr(c))
       return true;
    return false;
@@ -195,6 +216,47 @@ TEST_CASE("test_and_condition")
     REQUIRE_FALSE(evaluate(1, "==", 1, "and", 2, "==", 2, "and", 2, "==", 1));
 }
 
+TEST_CASE("test_and_or_evaluate_only_needed_terms")
+{
+   int reads = 0;
+   liquidpp::Context context;
+   context.set("probe", Probe{1, &reads});
+
+   REQUIRE(evaluate(context, 1, "==", 1, "or", "probe", "==", 1));
+   REQUIRE_FALSE(evaluate(context, 1, "==", 2, "and", "probe", "==", 1));
+   REQUIRE(reads == 0);
+
+   // evaluated from left to right without precedence
+   REQUIRE(evaluate(context, 1, "==", 1, "or", "probe", "==", 2, "and", 2, "==", 2));
+   REQUIRE(reads == 0);
+   REQUIRE_FALSE(evaluate(context, 1, "==", 1, "and", "probe", "==", 2, "or", 2, "==", 3));
+   REQUIRE(reads == 1);
+}
+
+TEST_CASE("test_comparison_with_literal_on_either_side")
+{
+   liquidpp::Context context;
+   context.set("one", 1);
+   context.set("half", 0.5);
+   context.set("text", "b");
+
+   assertEvaluteTrue(context, 2, ">", "one");
+   assertEvaluteTrue(context, 1, ">=", "one");
+   assertEvaluteFalse(context, 1, "<", "one");
+   assertEvaluteTrue(context, 0, "<", "half");
+   assertEvaluteTrue(context, "half", "<", 1);
+   assertEvaluteTrue(context, "'a'", "<", "text");
+   assertEvaluteTrue(context, "text", "<=", "'c'");
+   assertEvaluteTrue(context, "'b'", "==", "text");
+
+   // values of different types are neither equal nor unequal
+   assertEvaluteFalse(context, "text", "==", 1);
+   assertEvaluteFalse(context, "text", "!=", 1);
+   assertEvaluteFalse(context, "one", "!=", "'1'");
+   assertEvaluteFalse(context, "'1'", "<", "one");
+   assertEvaluteFalse(context, "not_assigned", "==", 0);
+}
+
 // User defined opeators are not supported and I don't plan to change this. The 'starts_with' operator may be supported sometimes
 /*
    TEST_CASE("test_should_allow_custom_proc_operator
@@ -1,6 +1,31 @@
 #include "catch.hpp"
 
 #include <liquidpp.hpp>
+#include <liquidpp/tags/Case.hpp>
+
+namespace ControlFlowTest
+{
+// List of strings counting the reads of its elements
+struct CountedList
+{
+   std::vector<std::string> elements;
+   int* reads;
+};
+}
+
+namespace liquidpp
+{
+template <>
+struct Accessor<ControlFlowTest::CountedList> : public std::true_type
+{
+   static Value get(const ControlFlowTest::CountedList& list, PathRef path)
+   {
+      if (!path.empty())
+         (*list.reads)++;
+      return Accessor<std::vector<std::string>>::get(list.elements, path);
+   }
+};
+}
 
 TEST_CASE("Control flow: case/when")
 {
@@ -24,6 +49,85 @@ TEST_CASE("Control flow: case/when")
    REQUIRE(templ(c) == "This is not a cake nor a cookie");
 }
 
+TEST_CASE("Control flow: case/when with value lists")
+{
+   liquidpp::Context c;
+   auto templ = liquidpp::parse(R"({%- case handle -%}
+  {%- when 'cake', 'pie' -%}
+     This is a cake or a pie
+  {%- when 'cookie' or 'biscuit' -%}
+     This is a cookie
+  {%- when 1, 2 -%}
+     This is a number
+  {%- else -%}
+     This is something else
+{%- endcase -%})");
+
+   REQUIRE(templ.root.nodeList.size() == 1);
+   auto& tagPtr = boost::get<std::unique_ptr<const liquidpp::IRenderable>>(templ.root.nodeList[0]);
+   auto caseTag = dynamic_cast<const liquidpp::Case*>(tagPtr.get());
+   REQUIRE(caseTag);
+   REQUIRE(caseTag->branches.size() == 4);
+   REQUIRE(caseTag->branches[0].values.size() == 2);
+   REQUIRE(caseTag->branches[3].isElse());
+   REQUIRE(caseTag->useLookupTables);
+
+   c.set("handle", "pie");
+   REQUIRE(templ(c) == "This is a cake or a pie");
+
+   c.set("handle", "biscuit");
+   REQUIRE(templ(c) == "This is a cookie");
+
+   c.set("handle", 2);
+   REQUIRE(templ(c) == "This is a number");
+
+   c.set("handle", 2.0);
+   REQUIRE(templ(c) == "This is a number");
+
+   c.set("handle", "2");
+   REQUIRE(templ(c) == "This is something else");
+
+   REQUIRE_THROWS_AS(liquidpp::parse("{% case x %}{% when 'a', %}{% endcase %}"), liquidpp::Exception);
+   REQUIRE_THROWS_AS(liquidpp::parse("{% case x %}{% when 'a' and 'b' %}{% endcase %}"), liquidpp::Exception);
+}
+
+TEST_CASE("Control flow: case/when with variables")
+{
+   liquidpp::Context c;
+   c.set("favorite", "cookie");
+   auto templ = liquidpp::parse("{% case handle %}{% when 'cake' %}cake{% when favorite %}favorite{% else %}other{% endcase %}");
+   auto& tagPtr = boost::get<std::unique_ptr<const liquidpp::IRenderable>>(templ.root.nodeList[0]);
+   REQUIRE_FALSE(dynamic_cast<const liquidpp::Case&>(*tagPtr).useLookupTables);
+
+   c.set("handle", "cookie");
+   REQUIRE(templ(c) == "favorite");
+
+   c.set("handle", "cake");
+   REQUIRE(templ(c) == "cake");
+
+   c.set("handle", "donut");
+   REQUIRE(templ(c) == "other");
+}
+
+TEST_CASE("Control flow: case/when with many branches")
+{
+   std::string content = "{% case value %}";
+   for (int i = 0; i < 60; i++)
+      content += "{% when 'v" + std::to_string(i) + "' %}" + std::to_string(i) + ";";
+   content += "{% else %}none{% endcase %}";
+
+   auto templ = liquidpp::parse(content);
+   liquidpp::Context c;
+   for (int i = 0; i < 60; i++)
+   {
+      c.set("value", "v" + std::to_string(i));
+      REQUIRE(templ(c) == std::to_string(i) + ";");
+   }
+
+   c.set("value", "v60");
+   REQUIRE(templ(c) == "none");
+}
+
 TEST_CASE("Control flow: if")
 {
    liquidpp::Context c;
@@ -93,3 +197,53 @@ TEST_CASE("Control flow: elsif / else")
       REQUIRE(templ(c) == "Hi Stranger!");
    }
 }
+
+TEST_CASE("Control flow: repeated contains checks of a range")
+{
+   liquidpp::Context c;
+   int reads = 0;
+   c.set("tags", ControlFlowTest::CountedList{{"hat", "shirt", "sale"}, &reads});
+   c.set("numbers", std::vector<int>{1, 2, 3});
+
+   std::vector<std::map<std::string, std::string>> products;
+   for (int i = 0; i < 100; i++)
+      products.push_back({{"type", i % 2 ? "hat" : "shoe"}, {"n", std::to_string(i % 4)}});
+   c.set("products", products);
+
+   auto render = [&](liquidpp::string_view source) {
+      auto templ = liquidpp::parse(source);
+      auto compiled = liquidpp::parse(source);
+      compiled.compile();
+      auto res = templ(c);
+      REQUIRE(compiled(c) == res);
+      return res;
+   };
+
+   SECTION("index built once per rendering")
+   {
+      auto res = render("{% for p in products limit: 4 %}{% if tags contains p.type %}y{% else %}n{% endif %}"
+                        "{% endfor %}");
+      REQUIRE(res == "nyny");
+
+      reads = 0;
+      render("{% for p in products %}{% if tags contains p.type %}y{% endif %}{% endfor %}");
+      // per renderer one scan until the first match and one for building the index
+      REQUIRE(reads <= 2 * 3 * 2);
+   }
+
+   SECTION("elements of other types")
+   {
+      REQUIRE(render("{% for p in products limit: 4 %}{% if numbers contains p.n %}y{% else %}n{% endif %}"
+                     "{% if numbers contains 2 %}2{% endif %}{% endfor %}") == "n2n2n2n2");
+   }
+
+   SECTION("ranges changed while rendering")
+   {
+      REQUIRE(render("{% assign t = 'a,b' | split: ',' %}{% for i in (1..2) %}{% if t contains 'a' %}a{% endif %}"
+                     "{% if t contains 'b' %}b{% endif %}{% endfor %}{% assign t = 'c' | split: ',' %}"
+                     "{% if t contains 'b' %}b{% endif %}{% if t contains 'c' %}c{% endif %}") == "ababc");
+
+      REQUIRE(render("{% for p in products limit: 4 %}{% assign t = p.type | split: ',' %}{% if t contains 'hat' %}h"
+                     "{% endif %}{% if t contains 'shoe' %}s{% endif %}{% endfor %}") == "shsh");
+   }
+}
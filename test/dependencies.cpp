@@ -0,0 +1,112 @@
+#include "catch.hpp"
+
+#include <liquidpp.hpp>
+
+namespace DependenciesTest
+{
+constexpr const char* TestTags = "[dependencies]";
+
+using Paths = std::vector<std::string>;
+
+Paths dependencies(liquidpp::string_view content)
+{
+   return liquidpp::parse(content).dependencies();
+}
+
+TEST_CASE("Dependencies: variables, filters and conditions", TestTags)
+{
+   REQUIRE(dependencies("Hello World!").empty());
+   REQUIRE(dependencies("{{ 'x' | upcase }}{{ 42 }}").empty());
+   REQUIRE(dependencies("{{ shop.name }} {{ user.name | append: shop.suffix }}") == Paths{"shop.name", "shop.suffix", "user.name"});
+   REQUIRE(dependencies("{% if a.b > 1 and c %}{{ d }}{% elsif e %}{% else %}{{ f[2].g }}{% endif %}")
+           == Paths{"a.b", "c", "d", "e", "f[2].g"});
+   REQUIRE(dependencies("{% unless a %}{% endunless %}{% case b %}{% when c, 'x' %}{{ d }}{% endcase %}")
+           == Paths{"a", "b", "c", "d"});
+   REQUIRE(dependencies("{% cycle x, 'y' %}{% comment %}{{ ignored }}{% endcomment %}") == Paths{"x"});
+}
+
+TEST_CASE("Dependencies: loops", TestTags)
+{
+   SECTION("loop variables are resolved to the elements")
+   {
+      REQUIRE(dependencies("{% for p in products limit: max %}{{ p.title }}{{ forloop.index }}{% endfor %}")
+              == Paths{"max", "products[*].title"});
+   }
+
+   SECTION("nested loops")
+   {
+      REQUIRE(dependencies("{% for p in products %}{% for v in p.variants %}{{ v.price }}{% endfor %}{% endfor %}")
+              == Paths{"products[*].variants[*].price"});
+   }
+
+   SECTION("the range is read if no element is used")
+   {
+      REQUIRE(dependencies("{% for p in products %}x{% endfor %}") == Paths{"products[*]"});
+      REQUIRE(dependencies("{% for i in (1..n) %}{{ i }}{% endfor %}") == Paths{"n"});
+   }
+
+   SECTION("else branches and the scope of the loop variable")
+   {
+      REQUIRE(dependencies("{% for p in products %}{{ p.a }}{% else %}{{ p.b }}{% endfor %}{{ p.c }}")
+              == Paths{"p.b", "p.c", "products[*].a"});
+   }
+
+   SECTION("index variables")
+   {
+      REQUIRE(dependencies("{{ products[i].title }}") == Paths{"i", "products[*].title"});
+   }
+
+   SECTION("size, first and last")
+   {
+      REQUIRE(dependencies("{{ products.size }} {{ products.first.title }} {{ products.last }}")
+              == Paths{"products"});
+      REQUIRE(dependencies("{{ products.first.title }}") == Paths{"products[0].title"});
+   }
+}
+
+TEST_CASE("Dependencies: aliases", TestTags)
+{
+   SECTION("assigned paths are resolved")
+   {
+      REQUIRE(dependencies("{% assign p = shop.products[0] %}{{ p.title }}") == Paths{"shop.products[0].title"});
+   }
+
+   SECTION("filtered and captured values are local")
+   {
+      REQUIRE(dependencies("{% assign t = p.title | upcase %}{{ t }}") == Paths{"p.title"});
+      REQUIRE(dependencies("{% capture t %}{{ a }}{% endcapture %}{{ t }}") == Paths{"a"});
+   }
+
+   SECTION("conditional assignments keep the context value")
+   {
+      REQUIRE(dependencies("{% if c %}{% assign t = a %}{% endif %}{{ t }}") == Paths{"a", "c", "t"});
+   }
+
+   SECTION("map reads one member per element")
+   {
+      REQUIRE(dependencies("{{ products | map: 'title' | join: ', ' }}") == Paths{"products[*].title"});
+      REQUIRE(dependencies("{% assign titles = products | map: 'title' %}{{ titles }}") == Paths{"products[*].title"});
+   }
+}
+
+TEST_CASE("Dependencies: render with the slice of the data", TestTags)
+{
+   auto templ = liquidpp::parse("{% for p in products %}{{ p.title }}: {{ p.price }}; {% endfor %}{{ shop.name }}");
+   REQUIRE(templ.dependencies() == Paths{"products[*].price", "products[*].title", "shop.name"});
+
+   liquidpp::Context full;
+   full.set("products", std::vector<std::map<std::string, std::string>>{
+      {{"title", "a"}, {"price", "1"}, {"description", "long text"}},
+      {{"title", "b"}, {"price", "2"}, {"description", "long text"}}});
+   full.set("shop", std::map<std::string, std::string>{{"name", "Shop"}, {"address", "Street"}});
+
+   liquidpp::Context slice;
+   slice.set("products", std::vector<std::map<std::string, std::string>>{
+      {{"title", "a"}, {"price", "1"}},
+      {{"title", "b"}, {"price", "2"}}});
+   slice.set("shop", std::map<std::string, std::string>{{"name", "Shop"}});
+
+   REQUIRE(templ(slice) == templ(full));
+   REQUIRE(templ(slice) == "a: 1; b: 2; Shop");
+}
+}
@@ -0,0 +1,77 @@
+#include "catch.hpp"
+
+#include <liquidpp.hpp>
+
+namespace FrozenContextTest
+{
+constexpr const char* TestTags = "[frozen_context]";
+
+std::shared_ptr<const liquidpp::Context::Frozen> globals()
+{
+   liquidpp::Context c;
+   for (int i = 0; i < 80; i++)
+      c.set("setting" + std::to_string(i), i);
+   c.set("shop", std::map<std::string, std::string>{{"name", "Shop"}, {"currency", "EUR"}});
+   c.set("products", std::vector<std::string>{"hat", "shirt"});
+   c.set("name", "global");
+   c.setMaxOutputSize(1024);
+   return c.freeze();
+}
+
+TEST_CASE("Frozen context: lookup", TestTags)
+{
+   auto frozen = globals();
+   REQUIRE(frozen->size() == 83);
+   REQUIRE(frozen->find("setting42") != nullptr);
+   REQUIRE(frozen->find("setting80") == nullptr);
+   REQUIRE(frozen->find("") == nullptr);
+
+   liquidpp::Context c{frozen};
+   REQUIRE(c.get("setting0").toString() == "0");
+   REQUIRE(c.get("setting79").toString() == "79");
+   REQUIRE(c.get("shop.name").toString() == "Shop");
+   REQUIRE(c.get("products.size").toString() == "2");
+   REQUIRE(c.get("products.last").toString() == "shirt");
+   const bool isNull = c.get("unknown") == liquidpp::ValueTag::Null;
+   REQUIRE(isNull);
+   REQUIRE(c.maxOutputSize() == 1024);
+}
+
+TEST_CASE("Frozen context: layering", TestTags)
+{
+   auto frozen = globals();
+   auto templ = liquidpp::parse("{{ name }} {{ shop.name }} {{ setting7 }}{% for p in products %} {{ p }}{% endfor %}"
+                                "{% assign setting7 = 'x' %} {{ setting7 }} {{ cart }}");
+
+   SECTION("values of the layered context shadow the frozen values")
+   {
+      liquidpp::Context request{frozen};
+      request.set("name", "request");
+      request.set("cart", 3);
+      REQUIRE(templ(request) == "request Shop 7 hat shirt x 3");
+   }
+
+   SECTION("the frozen values are not changed by rendering")
+   {
+      liquidpp::Context request{frozen};
+      REQUIRE(templ(request) == "global Shop 7 hat shirt x ");
+      REQUIRE(templ(request) == "global Shop 7 hat shirt x ");
+      REQUIRE(liquidpp::Context{frozen}.get("setting7").toString() == "7");
+   }
+
+   SECTION("layered contexts can be frozen again")
+   {
+      liquidpp::Context request{frozen};
+      request.set("name", "request");
+      auto refrozen = request.freeze();
+      REQUIRE(refrozen->size() == frozen->size());
+      REQUIRE(templ(liquidpp::Context{refrozen}) == "request Shop 7 hat shirt x ");
+   }
+
+   SECTION("output limits are taken from the frozen context")
+   {
+      liquidpp::Context request{frozen};
+      REQUIRE_THROWS(liquidpp::parse("{% for i in (1..2000) %}{{ i }}{% endfor %}")(request));
+   }
+}
+}
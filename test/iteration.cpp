@@ -74,6 +74,38 @@ TEST_CASE("Iteration: continue")
    }
 }
 
+TEST_CASE("Iteration: break and continue in nested tags")
+{
+   liquidpp::Context c;
+   c.set("array", std::vector<int>{1,2,3,4,5});
+   c.set("empty", std::vector<int>{});
+
+   auto renderBoth = [&](liquidpp::string_view source) {
+      auto templ = liquidpp::parse(source);
+      auto rendered = templ(c);
+      templ.compile();
+      REQUIRE(templ(c) == rendered);
+      return rendered;
+   };
+
+   REQUIRE(renderBoth("{% for i in array %}{% case i %}{% when 2 %}{% continue %}{% when 4 %}{% break %}"
+                      "{% endcase %}{{ i }}{% endfor %}") == "13");
+   REQUIRE(renderBoth("{% for i in array %}{% unless i < 3 %}{% if true %}{% break %}{% endif %}{% endunless %}"
+                      "{{ i }}{% endfor %}") == "12");
+
+   // 'break' of an else branch belongs to the enclosing loop
+   REQUIRE(renderBoth("{% for i in array %}{{ i }}{% for j in empty %}{% else %}{% if i == 2 %}{% break %}"
+                      "{% endif %}{% endfor %}{% endfor %}") == "12");
+
+   // the output captured so far is assigned
+   REQUIRE(renderBoth("{% for i in array %}{% capture s %}<{{ i }}{% if i == 3 %}{% break %}{% endif %}>"
+                      "{% endcapture %}{{ s }}{% endfor %}{{ s }}") == "<1><2><3");
+
+   REQUIRE_THROWS_AS(liquidpp::render("{% if true %}{% break %}{% endif %}", c), liquidpp::DoBreak);
+   REQUIRE_THROWS_AS(liquidpp::render("{% for i in empty %}{% else %}{% continue %}{% endfor %}", c),
+                     liquidpp::DoContinue);
+}
+
 TEST_CASE("Iteration: range")
 {
    liquidpp::Context c;
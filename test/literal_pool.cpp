@@ -0,0 +1,151 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+#include <liquidpp.hpp>
+#include <liquidpp/LiteralPool.hpp>
+
+namespace LiteralPoolTest
+{
+constexpr const char* TestTags = "[literal_pool]";
+
+using Product = std::map<std::string, std::string>;
+
+liquidpp::Context& testContext()
+{
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized)
+   {
+      c.set("name", "Donald Drumpf");
+      c.set("answer", 42);
+      c.set("numbers", std::vector<int>{1, 2, 3, 4, 5});
+      c.set("products", std::vector<Product>{{{"title", "hat"}, {"type", "cap"}},
+                                             {{"title", "shirt"}, {"type", "top"}}});
+      initialized = true;
+   }
+   return c;
+}
+
+liquidpp::Template parseCompacted(std::string content)
+{
+   auto res = liquidpp::parse(content, liquidpp::SourceStorage::Compact);
+
+   // the template may not reference the source anymore
+   std::fill(content.begin(), content.end(), '#');
+   return res;
+}
+
+struct NotRelocatable : public liquidpp::Tag
+{
+   NotRelocatable(liquidpp::Tag&& tag)
+      : liquidpp::Tag(std::move(tag))
+   {
+   }
+
+   void render(liquidpp::Context&, std::string& res) const override final
+   {
+      res.append(value.data(), value.size());
+   }
+};
+
+struct TagFactory : public liquidpp::TagFactory
+{
+   template<typename FilterFactoryT>
+   std::unique_ptr<liquidpp::Tag> operator()(const FilterFactoryT& filterFac, liquidpp::UnevaluatedTag&& tag) const {
+      if (tag.name == "echo")
+         return std::make_unique<NotRelocatable>(std::move(tag));
+      return liquidpp::TagFactory::operator()(filterFac, std::move(tag));
+   }
+};
+
+TEST_CASE("LiteralPool: compacted templates render like referencing templates", TestTags)
+{
+   for (auto content : {
+      "Hello {{name}}!",
+      "{{ name | upcase | append: '!' | replace: 'DON', \"ron\" }} {{ answer | plus: 1 }}",
+      "{% if answer < 10 %}small{% elsif answer < 50 %}medium{% else %}huge{% endif %}",
+      "{% unless name contains 'Don' %}no{% endunless %}",
+      "{%- for n in numbers reversed limit:3 offset:1 -%} {{ forloop.index }}:{{ n }} {%- endfor %}",
+      "{% for i in (1..answer) %}{% if i > 3 %}{% break %}{% endif %}{{ i }}{% else %}empty{% endfor %}",
+      "{% for p in products %}{% case p.type %}{% when 'top', 'cap' %}{{ p['title'] }}{% else %}?{% endcase %}{% endfor %}",
+      "{% case answer %}{% when 1 %}one{% when 42 %}answer{% endcase %}",
+      "{% capture greeting %}Hi {{ name }}{% endcapture %}{{ greeting }}!",
+      "{% assign x = 'foo' | append: 'bar' %}{{ x }}{% comment %}{{ ignored }}{% endcomment %}",
+      "{% cycle 'a', 'b' %}{% cycle 'a', 'b' %}{% cycle 'g': 'c', 'd' %}",
+      "{% increment counter %}{% increment counter %}{% decrement other %}"
+   })
+   {
+      SECTION(content)
+      {
+         auto expected = liquidpp::parse(content)(testContext());
+
+         auto templ = parseCompacted(content);
+         REQUIRE(templ.literals);
+         REQUIRE(templ(testContext()) == expected);
+
+         templ.compile();
+         REQUIRE(templ(testContext()) == expected);
+      }
+   }
+}
+
+TEST_CASE("LiteralPool: only referenced bytes are kept", TestTags)
+{
+   std::string content = "{% comment %}" + std::string(1000, 'c') + "{% endcomment %}"
+                         "{% if name %}Hello {{ name }}!{% endif %}";
+   auto templ = parseCompacted(content);
+   REQUIRE(templ.literals);
+   REQUIRE(templ.literals->size() < 100);
+   REQUIRE(templ.literals->data().find("ccc") == std::string::npos);
+   REQUIRE(templ(testContext()) == "Hello Donald Drumpf!");
+}
+
+TEST_CASE("LiteralPool: error positions refer to the source", TestTags)
+{
+   auto templ = parseCompacted("{% comment %}\n\n{% endcomment %}\n  {% for i in (1..1000) %}{{ i }}{% endfor %}");
+
+   liquidpp::Context c;
+   c.setMaxOutputSize(100);
+   try {
+      templ(c);
+      FAIL("Expected an exception!");
+   } catch(liquidpp::Exception& e) {
+      REQUIRE(e.position().line == 4);
+      REQUIRE(e.position().column == 6);
+   }
+}
+
+TEST_CASE("LiteralPool: tags without relocation support", TestTags)
+{
+   std::string content = "{% echo Hello %} {{ 'World' }}";
+   auto templ = liquidpp::parse<TagFactory>(content, liquidpp::SourceStorage::Compact);
+   std::fill(content.begin(), content.end(), '#');
+
+   REQUIRE(templ.literals);
+   REQUIRE(templ.literals->size() == content.size());
+   REQUIRE(templ(testContext()) == "Hello World");
+}
+
+TEST_CASE("LiteralPool: parse files", TestTags)
+{
+   auto path = std::string{"liquidpp_literal_pool_test.liquid"};
+   {
+      std::ofstream file(path, std::ios::binary);
+      file << "Hello {{ name }}!\n{% if answer == 42 %}{{ answer }}{% endif %}";
+   }
+
+   auto mapped = liquidpp::parseFile(path);
+   auto compacted = liquidpp::parseFile(path, liquidpp::SourceStorage::Compact);
+   std::remove(path.c_str());
+
+   REQUIRE(mapped.literals);
+   REQUIRE(compacted.literals);
+   REQUIRE(compacted.literals->size() < mapped.literals->size());
+   REQUIRE(mapped(testContext()) == "Hello Donald Drumpf!\n42");
+   REQUIRE(compacted(testContext()) == "Hello Donald Drumpf!\n42");
+
+   REQUIRE_THROWS(liquidpp::parseFile("does/not/exist.liquid"));
+}
+}
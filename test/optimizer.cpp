@@ -0,0 +1,254 @@
+#include "catch.hpp"
+
+#include <liquidpp.hpp>
+#include <liquidpp/LiteralPool.hpp>
+#include <liquidpp/Serialization.hpp>
+
+namespace OptimizerTest
+{
+constexpr const char* TestTags = "[optimizer]";
+
+liquidpp::Context& testContext()
+{
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized)
+   {
+      c.set("name", "Donald Drumpf");
+      c.set("answer", 42);
+      c.set("numbers", std::vector<int>{1, 2, 3, 4, 5});
+      initialized = true;
+   }
+   return c;
+}
+
+liquidpp::Template optimized(liquidpp::string_view content)
+{
+   auto templ = liquidpp::parse(content);
+   templ.optimize(std::locale::classic());
+   return templ;
+}
+
+std::vector<liquidpp::NodeType> nodeTypes(const liquidpp::BlockBody& body)
+{
+   std::vector<liquidpp::NodeType> res;
+   for (auto&& node : body.nodeList)
+      res.push_back(liquidpp::type(node));
+   return res;
+}
+
+liquidpp::string_view text(const liquidpp::Template& templ, size_t idx = 0)
+{
+   return boost::get<liquidpp::string_view>(templ.root.nodeList[idx]);
+}
+
+TEST_CASE("Optimizer: same output as the unoptimized template", TestTags)
+{
+   for (auto content : {
+      "Hello World!",
+      "Hello {{name}}!",
+      "{{ 'Hello' | upcase }} {{ 3 | plus: 4 }} {{ 'a,b' | split: ',' | join: '-' }} {{ 7 | divided_by: 2.0 }}",
+      "{{ 'x' | append: name }} {{ answer | plus: 1 }} {{ 1 | plus: answer }}",
+      "{% if true %}t{% endif %}{% if false %}f{% endif %}{% unless false %}u{% endunless %}",
+      "{% if false %}a{% elsif answer == 42 %}b{% else %}c{% endif %}",
+      "{% if false %}a{% elsif 1 == 2 %}b{% else %}c {{ name }}{% endif %}",
+      "{% if 1 < 2 and 'abc' contains 'b' %}yes{% endif %}",
+      "{% for n in numbers %}{% if true %}{{ n }}{% endif %}{% comment %}x{% endcomment %}, {% endfor %}",
+      "{% for n in numbers %}{% if n == 3 %}{% if true %}{% break %}{% endif %}{% endif %}{{ n }}{% endfor %}",
+      "{% case answer %}{% when 42 %}{% comment %}c{% endcomment %}{{ 'a' | upcase }}{% else %}b{% endcase %}",
+      "a {% comment %}{{ ignored }}{% endcomment %} b {%- comment %}x{% endcomment -%} c",
+      "{% capture x %}{{ 'a' }}b{% if true %}c{% endif %}{% endcapture %}{{ x }}",
+      "{{ nil }}|{{ 'a' | default: 'b' }}|{{ 1.5 | round }}|{{ 'abc' | size }}"
+   })
+   {
+      SECTION(content)
+      {
+         auto expected = liquidpp::parse(content)(testContext());
+
+         auto templ = optimized(content);
+         REQUIRE(templ(testContext()) == expected);
+
+         templ.compile();
+         REQUIRE(templ(testContext()) == expected);
+
+         // nothing left to do
+         templ.optimize(std::locale::classic());
+         REQUIRE(templ(testContext()) == expected);
+      }
+   }
+}
+
+TEST_CASE("Optimizer: folding of pure filters", TestTags)
+{
+   auto templ = optimized("{{ 'Hello' | upcase }}, {{ 3 | plus: 4 }}!");
+   REQUIRE(nodeTypes(templ.root) == std::vector<liquidpp::NodeType>{liquidpp::NodeType::String});
+   REQUIRE(text(templ) == "HELLO, 7!");
+   REQUIRE(templ.constants);
+
+   SECTION("locale dependent filters need the locale")
+   {
+      auto unknownLocale = liquidpp::parse("{{ 'Hello' | upcase }}");
+      unknownLocale.optimize();
+      REQUIRE(nodeTypes(unknownLocale.root) == std::vector<liquidpp::NodeType>{liquidpp::NodeType::Variable});
+   }
+
+   SECTION("impure filters are not folded")
+   {
+      for (auto content : {"{{ 'now' | date: '%Y' }}", "{{ 'today' | plus: 1 | date: '%Y' }}"})
+      {
+         auto impure = optimized(content);
+         REQUIRE(nodeTypes(impure.root) == std::vector<liquidpp::NodeType>{liquidpp::NodeType::Variable});
+      }
+   }
+
+   SECTION("variables and arguments from the context are not folded")
+   {
+      auto dynamic = optimized("{{ name | upcase }}{{ 'a' | append: name }}");
+      REQUIRE(nodeTypes(dynamic.root) == std::vector<liquidpp::NodeType>(2, liquidpp::NodeType::Variable));
+   }
+
+   SECTION("errors are reported when rendering")
+   {
+      auto failing = optimized("{{ 'a' | upcase: 'b', 'c' }}");
+      REQUIRE(nodeTypes(failing.root) == std::vector<liquidpp::NodeType>{liquidpp::NodeType::Variable});
+      REQUIRE_THROWS(failing(testContext()));
+   }
+}
+
+TEST_CASE("Optimizer: static branches and comments are removed", TestTags)
+{
+   auto templ = optimized("a{% if true %}b{% endif %}{% if false %}c{% endif %}{% comment %}d{% endcomment %}e");
+   REQUIRE(nodeTypes(templ.root) == std::vector<liquidpp::NodeType>{liquidpp::NodeType::String});
+   REQUIRE(text(templ) == "abe");
+
+   SECTION("conditions depending on the context are kept")
+   {
+      auto dynamic = optimized("{% if answer == 42 %}a{% endif %}{% if false %}b{% elsif answer %}c{% endif %}");
+      REQUIRE(nodeTypes(dynamic.root) == std::vector<liquidpp::NodeType>(2, liquidpp::NodeType::Tag));
+   }
+
+   SECTION("branches are finalized again")
+   {
+      auto nested = optimized("{% if answer == 1 %}{% comment %}x{% endcomment %}a{% elsif answer == 42 %}"
+                              "{% if true %}b{% endif %}c{% else %}d{% endif %}");
+      REQUIRE(nested(testContext()) == "bc");
+   }
+}
+
+TEST_CASE("Optimizer: adjacent literals are merged", TestTags)
+{
+   SECTION("into the constant pool")
+   {
+      auto templ = optimized("a {%- if true -%} b {%- endif -%} c");
+      REQUIRE(nodeTypes(templ.root) == std::vector<liquidpp::NodeType>{liquidpp::NodeType::String});
+      REQUIRE(text(templ) == "abc");
+      REQUIRE(text(templ).data() == templ.constants->data().data());
+   }
+
+   SECTION("views into the source are reused")
+   {
+      auto templ = optimized("Hello {{ name }}!");
+      REQUIRE(nodeTypes(templ.root).size() == 3);
+      REQUIRE(!templ.constants);
+   }
+
+   SECTION("empty literals are removed")
+   {
+      auto templ = optimized("{{ name }} \n {{- name }}");
+      REQUIRE(nodeTypes(templ.root) == std::vector<liquidpp::NodeType>(2, liquidpp::NodeType::Variable));
+   }
+
+   SECTION("compacted templates")
+   {
+      auto templ = liquidpp::parse("{{ 'a' | upcase }} {{ name }}{% comment %}x{% endcomment %} {{ 'b' }}",
+                                   liquidpp::SourceStorage::Compact);
+      templ.optimize(std::locale::classic());
+      REQUIRE(templ(testContext()) == "A Donald Drumpf b");
+   }
+
+   SECTION("serialized templates")
+   {
+      auto templ = optimized("{{ 'a' | upcase }} {{ name }}{% comment %}x{% endcomment %} {{ 'b' }}");
+      REQUIRE(liquidpp::deserialize(liquidpp::serialize(templ))(testContext()) == "A Donald Drumpf b");
+   }
+}
+
+std::shared_ptr<const liquidpp::Context::Frozen> staticData()
+{
+   static std::shared_ptr<const liquidpp::Context::Frozen> res;
+   if (!res)
+   {
+      liquidpp::Context c;
+      c.set("settings", std::map<std::string, std::string>{{"title", "Shop"}, {"currency", "EUR"}});
+      c.set("links", std::vector<std::string>{"home", "cart"});
+      c.set("name", "static");
+      res = c.freeze();
+   }
+   return res;
+}
+
+// Renders with a request context layering over the static data
+std::string renderFor(const liquidpp::Template& templ, const std::string& user)
+{
+   liquidpp::Context c(staticData());
+   c.set("user", user);
+   return templ(c);
+}
+
+TEST_CASE("Optimizer: specialization for static data", TestTags)
+{
+   liquidpp::Context data(staticData());
+   auto specialized = [&](liquidpp::string_view content) {
+      auto templ = liquidpp::parse(content);
+      auto res = templ.specialize(data, "settings", "links");
+      for (auto user : {"alice", "bob"})
+         REQUIRE(renderFor(res, user) == renderFor(templ, user));
+
+      res.compile();
+      REQUIRE(renderFor(res, "alice") == renderFor(templ, "alice"));
+      return res;
+   };
+
+   SECTION("variables")
+   {
+      auto templ = specialized("{{ settings.title | upcase }} {{ user }}{{ name }}");
+      REQUIRE(nodeTypes(templ.root) == (std::vector<liquidpp::NodeType>{liquidpp::NodeType::String,
+                                                                        liquidpp::NodeType::Variable,
+                                                                        liquidpp::NodeType::Variable}));
+      REQUIRE(text(templ) == "SHOP ");
+   }
+
+   SECTION("conditions")
+   {
+      auto templ = specialized("{% if settings.currency == 'EUR' %}E{{ user }}{% else %}D{% endif %}");
+      REQUIRE(nodeTypes(templ.root) == (std::vector<liquidpp::NodeType>{liquidpp::NodeType::String,
+                                                                        liquidpp::NodeType::Variable}));
+      REQUIRE(text(templ) == "E");
+
+      templ = specialized("{% case settings.currency %}{% when 'EUR' %}E{% else %}D{% endcase %}"
+                          "{% if user == 'alice' and settings.title %}A{% endif %}");
+      REQUIRE(nodeTypes(templ.root) == (std::vector<liquidpp::NodeType>{liquidpp::NodeType::String,
+                                                                        liquidpp::NodeType::Tag}));
+      REQUIRE(text(templ) == "E");
+   }
+
+   SECTION("loops")
+   {
+      auto templ = specialized("<ul>{% for l in links %}<li>{{ l | upcase }} {{ forloop.index }}/"
+                               "{{ settings.title }}</li>{% endfor %}</ul>");
+      REQUIRE(nodeTypes(templ.root) == std::vector<liquidpp::NodeType>{liquidpp::NodeType::String});
+      REQUIRE(text(templ) == "<ul><li>HOME 1/Shop</li><li>CART 2/Shop</li></ul>");
+
+      // the loop variable of a dynamic loop is not static
+      specialized("{% for l in links %}{{ l }}{{ user }}{{ settings.title }}{% endfor %}");
+      specialized("{% for settings in links %}{{ settings }}{{ user }}{% endfor %}");
+   }
+
+   SECTION("names set by the template are not static")
+   {
+      specialized("{{ settings.title }}{% assign settings = user %}{{ settings }}");
+      specialized("{% capture links %}{{ user }}{% endcapture %}{{ links }}");
+      specialized("{% for l in links %}{% cycle 'a', 'b' %}{% endfor %}{{ 'now' | date: '%Y' }}");
+   }
+}
+}
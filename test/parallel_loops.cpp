@@ -0,0 +1,193 @@
+#include "catch.hpp"
+
+#include <liquidpp.hpp>
+#include <liquidpp/WorkerPool.hpp>
+#include <liquidpp/tags/For.hpp>
+
+#include <atomic>
+
+namespace ParallelLoopsTest
+{
+constexpr const char* TestTags = "[parallel_loops]";
+
+using Product = std::map<std::string, std::string>;
+
+liquidpp::Context& testContext()
+{
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized)
+   {
+      std::vector<Product> products;
+      for (int i = 0; i < 5000; i++)
+         products.push_back({{"title", "Product " + std::to_string(i)}, {"type", i % 3 ? "shirt" : "hat"},
+                             {"url", "/products/" + std::to_string(i)}});
+      c.set("products", products);
+      c.set("suffix", "!");
+      c.setMinOutputPer1024Loops(0);
+      initialized = true;
+   }
+   return c;
+}
+
+const liquidpp::For& firstLoop(const liquidpp::Template& templ)
+{
+   for (auto&& node : templ.root.nodeList)
+   {
+      if (liquidpp::type(node) != liquidpp::NodeType::Tag)
+         continue;
+      if (auto forTag = dynamic_cast<const liquidpp::For*>(
+             boost::get<std::unique_ptr<const liquidpp::IRenderable>>(node).get()))
+         return *forTag;
+   }
+   throw std::runtime_error("no loop");
+}
+
+bool parallelizable(liquidpp::string_view source)
+{
+   return firstLoop(liquidpp::parse(source)).parallelizable;
+}
+
+// Renders serially and in parallel with the tree renderer and the bytecode
+// program, all results have to be equal
+std::string renderAll(const std::string& source, liquidpp::Context& c)
+{
+   auto templ = liquidpp::parse(source);
+   auto compiled = liquidpp::parse(source);
+   compiled.compile();
+
+   c.setMinParallelLoopSize(0);
+   auto serial = templ(c);
+
+   c.setMinParallelLoopSize(1);
+   REQUIRE(templ(c) == serial);
+   REQUIRE(compiled(c) == serial);
+   c.setMinParallelLoopSize(0);
+   REQUIRE(compiled(c) == serial);
+
+   return serial;
+}
+
+TEST_CASE("Parallel loops: purity of the loop body", TestTags)
+{
+   REQUIRE(parallelizable("{% for p in products %}{{ p.title | upcase }}{% endfor %}"));
+   REQUIRE(parallelizable("{% for p in products %}{% if p.type == 'hat' %}{{ forloop.index }}{% else %}-{% endif %}"
+                          "{% case p.type %}{% when 'hat' %}h{% endcase %}{% comment %}{% assign x = 1 %}{% endcomment %}"
+                          "{% endfor %}"));
+   REQUIRE(parallelizable("{% for p in products %}{% for i in (1..3) %}{% if i == 2 %}{% break %}{% endif %}{% endfor %}"
+                          "{% endfor %}"));
+
+   REQUIRE(!parallelizable("{% for p in products %}{% assign x = p %}{% endfor %}"));
+   REQUIRE(!parallelizable("{% for p in products %}{% capture x %}{% endcapture %}{% endfor %}"));
+   REQUIRE(!parallelizable("{% for p in products %}{% increment x %}{% endfor %}"));
+   REQUIRE(!parallelizable("{% for p in products %}{% decrement x %}{% endfor %}"));
+   REQUIRE(!parallelizable("{% for p in products %}{% cycle 'a', 'b' %}{% endfor %}"));
+   REQUIRE(!parallelizable("{% for p in products %}{% if p %}{% break %}{% endif %}{% endfor %}"));
+   REQUIRE(!parallelizable("{% for p in products %}{% continue %}{% endfor %}"));
+   REQUIRE(!parallelizable("{% for p in products %}{% for i in p %}{% else %}{% break %}{% endfor %}{% endfor %}"));
+   REQUIRE(!parallelizable("{% for p in products %}{{ 'now' | date: '%Y' }}{% endfor %}"));
+   REQUIRE(!parallelizable("{% for p in products %}{% for i in (1..3) %}{% assign x = i %}{% endfor %}{% endfor %}"));
+
+   // only the loop body matters
+   REQUIRE(parallelizable("{% for p in products %}{{ p }}{% else %}{% assign x = 1 %}{% endfor %}"));
+}
+
+TEST_CASE("Parallel loops: output is the same as of serial rendering", TestTags)
+{
+   auto& c = testContext();
+
+   SECTION("objects")
+   {
+      auto res = renderAll("<ul>{% for p in products %}<li class=\"{% if forloop.first %}first{% elsif forloop.last %}last"
+                           "{% endif %}\">{{ forloop.index }}/{{ forloop.rindex }} <a href=\"{{ p.url }}\">"
+                           "{{ p.title | upcase | append: suffix }}</a>{% if p.type == 'hat' %} (hat){% endif %}</li>"
+                           "{% endfor %}</ul>", c);
+      REQUIRE(res.find("<li class=\"first\">1/5000 <a href=\"/products/0\">PRODUCT 0!</a> (hat)</li>") != std::string::npos);
+      REQUIRE(res.find("<li class=\"last\">5000/1 <a href=\"/products/4999\">PRODUCT 4999!</a></li></ul>") != std::string::npos);
+   }
+
+   SECTION("limit, offset and reversed")
+   {
+      renderAll("{% for p in products limit: 3000 offset: 17 reversed %}{{ p.title }},{{ forloop.index0 }};{% endfor %}", c);
+      renderAll("{% for i in (3..4000) %}{{ i | times: 2 }} {% endfor %}", c);
+   }
+
+   SECTION("nested loops")
+   {
+      renderAll("{% for p in products %}{% for i in (1..3) %}{% if i == 3 %}{% break %}{% endif %}"
+                "{{ p.type }}{{ forloop.index }}{% endfor %}|{{ forloop.length }}{% endfor %}", c);
+   }
+
+   SECTION("variables set before the loop")
+   {
+      renderAll("{% assign prefix = 'x' %}{% capture s %}-{% endcapture %}"
+                "{% for p in products %}{{ prefix }}{{ p.type }}{{ s }}{% endfor %}", c);
+   }
+
+   SECTION("small and empty loops")
+   {
+      renderAll("{% for p in products limit: 1 %}{{ p.title }}{% endfor %}", c);
+      renderAll("{% for p in products limit: 0 %}{{ p.title }}{% else %}empty{% endfor %}", c);
+   }
+}
+
+TEST_CASE("Parallel loops: limits of the output", TestTags)
+{
+   auto& c = testContext();
+   auto templ = liquidpp::parse("{% for p in products %}{{ p.title }}{% endfor %}");
+   const auto full = templ(c);
+
+   auto errorOf = [&](size_t minParallelLoopSize) {
+      c.setMinParallelLoopSize(minParallelLoopSize);
+      try {
+         templ(c);
+      } catch (liquidpp::Exception& e) {
+         c.setMinParallelLoopSize(0);
+         return std::string{e.what()} + " " + std::to_string(e.position().line) + ":"
+                + std::to_string(e.position().column);
+      }
+      c.setMinParallelLoopSize(0);
+      return std::string{"no error"};
+   };
+
+   SECTION("maximal output size")
+   {
+      c.setMaxOutputSize(full.size() / 2);
+      auto serialError = errorOf(0);
+      c.setMaxOutputSize(full.size() / 2);
+      REQUIRE(errorOf(1) == serialError);
+      REQUIRE(serialError != "no error");
+      c.setMaxOutputSize(8 * 1024 * 1024);
+   }
+
+   SECTION("long running loops with only few output")
+   {
+      templ = liquidpp::parse("{% for p in products %}{% if p.type == 'hat' %}x{% endif %}{% endfor %}");
+      c.setMinOutputPer1024Loops(1000);
+      auto serialError = errorOf(0);
+      c.setMinOutputPer1024Loops(1000);
+      REQUIRE(errorOf(1) == serialError);
+      REQUIRE(serialError.find("Long running loop with only few output detected!") == 0);
+      c.setMinOutputPer1024Loops(0);
+   }
+}
+
+TEST_CASE("Parallel loops: worker pool", TestTags)
+{
+   liquidpp::WorkerPool pool{3};
+   REQUIRE(pool.concurrency() == 4);
+
+   std::vector<std::atomic<int>> calls(1000);
+   pool.run(calls.size(), [&](size_t i) { calls[i]++; });
+   for (auto&& cnt : calls)
+      REQUIRE(cnt == 1);
+
+   // jobs started by jobs
+   std::atomic<size_t> nested{0};
+   pool.run(8, [&](size_t) { pool.run(8, [&](size_t) { nested++; }); });
+   REQUIRE(nested == 64);
+
+   pool.run(0, [&](size_t) { nested++; });
+   REQUIRE(nested == 64);
+}
+}
@@ -120,3 +120,28 @@ TEST_CASE("multi dimensional array") {
       REQUIRE(pathObject[2].index() == 42);
    }
 }
+
+TEST_CASE("compact keys") {
+  REQUIRE(sizeof(liquidpp::Key) <= 24);
+
+  liquidpp::string_view path = "products[i].title";
+  auto pathObject = liquidpp::toPath(path);
+  REQUIRE(pathObject[0].hash() == static_cast<std::uint32_t>(liquidpp::hashName("products")));
+  REQUIRE(pathObject[0] == liquidpp::Key{"products"});
+  REQUIRE_FALSE(pathObject[0] == liquidpp::Key{"product"});
+  REQUIRE_FALSE(pathObject[0] == liquidpp::Key{size_t{0}});
+  REQUIRE(pathObject[1].name().empty());
+
+  SECTION("index variables are copied on write") {
+    auto copy = pathObject;
+    REQUIRE(copy == pathObject);
+
+    copy[1].mutableIndexVariable()[0] = liquidpp::Key{"j"};
+    REQUIRE(copy[1].indexVariable()[0].name() == "j");
+    REQUIRE(pathObject[1].indexVariable()[0].name() == "i");
+    REQUIRE_FALSE(copy == pathObject);
+
+    copy = pathObject;
+    REQUIRE(copy == pathObject);
+  }
+}
@@ -0,0 +1,138 @@
+#include "catch.hpp"
+
+#include <liquidpp.hpp>
+#include <liquidpp/Program.hpp>
+#include <liquidpp/tags/For.hpp>
+
+namespace ProgramTest
+{
+constexpr const char* TestTags = "[program]";
+
+using Product = std::map<std::string, std::string>;
+
+liquidpp::Context& testContext()
+{
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized)
+   {
+      c.set("name", "Donald Drumpf");
+      c.set("answer", 42);
+      c.set("numbers", std::vector<int>{1, 2, 3, 4, 5});
+      c.set("empty", std::vector<int>{});
+      c.set("products", std::vector<Product>{{{"title", "hat"}, {"type", "cap"}},
+                                             {{"title", "shirt"}, {"type", "top"}},
+                                             {{"title", "pants"}, {"type", "bottom"}}});
+      initialized = true;
+   }
+   return c;
+}
+
+std::string renderTree(liquidpp::string_view content)
+{
+   auto templ = liquidpp::parse(content);
+   return templ(testContext());
+}
+
+std::string renderCompiled(liquidpp::string_view content)
+{
+   auto templ = liquidpp::parse(content);
+   templ.compile();
+   REQUIRE(templ.program);
+   return templ(testContext());
+}
+
+TEST_CASE("Program: same output as tree renderer", TestTags)
+{
+   for (auto content : {
+      "Hello World!",
+      "Hello {{name}}!",
+      "{{ name | upcase | append: '!' }} {{ answer | plus: 1 }}",
+      "{% if answer == 42 %}yes{% endif %}",
+      "{% if answer != 42 %}yes{% else %}no{% endif %}",
+      "{% unless answer == 42 %}yes{% else %}no{% endunless %}",
+      "{% if answer < 10 %}small{% elsif answer < 50 %}medium{% elsif answer < 100 %}large{% else %}huge{% endif %}",
+      "{% if answer > 100 %}a{% elsif answer > 90 %}b{% else %}c{% elsif answer > 10 %}d{% endif %}",
+      "{% for n in numbers %}{{ n }}{% unless forloop.last %}, {% endunless %}{% endfor %}",
+      "{% for n in numbers reversed limit:3 offset:1 %}{{ forloop.index }}:{{ n }} {% endfor %}",
+      "{% for n in empty %}{{ n }}{% else %}nothing{% endfor %}",
+      "{% for i in (1..3) %}{% for j in (1..i) %}{{ i }}{{ j }} {% endfor %}{% endfor %}",
+      "{% for n in numbers %}{% if n == 3 %}{% continue %}{% endif %}{{ n }}{% endfor %}",
+      "{% for n in numbers %}{% if n == 3 %}{% break %}{% endif %}{{ n }}{% endfor %}",
+      "{% for p in products %}{% case p.type %}{% when 'top' %}{% break %}{% else %}{{ p.title }} {% endcase %}{% endfor %}",
+      "{% for p in products %}{{ p.title | capitalize }}{% if forloop.first %}*{% endif %} {% endfor %}",
+      "{{ products | map: 'title' | join: ', ' }}",
+      "{% capture greeting %}Hi {{ name }}{% endcapture %}{{ greeting }}!",
+      "{% assign x = 'foo' %}{{ x }}{% comment %}{{ ignored }}{% endcomment %}",
+      "{% cycle 'a', 'b' %}{% cycle 'a', 'b' %}{% cycle 'a', 'b' %}",
+      "{% increment counter %}{% increment counter %}{% decrement other %}"
+   })
+   {
+      SECTION(content)
+      {
+         REQUIRE(renderCompiled(content) == renderTree(content));
+      }
+   }
+}
+
+TEST_CASE("Program: instruction stream", TestTags)
+{
+   using liquidpp::Program;
+
+   auto templ = liquidpp::parse("Hello {{ name | upcase }}!{% if a %}a{% else %}b{% endif %}");
+   templ.compile();
+
+   std::vector<Program::OpCode> ops;
+   for (auto&& instr : templ.program->code())
+      ops.push_back(instr.op);
+
+   std::vector<Program::OpCode> expected{
+      Program::OpCode::Literal, Program::OpCode::Push, Program::OpCode::Filter,
+      Program::OpCode::Output, Program::OpCode::Literal, Program::OpCode::JumpIfFalse,
+      Program::OpCode::Literal, Program::OpCode::Jump, Program::OpCode::Literal,
+      Program::OpCode::Halt};
+   REQUIRE(ops == expected);
+}
+
+TEST_CASE("Program: template may be moved after compilation", TestTags)
+{
+   liquidpp::Template moved;
+   {
+      auto templ = liquidpp::parse("{{ name }}{% for n in numbers %}{{ n }}{% endfor %}");
+      templ.compile();
+      moved = std::move(templ);
+   }
+
+   REQUIRE(moved(testContext()) == "Donald Drumpf12345");
+}
+
+TEST_CASE("Program: errors", TestTags)
+{
+   liquidpp::Context c;
+
+   SECTION("break outside of loop")
+   {
+      auto templ = liquidpp::parse("{% break %}");
+      templ.compile();
+      REQUIRE_THROWS_AS(templ(c), liquidpp::DoBreak);
+   }
+
+   SECTION("malformed elsif is reported on parsing")
+   {
+      try {
+         liquidpp::parse("{% if a %}\n{% elsif == %}{% endif %}");
+         FAIL("Expected an exception!");
+      } catch(liquidpp::Exception& e) {
+         REQUIRE(e.position().line == 2);
+      }
+   }
+
+   SECTION("maximal output size")
+   {
+      c.setMaxOutputSize(100);
+      auto templ = liquidpp::parse("{% for i in (1..1000) %}{{ i }}{% endfor %}");
+      templ.compile();
+      REQUIRE_THROWS_AS(templ(c), liquidpp::Exception);
+   }
+}
+}
@@ -270,6 +270,36 @@ TEST_CASE("render std::pair") {
   REQUIRE(render("{{pair[3]}}") == "");
 }
 
+TEST_CASE("render size, first and last", TestTags) {
+  liquidpp::Context c;
+  auto render = [&](auto &&str) { return liquidpp::parse(str)(c); };
+
+  using Product = std::map<std::string, std::string>;
+  c.set("products", std::vector<Product>{{{"title", "hat"}}, {{"title", "shirt"}}, {{"title", "pants"}}});
+  c.set("empty", std::vector<int>{});
+  c.set("sizes", Product{{"size", "XL"}, {"first", "S"}});
+  c.set("name", "Donald");
+
+  REQUIRE(liquidpp::toPath("products.size")[1].builtinProperty() == liquidpp::BuiltinProperty::Size);
+  REQUIRE(liquidpp::toPath("products.last")[1].builtinProperty() == liquidpp::BuiltinProperty::Last);
+  REQUIRE(liquidpp::toPath("products.first.title")[1].builtinProperty() == liquidpp::BuiltinProperty::First);
+  REQUIRE(liquidpp::toPath("products.size.x")[1].builtinProperty() == liquidpp::BuiltinProperty::None);
+  REQUIRE(liquidpp::toPath("size")[0].builtinProperty() == liquidpp::BuiltinProperty::None);
+
+  REQUIRE(render("{{ products.size }} {{ products.first.title }} {{ products.last.title }}") == "3 hat pants");
+  REQUIRE(render("{{ products[1].title.size }} {{ name.size }}") == "5 6");
+  REQUIRE(render("{{ empty.size }}|{{ empty.first }}|{{ empty.last }}|{{ empty.first.title }}") == "0|||");
+  REQUIRE(render("{{ products | map: 'title' | join: ',' }} {{ products.last.title.size }}") == "hat,shirt,pants 5");
+
+  // keys of objects are not shadowed
+  REQUIRE(render("{{ sizes.size }} {{ sizes.first }} {{ sizes.last }}") == "XL S ");
+
+  // values set by templates
+  REQUIRE(render("{% assign words = 'a,b,c' | split: ',' %}{{ words.size }} {{ words.first }} {{ words.last }}")
+          == "3 a c");
+  REQUIRE(render("{% assign word = 'abc' %}{{ word.size }}") == "3");
+}
+
 TEST_CASE("render std::tuple") {
   liquidpp::Context c;
   auto render = [&](auto &&str) { return liquidpp::parse(str)(c); };
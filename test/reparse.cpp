@@ -0,0 +1,150 @@
+#include "catch.hpp"
+
+#include <liquidpp.hpp>
+#include <liquidpp/Reparse.hpp>
+
+namespace ReparseTest
+{
+constexpr const char* TestTags = "[reparse]";
+
+liquidpp::Context& testContext()
+{
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized)
+   {
+      c.set("name", "Donald Drumpf");
+      c.set("answer", 42);
+      c.set("numbers", std::vector<int>{1, 2, 3, 4, 5});
+      initialized = true;
+   }
+   return c;
+}
+
+const std::string Source = "<h1>{{ name | upcase }}</h1>\n"
+                           "{%- if answer == 42 -%} yes {%- else %}no{% endif %}\n"
+                           "{% for n in numbers %}{{ n }},{% endfor %}\n"
+                           "{% case answer %}{% when 42 %}answer{% endcase %}"
+                           "{% comment %}{{ ignored }}{% endcomment %}  {{- answer }}";
+
+std::string applied(const std::string& source, const liquidpp::TextEdit& edit)
+{
+   auto res = source;
+   res.replace(edit.offset, edit.removedLength, edit.insertedText.data(), edit.insertedText.size());
+   return res;
+}
+
+void requireEquivalent(const liquidpp::Template& templ, const std::string& source)
+{
+   auto expected = liquidpp::parse(source);
+   REQUIRE(templ(testContext()) == expected(testContext()));
+   REQUIRE(templ.root.nodeList.size() == expected.root.nodeList.size());
+   REQUIRE(templ.rootOffsets == expected.rootOffsets);
+   for (size_t i = 0; i < templ.root.nodeList.size(); i++)
+      REQUIRE(liquidpp::type(templ.root.nodeList[i]) == liquidpp::type(expected.root.nodeList[i]));
+}
+
+TEST_CASE("Reparse: edits are equivalent to a full parse", TestTags)
+{
+   std::vector<liquidpp::TextEdit> edits{
+      {0, 0, "Title: "},
+      {Source.size(), 0, "!"},
+      {4, 19, "{{ answer }}"},
+      {9, 5, "numbers.size"},
+      {0, Source.size(), "replaced"},
+      {Source.find("{%- if"), 3, "{% "},
+      {Source.find("{%- else"), 0, "{{ 'x' -}}"},
+      {Source.find("yes"), 3, "{{- name }}"},
+      {Source.find("{% for"), 0, "{% unless false %}no{% endunless %}"},
+      {Source.find("{{ n }}"), 7, "[{{ n | plus: 1 }}]"},
+      {Source.find("42 %}answer"), 2, "7"},
+      {Source.find("{% comment"), 0, "   "},
+      {Source.find("  {{- answer"), 2, ""},
+      {Source.find("{%- else"), 3, "{%"}
+   };
+
+   for (auto&& edit : edits)
+   {
+      auto expected = applied(Source, edit);
+      SECTION(expected)
+      {
+         auto res = liquidpp::reparse(liquidpp::parse(Source), edit);
+         requireEquivalent(res, expected);
+
+         // a series of edits
+         auto again = liquidpp::reparse(std::move(res), {0, 0, "{{ answer }}"});
+         requireEquivalent(again, "{{ answer }}" + expected);
+      }
+   }
+}
+
+TEST_CASE("Reparse: all single character edits", TestTags)
+{
+   for (size_t offset = 0; offset <= Source.size(); offset++)
+   {
+      for (auto inserted : {"{", "}", "-", " ", "x"})
+      {
+         liquidpp::TextEdit edit{offset, 0, inserted};
+         auto expected = applied(Source, edit);
+         try {
+            requireEquivalent(liquidpp::reparse(liquidpp::parse(Source), edit), expected);
+         } catch(liquidpp::Exception&) {
+            REQUIRE_THROWS_AS(liquidpp::parse(expected), liquidpp::Exception);
+         }
+
+         if (offset < Source.size())
+         {
+            edit.removedLength = 1;
+            expected = applied(Source, edit);
+            try {
+               requireEquivalent(liquidpp::reparse(liquidpp::parse(Source), edit), expected);
+            } catch(liquidpp::Exception&) {
+               REQUIRE_THROWS_AS(liquidpp::parse(expected), liquidpp::Exception);
+            }
+         }
+      }
+   }
+}
+
+TEST_CASE("Reparse: untouched nodes are reused", TestTags)
+{
+   auto templ = liquidpp::parse(Source);
+   templ.compile();
+   auto forIdx = std::find(templ.rootOffsets.begin(), templ.rootOffsets.end(), Source.find("{% for")) - templ.rootOffsets.begin();
+   auto forTag = boost::get<std::unique_ptr<const liquidpp::IRenderable>>(templ.root.nodeList[forIdx]).get();
+
+   auto res = liquidpp::reparse(std::move(templ), {0, 4, "<h2>"});
+   REQUIRE(boost::get<std::unique_ptr<const liquidpp::IRenderable>>(res.root.nodeList[forIdx]).get() == forTag);
+   REQUIRE(res.program);
+   REQUIRE(res(testContext()) == liquidpp::parse(applied(Source, {0, 4, "<h2>"}))(testContext()));
+
+   // the result owns the edited source
+   REQUIRE(res.literals);
+   REQUIRE(res.root.templateRange.data() == res.literals->data().data());
+}
+
+TEST_CASE("Reparse: errors", TestTags)
+{
+   SECTION("edit outside of the source")
+   {
+      REQUIRE_THROWS(liquidpp::reparse(liquidpp::parse(Source), {Source.size() + 1, 0, "x"}));
+      REQUIRE_THROWS(liquidpp::reparse(liquidpp::parse(Source), {1, Source.size(), ""}));
+   }
+
+   SECTION("compacted template")
+   {
+      REQUIRE_THROWS(liquidpp::reparse(liquidpp::parse(Source, liquidpp::SourceStorage::Compact), {0, 0, "x"}));
+   }
+
+   SECTION("parse errors refer to the edited source")
+   {
+      try {
+         liquidpp::reparse(liquidpp::parse(Source), {Source.find("{% endfor %}"), 12, ""});
+         FAIL("Expected an exception!");
+      } catch(liquidpp::Exception& e) {
+         REQUIRE(e.position().line == 3);
+         REQUIRE(e.position().column == 4);
+      }
+   }
+}
+}
@@ -0,0 +1,97 @@
+#include "catch.hpp"
+
+#include <liquidpp.hpp>
+#include <liquidpp/Scanner.hpp>
+
+namespace ScannerTest
+{
+constexpr const char* TestTags = "[scanner]";
+
+using liquidpp::scanner::Isa;
+
+size_t expectedPair(const std::string& data, char first, char second, char alternative)
+{
+   for (size_t i = 1; i < data.size(); i++)
+   {
+      if (data[i-1] == first && (data[i] == second || data[i] == alternative))
+         return i - 1;
+   }
+   return std::string::npos;
+}
+
+struct IsaGuard
+{
+   ~IsaGuard()
+   {
+      liquidpp::scanner::setIsa(previous);
+   }
+
+   Isa previous{liquidpp::scanner::activeIsa()};
+};
+
+TEST_CASE("Scanner: all implementations find the first pair", TestTags)
+{
+   IsaGuard guard;
+   for (auto isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2})
+   {
+      if (!liquidpp::scanner::setIsa(isa))
+         continue;
+
+      SECTION("isa " + std::to_string(static_cast<int>(isa)))
+      {
+         for (size_t size = 0; size <= 100; size++)
+         {
+            for (size_t pos = 0; pos <= size; pos++)
+            {
+               // noise with single delimiters, the pair (if any) at pos
+               std::string data(size, 'x');
+               for (size_t i = 0; i < size; i += 3)
+                  data[i] = i % 2 ? '{' : '}';
+               if (pos + 1 < size)
+               {
+                  data[pos] = '{';
+                  data[pos + 1] = pos % 2 ? '{' : '%';
+               }
+
+               const auto expected = expectedPair(data, '{', '{', '%');
+               REQUIRE(liquidpp::scanner::findTagOpening(data.data(), size) == expected);
+               REQUIRE(liquidpp::scanner::findPair(data.data(), size, '%', '}') == expectedPair(data, '%', '}', '}'));
+            }
+         }
+      }
+   }
+}
+
+TEST_CASE("Scanner: parsing does not depend on the implementation", TestTags)
+{
+   IsaGuard guard;
+   std::string content;
+   for (int i = 0; i < 20; i++)
+      content += "<p class=\"item\">  {{- name | upcase }}{% if true -%} {x} { {% endif %}</p>\n";
+
+   liquidpp::Context c;
+   c.set("name", "Donald Drumpf");
+   liquidpp::scanner::setIsa(Isa::Scalar);
+   const auto expected = liquidpp::render(content, c);
+
+   for (auto isa : {Isa::SSE2, Isa::AVX2})
+   {
+      if (liquidpp::scanner::setIsa(isa))
+         REQUIRE(liquidpp::render(content, c) == expected);
+   }
+}
+
+TEST_CASE("Scanner: character classes", TestTags)
+{
+   using namespace liquidpp::scanner;
+   for (int i = 0; i < 256; i++)
+   {
+      const char c = static_cast<char>(i);
+      const bool whitespace = c == ' ' || c == '\t' || c == '\r' || c == '\n';
+      REQUIRE(((charClass(c) & Whitespace) != 0) == whitespace);
+      REQUIRE(((charClass(c) & Quote) != 0) == (c == '"' || c == '\''));
+   }
+   REQUIRE(charClass('|') == OperatorChar);
+   REQUIRE(charClass('a') == 0);
+}
+}
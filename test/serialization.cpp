@@ -0,0 +1,153 @@
+#include "catch.hpp"
+
+#include <cstdio>
+
+#include <liquidpp.hpp>
+#include <liquidpp/Serialization.hpp>
+
+namespace SerializationTest
+{
+constexpr const char* TestTags = "[serialization]";
+
+using Product = std::map<std::string, std::string>;
+
+liquidpp::Context& testContext()
+{
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized)
+   {
+      c.set("name", "Donald Drumpf");
+      c.set("answer", 42);
+      c.set("pi", 3.14159);
+      c.set("numbers", std::vector<int>{1, 2, 3, 4, 5});
+      c.set("empty", std::vector<int>{});
+      c.set("products", std::vector<Product>{{{"title", "hat"}, {"type", "cap"}},
+                                             {{"title", "shirt"}, {"type", "top"}},
+                                             {{"title", "pants"}, {"type", "bottom"}}});
+      initialized = true;
+   }
+   return c;
+}
+
+const std::vector<std::string>& corpus()
+{
+   static const std::vector<std::string> res{
+      "",
+      "Hello World!",
+      "Hello {{name}}!",
+      "{{ name | upcase | append: '!' | replace: 'DON', \"ron\" }} {{ answer | plus: 1 }}",
+      "{{ pi | round: 2 }} {{ answer | divided_by: 4.0 }} {{ -7 | abs }} {{ nil | default: 'none' }}",
+      "{{ products[1].title }} {{ products[answer].title }} {{ numbers.size }} {{ numbers.first }}",
+      "{% if answer == 42 and name contains 'Don' %}yes{% endif %}",
+      "{% if answer < 10 %}small{% elsif answer < 50 %}medium{% elsif answer < 100 %}large{% else %}huge{% endif %}",
+      "{% unless answer == 42 %}yes{% else %}no{% endunless %}",
+      "{% if true %}t{% endif %}{% if false %}f{% endif %}{% if empty == empty %}e{% endif %}",
+      "{%- for n in numbers reversed limit:3 offset:1 -%} {{ forloop.index }}:{{ n }} {%- endfor %}",
+      "{% for n in empty %}{{ n }}{% else %}nothing{% endfor %}",
+      "{% for i in (1..3) %}{% for j in (1..i) %}{{ i }}{{ j }} {% endfor %}{% endfor %}",
+      "{% for n in numbers %}{% if n == 3 %}{% continue %}{% endif %}{% if n == 5 %}{% break %}{% endif %}{{ n }}{% endfor %}",
+      "{% for p in products %}{% case p.type %}{% when 'top', 'cap' %}{{ p['title'] }}{% else %}?{% endcase %}{% endfor %}",
+      "{% case answer %}{% when 1 %}one{% when 42 or 43 %}answer{% endcase %}",
+      "{{ products | map: 'title' | join: ', ' }}",
+      "{% capture greeting %}Hi {{ name }}{% endcapture %}{{ greeting }}!",
+      "{% assign x = 'foo' | append: 'bar' %}{{ x }}{% comment %}{{ ignored }}{% endcomment %}",
+      "{% cycle 'a', 'b' %}{% cycle 'a', 'b' %}{% cycle 'g': 'c', 'd' %}",
+      "{% increment counter %}{% increment counter %}{% decrement other %}",
+      "{% unknown tag %}text"
+   };
+   return res;
+}
+
+TEST_CASE("Serialization: round trip of the corpus", TestTags)
+{
+   for (auto&& content : corpus())
+   {
+      SECTION(content)
+      {
+         auto templ = liquidpp::parse(content);
+         auto expected = templ(testContext());
+
+         auto data = liquidpp::serialize(templ);
+         auto loaded = liquidpp::deserialize(data);
+         std::fill(data.begin(), data.end(), '#');
+         REQUIRE(loaded(testContext()) == expected);
+
+         // again from the loaded template and from a compacted one
+         REQUIRE(liquidpp::serialize(loaded) == liquidpp::serialize(liquidpp::deserialize(liquidpp::serialize(loaded))));
+         auto compacted = liquidpp::parse(content, liquidpp::SourceStorage::Compact);
+         REQUIRE(liquidpp::deserialize(liquidpp::serialize(compacted))(testContext()) == expected);
+
+         loaded.compile();
+         REQUIRE(loaded(testContext()) == expected);
+      }
+   }
+}
+
+TEST_CASE("Serialization: files are mapped into memory", TestTags)
+{
+   auto path = std::string{"liquidpp_serialization_test.bin"};
+   liquidpp::saveBinary(liquidpp::parse("Hello {{ name | upcase }}!"), path);
+
+   auto loaded = liquidpp::loadBinary(path);
+   std::remove(path.c_str());
+
+   REQUIRE(loaded.literals);
+   REQUIRE(loaded(testContext()) == "Hello DONALD DRUMPF!");
+}
+
+struct ShoutingFilterFactory
+{
+   liquidpp::filters::Filter operator()(liquidpp::string_view name) const
+   {
+      if (name == "upcase")
+         return liquidpp::FilterFactory{}("append");
+      return liquidpp::FilterFactory{}(name);
+   }
+};
+
+TEST_CASE("Serialization: filters are bound on loading", TestTags)
+{
+   auto data = liquidpp::serialize(liquidpp::parse("{{ name | upcase: '!' }}"));
+   auto loaded = liquidpp::deserialize<liquidpp::TagFactory, ShoutingFilterFactory>(data);
+   REQUIRE(loaded(testContext()) == "Donald Drumpf!");
+}
+
+TEST_CASE("Serialization: error positions refer to the source", TestTags)
+{
+   auto templ = liquidpp::parse("\n\n  {% for i in (1..1000) %}{{ i }}{% endfor %}", liquidpp::SourceStorage::Compact);
+   auto loaded = liquidpp::deserialize(liquidpp::serialize(templ));
+
+   liquidpp::Context c;
+   c.setMaxOutputSize(100);
+   try {
+      loaded(c);
+      FAIL("Expected an exception!");
+   } catch(liquidpp::Exception& e) {
+      REQUIRE(e.position().line == 3);
+      REQUIRE(e.position().column == 6);
+   }
+}
+
+TEST_CASE("Serialization: invalid data", TestTags)
+{
+   auto data = liquidpp::serialize(liquidpp::parse("Hello {{ name }}!"));
+
+   SECTION("no binary template")
+   {
+      REQUIRE_THROWS(liquidpp::deserialize("Hello {{ name }}!"));
+   }
+
+   SECTION("other version")
+   {
+      data[4]++;
+      REQUIRE_THROWS(liquidpp::deserialize(data));
+   }
+
+   SECTION("truncated")
+   {
+      for (size_t len = 0; len < data.size(); len++)
+         REQUIRE_THROWS(liquidpp::deserialize(liquidpp::string_view{data.data(), len}));
+   }
+}
+}
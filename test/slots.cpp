@@ -0,0 +1,139 @@
+#include "catch.hpp"
+
+#include <liquidpp.hpp>
+#include <liquidpp/Reparse.hpp>
+#include <liquidpp/Serialization.hpp>
+#include <liquidpp/Variable.hpp>
+#include <liquidpp/tags/For.hpp>
+
+namespace SlotsTest
+{
+constexpr const char* TestTags = "[slots]";
+
+liquidpp::Context& testContext()
+{
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized)
+   {
+      c.set("x", "context");
+      c.set("c", false);
+      c.set("numbers", std::vector<int>{1, 2, 3});
+      c.set("products", std::vector<std::map<std::string, std::string>>{{{"title", "hat"}}, {{"title", "shirt"}}});
+      initialized = true;
+   }
+   return c;
+}
+
+std::string render(liquidpp::string_view content)
+{
+   return liquidpp::parse(content)(testContext());
+}
+
+TEST_CASE("Slots: names are bound at parse time", TestTags)
+{
+   auto templ = liquidpp::parse("{{ x }}{% assign x = 1 %}{% for n in numbers %}{{ n }}{{ forloop.index }}{{ y }}{% endfor %}{{ n }}");
+   REQUIRE(templ.slotCount == 3);
+
+   auto& nodes = templ.root.nodeList;
+   auto slot = [&](size_t idx) {
+      return boost::get<liquidpp::Path>(boost::get<liquidpp::Variable>(nodes[idx]).variable)[0].slot();
+   };
+   REQUIRE(slot(0) == 0);
+   REQUIRE(slot(3) == liquidpp::NoSlot);
+
+   auto& forTag = dynamic_cast<const liquidpp::For&>(*boost::get<std::unique_ptr<const liquidpp::IRenderable>>(nodes[2]));
+   auto& body = forTag.body.nodeList;
+   auto bodySlot = [&](size_t idx) {
+      return boost::get<liquidpp::Path>(boost::get<liquidpp::Variable>(body[idx]).variable)[0].slot();
+   };
+   REQUIRE(bodySlot(0) == forTag.loopVariableSlot);
+   REQUIRE(bodySlot(1) == forTag.forloopSlot);
+   REQUIRE(bodySlot(2) == liquidpp::NoSlot);
+}
+
+TEST_CASE("Slots: forloop properties are resolved at parse time", TestTags)
+{
+   auto templ = liquidpp::parse("{% for n in numbers %}{{ forloop.rindex0 }}{{ forloop.foo }}{{ forloop }}"
+                                "{{ forloop.index.size }}{% endfor %}{{ forloop.index }}");
+
+   auto& nodes = templ.root.nodeList;
+   auto& forTag = dynamic_cast<const liquidpp::For&>(*boost::get<std::unique_ptr<const liquidpp::IRenderable>>(nodes[0]));
+   auto property = [&](const liquidpp::BlockBody& body, size_t idx, size_t key) {
+      auto& path = boost::get<liquidpp::Path>(boost::get<liquidpp::Variable>(body.nodeList[idx]).variable);
+      return path[key].loopProperty();
+   };
+   REQUIRE(property(forTag.body, 0, 1) == liquidpp::LoopProperty::Rindex0);
+   REQUIRE(property(forTag.body, 1, 1) == liquidpp::LoopProperty::None);
+   REQUIRE(property(forTag.body, 3, 1) == liquidpp::LoopProperty::None);
+   REQUIRE(property(templ.root, 1, 1) == liquidpp::LoopProperty::None);
+
+   REQUIRE(render("{% for n in numbers %}{{ forloop.first }},{{ forloop.last }},{{ forloop.index }},{{ forloop.index0 }},"
+                  "{{ forloop.length }},{{ forloop.rindex }},{{ forloop.rindex0 }},{{ forloop.foo }};{% endfor %}")
+           == "true,false,1,0,3,3,2,;false,false,2,1,3,2,1,;false,true,3,2,3,1,0,;");
+   REQUIRE(render("{% for n in numbers offset: 1 %}{% if forloop.last %}{{ n }}{% endif %}{% endfor %}") == "3");
+
+   // outside of the loop 'forloop' is looked up by name
+   REQUIRE(render("{% for n in numbers %}{% endfor %}{{ forloop.index }}{% assign forloop = products[1] %}"
+                  "{{ forloop.title }}") == "shirt");
+}
+
+TEST_CASE("Slots: rendering", TestTags)
+{
+   SECTION("unset slots fall back to the context")
+   {
+      REQUIRE(render("{{ x }}{% assign x = 'local' %}{{ x }}") == "contextlocal");
+      REQUIRE(render("{% if c %}{% assign x = 'local' %}{% endif %}{{ x }}") == "context");
+   }
+
+   SECTION("loop variables shadow assigned names")
+   {
+      REQUIRE(render("{% assign n = 'a' %}{% for n in numbers %}{{ n }}{% assign n = 'b' %}{{ n }}{% endfor %}{{ n }}")
+              == "112233b");
+      REQUIRE(render("{% for x in numbers %}{% for x in products %}{{ x.title }}{% endfor %}{{ x }}{% endfor %}{{ x }}")
+              == "hatshirt1hatshirt2hatshirt3context");
+   }
+
+   SECTION("loops read the forloop object of their own loop")
+   {
+      REQUIRE(render("{% for a in numbers limit: 2 %}{% for b in (1..2) %}{{ forloop.index }}{% endfor %}"
+                     "{{ forloop.index }};{% endfor %}")
+              == "121;122;");
+   }
+
+   SECTION("captures, counters and cycles")
+   {
+      REQUIRE(render("{% capture x %}{% increment i %}{% increment i %}{% endcapture %}{{ x }}{% increment i %}"
+                     "{% cycle 'a', 'b' %}{% cycle 'a', 'b' %}{% cycle 'a', 'b' %}{% decrement i %}")
+              == "012aba-1");
+   }
+
+   SECTION("assigned objects")
+   {
+      REQUIRE(render("{% for p in products %}{% assign last = p %}{% endfor %}{{ last.title }}") == "shirt");
+   }
+}
+
+TEST_CASE("Slots: all ways to create a template", TestTags)
+{
+   const std::string source = "{% assign x = 'a' %}{% for n in numbers %}{% capture c %}{{ x }}{{ n }}{% endcapture %}"
+                              "{% assign x = c %}{% endfor %}{{ x }} {{ forloop.index }}";
+   const std::string expected = "a123 ";
+
+   REQUIRE(render(source) == expected);
+
+   auto compiled = liquidpp::parse(source);
+   compiled.compile();
+   REQUIRE(compiled(testContext()) == expected);
+
+   auto optimized = liquidpp::parse(source);
+   optimized.optimize();
+   REQUIRE(optimized(testContext()) == expected);
+
+   REQUIRE(liquidpp::parse(source, liquidpp::SourceStorage::Compact)(testContext()) == expected);
+   REQUIRE(liquidpp::deserialize(liquidpp::serialize(liquidpp::parse(source)))(testContext()) == expected);
+
+   auto edited = liquidpp::reparse(liquidpp::parse(source), liquidpp::TextEdit{source.size(), 0, "{{ n }}{{ c }}"});
+   REQUIRE(edited(testContext()) == expected + "a123");
+}
+}
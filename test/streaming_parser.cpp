@@ -0,0 +1,133 @@
+#include "catch.hpp"
+
+#include <cstring>
+#include <sstream>
+
+#include <liquidpp.hpp>
+#include <liquidpp/StreamingParser.hpp>
+
+namespace StreamingParserTest
+{
+constexpr const char* TestTags = "[streaming_parser]";
+
+liquidpp::Context& testContext()
+{
+   static liquidpp::Context c;
+   static bool initialized = false;
+   if (!initialized)
+   {
+      c.set("name", "Donald Drumpf");
+      c.set("answer", 42);
+      c.set("numbers", std::vector<int>{1, 2, 3, 4, 5});
+      initialized = true;
+   }
+   return c;
+}
+
+liquidpp::Template parseChunked(liquidpp::string_view content, size_t chunkSize)
+{
+   liquidpp::StreamingParser<> parser;
+   for (size_t pos = 0; pos < content.size(); pos += chunkSize)
+      parser.feed(content.substr(pos, chunkSize));
+   return parser.finish();
+}
+
+TEST_CASE("StreamingParser: same output as parse()", TestTags)
+{
+   for (auto content : {
+      "",
+      "Hello World!",
+      "Hello {{name}}!",
+      "{{ name | upcase | append: '!' }} {{ answer | plus: 1 }}",
+      "{% if answer == 42 %}yes{% else %}no{% endif %} {% unless answer %}{% endunless %}",
+      "{%- for n in numbers reversed limit:3 offset:1 -%} {{ forloop.index }}:{{ n }} {%- endfor %}",
+      "{% for n in numbers %}{% if n == 3 %}{% continue %}{% endif %}{{ n }}{% endfor %}",
+      "a  \n {{- name -}} \n\n  b {%- comment %} x {% endcomment -%}   c { d {x} {",
+      "{ {{ '{%' }} } {% assign y = '}}' %}{{ y }}",
+      "{% case answer %}{% when 42 %}answer{% else %}other{% endcase %}  "
+   })
+   {
+      SECTION(content)
+      {
+         auto expected = liquidpp::parse(content)(testContext());
+         for (size_t chunkSize = 1; chunkSize <= std::strlen(content) + 1; chunkSize++)
+         {
+            auto templ = parseChunked(content, chunkSize);
+            REQUIRE(templ(testContext()) == expected);
+         }
+      }
+   }
+}
+
+TEST_CASE("StreamingParser: the template owns its input", TestTags)
+{
+   std::string content = "Hello {{ name }}! {% for n in numbers %}{{ n }}{% endfor %}";
+   auto expected = liquidpp::parse(content)(testContext());
+
+   liquidpp::StreamingParser<> parser;
+   for (size_t pos = 0; pos < content.size(); pos += 7)
+   {
+      std::string chunk = content.substr(pos, 7);
+      parser.feed(chunk);
+      std::fill(chunk.begin(), chunk.end(), '#');
+   }
+
+   auto templ = parser.finish();
+   REQUIRE(templ.literals);
+   REQUIRE(templ(testContext()) == expected);
+   REQUIRE_THROWS(parser.feed("x"));
+}
+
+TEST_CASE("StreamingParser: streams", TestTags)
+{
+   std::string content;
+   for (int i = 0; i < 1000; i++)
+      content += "Line " + std::to_string(i) + ": {{ name | upcase }} {% if answer == 42 %}{{ answer }}{% endif %}\n";
+   auto expected = liquidpp::parse(content)(testContext());
+
+   for (size_t chunkSize : {7, 100, 4096, 1 << 20})
+   {
+      std::istringstream input(content);
+      REQUIRE(liquidpp::parseStream(input, chunkSize)(testContext()) == expected);
+   }
+}
+
+TEST_CASE("StreamingParser: error positions", TestTags)
+{
+   for (size_t chunkSize : {1, 5, 100})
+   {
+      SECTION("unterminated tag, chunk size " + std::to_string(chunkSize))
+      {
+         try {
+            parseChunked("Line 1\nLine 2 {{ name }}\n  {{ name", chunkSize);
+            FAIL("Expected an exception!");
+         } catch(liquidpp::Exception& e) {
+            REQUIRE(e.position().line == 3);
+            REQUIRE(e.position().column == 3);
+         }
+      }
+
+      SECTION("missing closing tag, chunk size " + std::to_string(chunkSize))
+      {
+         try {
+            parseChunked("\n\n{% if true %}{% for n in numbers %}\n{% endfor %}", chunkSize);
+            FAIL("Expected an exception!");
+         } catch(liquidpp::Exception& e) {
+            REQUIRE(e.position().line == 3);
+            REQUIRE(e.position().column == 4);
+         }
+      }
+
+      SECTION("invalid tag, chunk size " + std::to_string(chunkSize))
+      {
+         try {
+            parseChunked("{{ name }}\n {% 1nvalid %}", chunkSize);
+            FAIL("Expected an exception!");
+         } catch(liquidpp::Exception& e) {
+            REQUIRE(e.position().line == 2);
+            REQUIRE(e.position().column == 5);
+         }
+      }
+   }
+}
+}
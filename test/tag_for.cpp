@@ -23,6 +23,21 @@ TEST_CASE("parse for tag") {
   REQUIRE(forTag);
   REQUIRE(forTag->loopVariable == "var");
   REQUIRE(forTag->rangePath == liquidpp::Path{liquidpp::Key{"range"}});
+  REQUIRE(forTag->loopBody.begin == 0);
+  REQUIRE(forTag->loopBody.end == 1);
+  REQUIRE(forTag->elseBody.empty());
+}
+
+TEST_CASE("parse for tag with else") {
+  auto templ = liquidpp::parse("{%for var in range%}{{var}} {%else%}empty{%endfor%}");
+  auto& tagPtr = boost::get<std::unique_ptr<const liquidpp::IRenderable>>(
+      templ.root.nodeList[0]);
+  auto forTag = dynamic_cast<const liquidpp::For*>(tagPtr.get());
+  REQUIRE(forTag);
+  REQUIRE(forTag->loopBody.begin == 0);
+  REQUIRE(forTag->loopBody.end == 2);
+  REQUIRE(forTag->elseBody.begin == 3);
+  REQUIRE(forTag->elseBody.end == 4);
 }
 
 TEST_CASE("for loop on single value") {
@@ -71,6 +86,51 @@ TEST_CASE("for loop on boost::property_tree") {
   }
 }
 
+TEST_CASE("for loop scope") {
+  using Product = std::map<std::string, std::string>;
+  liquidpp::Context c;
+  c.set("products", std::vector<Product>{{{"title", "hat"}, {"type", "cap"}},
+                                         {{"title", "shirt"}, {"type", "top"}},
+                                         {{"title", "pants"}, {"type", "bottom"}}});
+  c.set("names", std::vector<std::string>{"a", "a long name that is not stored inline", "c"});
+  c.set("grid", std::vector<std::vector<int>>{{1, 2}, {3}});
+
+  SECTION("strings are rebound per element") {
+    auto rendered = liquidpp::render("{% for n in names %}{{ n | size }},{{ n }};{% endfor %}", c);
+    REQUIRE(rendered == "1,a;37,a long name that is not stored inline;1,c;");
+  }
+
+  SECTION("assigned elements keep referring to their element") {
+    auto rendered = liquidpp::render(
+        "{% for p in products %}{% if p.type == 'top' %}{% assign found = p %}{% endif %}{% endfor %}"
+        "{{ found.title }} {{ p.title }}", c);
+    REQUIRE(rendered == "shirt ");
+  }
+
+  SECTION("nested ranges") {
+    auto rendered = liquidpp::render(
+        "{% for row in grid %}{% for v in row reversed %}{{ forloop.index }}:{{ v }} {% endfor %}"
+        "{{ forloop.index }}|{% endfor %}", c);
+    REQUIRE(rendered == "1:2 2:1 1|1:3 2|");
+  }
+
+  SECTION("assigned forloop objects read the counters of the loop") {
+    auto rendered = liquidpp::render(
+        "{% for p in products %}{% assign loop = forloop %}{{ loop.index }}{% endfor %}", c);
+    REQUIRE(rendered == "123");
+  }
+
+  SECTION("templates without bound slots") {
+    auto templ = liquidpp::parse(
+        "{% for p in products offset: 1 %}{{ forloop.index }}:{{ p.title }} {% endfor %}");
+    auto forTag = const_cast<liquidpp::For*>(dynamic_cast<const liquidpp::For*>(
+        boost::get<std::unique_ptr<const liquidpp::IRenderable>>(templ.root.nodeList[0]).get()));
+    forTag->loopVariableSlot = liquidpp::NoSlot;
+    forTag->forloopSlot = liquidpp::NoSlot;
+    REQUIRE(templ(c) == "1:shirt 2:pants ");
+  }
+}
+
 #ifdef LIQUIDPP_HAVE_RAPIDJSON
 TEST_CASE("for loop on rapidjson::Document") {
   rapidjson::Document jsonDoc;
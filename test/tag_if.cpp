@@ -33,6 +33,27 @@ TEST_CASE("parse if tag")
       REQUIRE(ifTag);
       REQUIRE(ifTag->expression.tokens.size() == 3);
    }
+
+   SECTION("elsif and else branches")
+   {
+      auto templ = liquidpp::parse("{%if a%}A{%elsif b == 1%}B{%elsif c%}C{%else%}D{%endif%}");
+      REQUIRE(templ.root.nodeList.size() == 1);
+      auto& tagPtr = boost::get<std::unique_ptr<const liquidpp::IRenderable>>(templ.root.nodeList[0]);
+      auto ifTag = dynamic_cast<const liquidpp::If*>(tagPtr.get());
+      REQUIRE(ifTag);
+      REQUIRE(ifTag->branches.size() == 4);
+      REQUIRE_FALSE(static_cast<bool>(ifTag->branches[0].condition));
+      REQUIRE(static_cast<bool>(ifTag->branches[1].condition));
+      REQUIRE(ifTag->branches[1].condition->tokens.size() == 3);
+      REQUIRE(static_cast<bool>(ifTag->branches[2].condition));
+      REQUIRE_FALSE(static_cast<bool>(ifTag->branches[3].condition));
+
+      for (auto&& branch : ifTag->branches)
+      {
+         REQUIRE(branch.nodes.end == branch.nodes.begin + 1);
+         REQUIRE(liquidpp::type(ifTag->body.nodeList[branch.nodes.begin]) == liquidpp::NodeType::String);
+      }
+   }
 }
 
 TEST_CASE("render if unary operator")
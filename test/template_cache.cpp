@@ -0,0 +1,173 @@
+#include "catch.hpp"
+
+#include <thread>
+
+#include <liquidpp.hpp>
+
+namespace TemplateCacheTest
+{
+constexpr const char* TestTags = "[cache]";
+
+liquidpp::TemplateCache::Options singleShard()
+{
+   auto options = liquidpp::TemplateCache::defaultOptions();
+   options.shardCount = 1;
+   return options;
+}
+
+TEST_CASE("TemplateCache: keyed by content", TestTags)
+{
+   liquidpp::TemplateCache cache;
+   liquidpp::Context c;
+   c.set("name", "World");
+
+   auto first = cache.get("Hello {{ name }}!");
+   auto second = cache.get(std::string{"Hello {{ name }}!"});
+   REQUIRE(first == second);
+   REQUIRE((*first)(c) == "Hello World!");
+   REQUIRE(liquidpp::render(cache, "Hello {{ name }}!", c) == "Hello World!");
+
+   auto stats = cache.statistics();
+   REQUIRE(stats.hits == 2);
+   REQUIRE(stats.misses == 1);
+   REQUIRE(stats.entries == 1);
+   REQUIRE(stats.bytes > 0);
+}
+
+TEST_CASE("TemplateCache: keyed by name", TestTags)
+{
+   liquidpp::TemplateCache cache;
+   liquidpp::Context c;
+
+   size_t loads = 0;
+   auto loader = [&]{ loads++; return std::string{"{{ 1 | plus: 1 }}"}; };
+
+   REQUIRE((*cache.get("two", loader))(c) == "2");
+   REQUIRE((*cache.get("two", loader))(c) == "2");
+   REQUIRE(loads == 1);
+
+   SECTION("put replaces a template")
+   {
+      auto old = cache.find("two");
+      cache.put("two", "{{ 3 | minus: 1 }}");
+      REQUIRE((*cache.find("two"))(c) == "2");
+      REQUIRE(cache.find("two") != old);
+      REQUIRE((*old)(c) == "2");
+      REQUIRE(cache.statistics().entries == 1);
+   }
+
+   SECTION("erase")
+   {
+      REQUIRE(cache.erase("two"));
+      REQUIRE_FALSE(cache.erase("two"));
+      REQUIRE(cache.find("two") == nullptr);
+      cache.get("two", loader);
+      REQUIRE(loads == 2);
+   }
+
+   SECTION("name and content keys are independent")
+   {
+      cache.get("{{ 1 | plus: 1 }}");
+      REQUIRE(cache.statistics().entries == 2);
+      REQUIRE(cache.statistics().misses == 2);
+   }
+
+   SECTION("clear")
+   {
+      cache.clear();
+      REQUIRE(cache.statistics().entries == 0);
+      REQUIRE(cache.statistics().bytes == 0);
+      REQUIRE(cache.find("two") == nullptr);
+   }
+
+   SECTION("parse errors are not cached")
+   {
+      REQUIRE_THROWS_AS(cache.get("broken", []{ return std::string{"{% if %}"}; }), liquidpp::Exception);
+      REQUIRE(cache.find("broken") == nullptr);
+   }
+}
+
+TEST_CASE("TemplateCache: eviction", TestTags)
+{
+   liquidpp::Context c;
+
+   SECTION("by number of entries")
+   {
+      auto options = singleShard();
+      options.maxEntries = 2;
+      liquidpp::TemplateCache cache(options);
+
+      cache.put("a", "a");
+      cache.put("b", "b");
+      REQUIRE(cache.find("a")); // 'b' is the least recently used entry now
+      cache.put("c", "c");
+
+      REQUIRE(cache.find("a"));
+      REQUIRE(cache.find("b") == nullptr);
+      REQUIRE(cache.find("c"));
+      REQUIRE(cache.statistics().evictions == 1);
+      REQUIRE(cache.statistics().entries == 2);
+   }
+
+   SECTION("by size")
+   {
+      auto options = singleShard();
+      options.maxBytes = 1024;
+      liquidpp::TemplateCache cache(options);
+
+      auto small = cache.get("{{ small }}");
+      cache.get(std::string(2048, 'x'));
+
+      auto stats = cache.statistics();
+      REQUIRE(stats.evictions == 1);
+      REQUIRE(stats.entries == 1);
+
+      // evicted templates stay valid
+      c.set("small", "still valid");
+      REQUIRE((*small)(c) == "still valid");
+   }
+}
+
+TEST_CASE("TemplateCache: compile templates", TestTags)
+{
+   auto options = singleShard();
+   options.compile = true;
+   liquidpp::TemplateCache cache(options);
+
+   auto templ = cache.get("{% for i in (1..3) %}{{ i }}{% endfor %}");
+   REQUIRE(templ->program);
+   REQUIRE((*templ)(liquidpp::Context{}) == "123");
+}
+
+TEST_CASE("TemplateCache: concurrent access", TestTags)
+{
+   auto options = liquidpp::TemplateCache::defaultOptions();
+   options.shardCount = 4;
+   options.maxEntries = 16;
+   liquidpp::TemplateCache cache(options);
+
+   std::vector<std::thread> threads;
+   std::atomic<size_t> failures{0};
+   for (size_t t = 0; t < 8; t++)
+   {
+      threads.emplace_back([&, t]{
+         liquidpp::Context c;
+         for (size_t i = 0; i < 200; i++)
+         {
+            auto n = std::to_string((i * 7 + t) % 32);
+            auto templ = cache.get("{{ " + n + " | plus: 0 }}");
+            if ((*templ)(c) != n)
+               failures++;
+         }
+      });
+   }
+
+   for (auto&& thread : threads)
+      thread.join();
+
+   REQUIRE(failures == 0);
+   auto stats = cache.statistics();
+   REQUIRE(stats.hits + stats.misses == 8 * 200);
+   REQUIRE(stats.entries <= 16);
+}
+}
@@ -29,3 +29,46 @@ TEST_CASE("split expression tokens")
       REQUIRE_THROWS(liquidpp::Expression::splitTokens(" ' value "));
    }
 }
+
+TEST_CASE("lex expression tokens")
+{
+   using Kind = liquidpp::Expression::Lexeme::Kind;
+   using Operator = liquidpp::Expression::Operator;
+
+   auto lexemes = liquidpp::Expression::lex("a.b >= 'x y' and n contains 3 | plus: 1, 2 == x[\"a b\"]");
+   std::vector<Kind> kinds;
+   for (auto&& lexeme : lexemes)
+      kinds.push_back(lexeme.kind);
+
+   REQUIRE(kinds == std::vector<Kind>{Kind::Word, Kind::Operator, Kind::String, Kind::Operator, Kind::Word,
+                                      Kind::Operator, Kind::Word, Kind::Punctuation, Kind::Word, Kind::Punctuation,
+                                      Kind::Word, Kind::Punctuation, Kind::Word, Kind::Operator, Kind::Word});
+   REQUIRE(lexemes[1].operator_ == Operator::GreaterEqual);
+   REQUIRE(lexemes[3].operator_ == Operator::And);
+   REQUIRE(lexemes[5].operator_ == Operator::Contains);
+   REQUIRE(lexemes[13].operator_ == Operator::Equal);
+   REQUIRE(lexemes[2].text == "'x y'");
+   REQUIRE(lexemes[14].text == "x[\"a b\"]");
+
+   SECTION("tokens are the same as the ones of toToken()")
+   {
+      for (auto&& lexeme : lexemes)
+      {
+         if (lexeme.kind != Kind::Punctuation)
+         {
+            bool same = liquidpp::Expression::toToken(lexeme) == liquidpp::Expression::toToken(lexeme.text);
+            REQUIRE(same);
+         }
+      }
+   }
+}
+
+TEST_CASE("unevaluated tags keep their tokens")
+{
+   liquidpp::UnevaluatedTag tag{"{%- for item in items limit: 2 -%}"};
+   REQUIRE(tag.name == "for");
+   REQUIRE(tag.value == "item in items limit: 2");
+   REQUIRE(tag.tokens.size() == 6);
+   REQUIRE(tag.tokens.front().text == "item");
+   REQUIRE(tag.tokens.back().text == "2");
+}